@@ -0,0 +1,155 @@
+// Measures how fast the parser gets through expression-heavy code, and how
+// much stack a deeply nested expression takes.
+//
+// The throughput input is a synthetic module of small functions whose bodies
+// are mostly arithmetic, comparison and logical expressions, lexed and parsed
+// as one compilation unit. Stack use is measured by parsing nested
+// parentheses on a thread whose stack is painted beforehand and reading how
+// far the paint was overwritten; each level costs one trip from
+// parseExpression down to a primary expression.
+//
+// Usage: expression_parsing [functions] [nesting]
+
+#include <cxy/ast/node.hpp>
+#include <cxy/diagnostics.hpp>
+#include <cxy/frontend/lexer.hpp>
+#include <cxy/frontend/parser.hpp>
+#include <cxy/strings.hpp>
+#include <cxy/types/registry.hpp>
+
+#include <pthread.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace cxy;
+
+namespace {
+
+std::string makeSource(size_t functions) {
+  std::ostringstream out;
+  for (size_t i = 0; i < functions; ++i) {
+    out << "func mix" << i
+        << "(a i32, b i32, c i32) i32 {\n"
+           "    var x = a * b + c / 2 - (a << 3) % 7\n"
+           "    var ok = x >= 10 && a != b || c < 0 ? 1 : 0\n"
+           "    x += (a & 0xff) | (b ^ c) >> 2\n"
+           "    x = -x + ~b * (c - a) / (b + 1) - " << i << "\n"
+           "    return (x as i32) + ok * 3 - a\n"
+           "}\n\n";
+  }
+  return out.str();
+}
+
+struct ParseRun {
+  const std::string *source;
+  bool expressionOnly;
+  size_t errors = 0;
+};
+
+void parse(ParseRun &run) {
+  DiagnosticLogger logger;
+  logger.removeAllSinks();
+  ArenaAllocator arena;
+  StringInterner interner(arena);
+  SourceManager sources;
+  TypeRegistry types;
+  Lexer lexer("bench.cxy", *run.source, logger, interner);
+  Parser parser(lexer, arena, sources, interner, logger, types);
+  parser.initialize();
+  if (run.expressionOnly) {
+    (void)parser.parseExpression();
+  } else {
+    (void)parser.parseCompilationUnit();
+  }
+  run.errors = logger.getErrorCount();
+}
+
+// Best of a few runs to shave off scheduler noise
+double best(const std::string &source) {
+  double fastest = 0;
+  for (int run = 0; run < 5; ++run) {
+    ParseRun parseRun{&source, false};
+    const auto start = std::chrono::steady_clock::now();
+    parse(parseRun);
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    fastest = run == 0 ? elapsed.count() : std::min(fastest, elapsed.count());
+  }
+  return fastest;
+}
+
+// Stack bytes used to parse `source` as one expression
+size_t stackUsed(const std::string &source, size_t &errors) {
+  constexpr size_t size = 256 * 1024 * 1024;
+  constexpr unsigned char paint = 0xA5;
+  auto *stack = static_cast<unsigned char *>(std::aligned_alloc(4096, size));
+  std::memset(stack, paint, size);
+
+  pthread_attr_t attributes;
+  pthread_attr_init(&attributes);
+  pthread_attr_setstack(&attributes, stack, size);
+  ParseRun run{&source, true};
+  pthread_t thread;
+  pthread_create(
+      &thread, &attributes,
+      [](void *argument) -> void * {
+        parse(*static_cast<ParseRun *>(argument));
+        return nullptr;
+      },
+      &run);
+  pthread_join(thread, nullptr);
+  pthread_attr_destroy(&attributes);
+
+  // The stack grows down from stack + size
+  const size_t untouched = std::find_if(stack, stack + size, [](auto byte) {
+                             return byte != paint;
+                           }) -
+                           stack;
+  std::free(stack);
+  errors = run.errors;
+  return size - untouched;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const size_t functions =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20000;
+  const size_t nesting = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2000;
+
+  const std::string source = makeSource(functions);
+  ParseRun check{&source, false};
+  parse(check);
+  if (check.errors != 0) {
+    std::cerr << check.errors << " parse errors in the generated module\n";
+    return 1;
+  }
+
+  const double seconds = best(source);
+  std::cout << std::fixed << std::setprecision(1) << "Parsing "
+            << source.size() / 1024 << " KiB of expression-heavy code: "
+            << seconds * 1000 << " ms  ("
+            << source.size() / seconds / (1024 * 1024) << " MiB/s)\n";
+
+  // Stack for a trivial expression, so that only the nesting is counted
+  size_t errors = 0;
+  const size_t base = stackUsed("1", errors);
+  const std::string nested =
+      std::string(nesting, '(') + "1" + std::string(nesting, ')');
+  const size_t used = stackUsed(nested, errors);
+  if (errors != 0) {
+    std::cerr << "nested expression failed to parse\n";
+    return 1;
+  }
+  std::cout << "Stack for " << nesting << " nested parentheses: "
+            << used / 1024 << " KiB  (" << (used - base) / nesting
+            << " bytes per level)\n";
+  return 0;
+}
@@ -0,0 +1,118 @@
+// Measures how StringInterner scales with the number of interning threads.
+//
+// The corpus mimics lexer traffic: a stream of identifiers drawn from a
+// skewed vocabulary, so most calls hit strings that are already interned and
+// a long tail inserts new ones. Each run interns the whole corpus, split
+// evenly across threads, into a fresh concurrent interner.
+//
+// Usage: interner_scaling [tokens] [vocabulary] [max-threads]
+
+#include <cxy/strings.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace cxy;
+
+namespace {
+
+std::vector<std::string> makeCorpus(size_t tokens, size_t vocabulary) {
+  static constexpr const char *stems[] = {
+      "count", "index", "buffer", "node",  "value", "result", "lhs",
+      "rhs",   "token", "scope",  "type",  "name",  "length", "data"};
+
+  std::mt19937_64 rng(42);
+  // Zipf-like: low ranks are far more common than high ones
+  std::exponential_distribution<double> rank(8.0 / vocabulary);
+
+  std::vector<std::string> corpus;
+  corpus.reserve(tokens);
+  for (size_t i = 0; i < tokens; ++i) {
+    const auto r =
+        std::min(static_cast<size_t>(rank(rng)), vocabulary - 1);
+    corpus.push_back(std::string(stems[r % std::size(stems)]) + "_" +
+                     std::to_string(r));
+  }
+  return corpus;
+}
+
+double runOnce(const std::vector<std::string> &corpus, size_t threadCount,
+               InternerMode mode) {
+  ArenaAllocator arena;
+  StringInterner interner(arena, true, mode);
+
+  const auto start = std::chrono::steady_clock::now();
+  if (threadCount == 1) {
+    for (const auto &token : corpus) {
+      (void)interner.intern(token);
+    }
+  } else {
+    std::vector<std::thread> threads;
+    const size_t perThread = corpus.size() / threadCount;
+    for (size_t t = 0; t < threadCount; ++t) {
+      const size_t begin = t * perThread;
+      const size_t end = t + 1 == threadCount ? corpus.size() : begin + perThread;
+      threads.emplace_back([&, begin, end] {
+        for (size_t i = begin; i < end; ++i) {
+          (void)interner.intern(corpus[i]);
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// Best of a few runs to shave off scheduler noise
+double best(const std::vector<std::string> &corpus, size_t threadCount,
+            InternerMode mode) {
+  double fastest = runOnce(corpus, threadCount, mode);
+  for (int i = 0; i < 4; ++i) {
+    fastest = std::min(fastest, runOnce(corpus, threadCount, mode));
+  }
+  return fastest;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const size_t tokens = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4000000;
+  const size_t vocabulary =
+      argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 50000;
+  const size_t maxThreads =
+      argc > 3 ? std::strtoull(argv[3], nullptr, 10)
+               : std::max(1u, std::thread::hardware_concurrency());
+
+  const auto corpus = makeCorpus(tokens, std::max<size_t>(vocabulary, 1));
+  std::cout << "Interning " << tokens << " identifiers from a vocabulary of "
+            << vocabulary << "\n\n";
+
+  const double serial = best(corpus, 1, InternerMode::SingleThreaded);
+  std::cout << std::fixed << std::setprecision(1);
+  std::cout << "  single-threaded interner: " << std::setw(8)
+            << tokens / serial / 1e6 << " M/s\n";
+
+  double base = 0;
+  for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+    const double seconds = best(corpus, threads, InternerMode::Concurrent);
+    if (threads == 1) {
+      base = seconds;
+    }
+    std::cout << "  concurrent, " << std::setw(3) << threads
+              << " thread(s):   " << std::setw(8) << tokens / seconds / 1e6
+              << " M/s  (x" << std::setprecision(2) << base / seconds
+              << std::setprecision(1) << ")\n";
+  }
+  return 0;
+}
@@ -0,0 +1,201 @@
+// Measures lexer throughput at each SIMD level the CPU supports, against the
+// scalar scanning kernels, then with offset-only token positions. Tokens are
+// pulled in CompactToken form, as the parser does. Then times the bulk UTF-8
+// check each buffer gets, on the input and on mostly multi-byte text.
+// Finally reports what pre-lexing the whole input into a TokenBuffer costs in
+// memory, against the parser's streaming window.
+//
+// Without arguments the input is a synthetic module in which roughly 40% of
+// the bytes are indentation, blank lines and comments, like typical
+// hand-written code, plus one embedded string literal per function. Pass a
+// file to lex that instead.
+//
+// Usage: lexer_throughput [file] [repetitions]
+
+#include <cxy/diagnostics.hpp>
+#include <cxy/frontend/lexer.hpp>
+#include <cxy/frontend/scan.hpp>
+#include <cxy/frontend/token_buffer.hpp>
+#include <cxy/strings.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace cxy;
+
+namespace {
+
+std::string makeSource(size_t functions) {
+  std::ostringstream out;
+  for (size_t i = 0; i < functions; ++i) {
+    out << "/*\n"
+           " * Computes the running total for bucket "
+        << i
+        << ".\n"
+           " * The comment is deliberately long, as documentation tends to be.\n"
+           " */\n"
+           "func accumulate"
+        << i
+        << "(values: []i32, scale: i32) : i64 {\n"
+           "    // Start from zero and walk the whole slice\n"
+           "    var total: i64 = 0\n"
+           "    const banner = \"accumulating values into the running total "
+           "for this bucket, scaled by the given factor\\n\"\n"
+           "\n"
+           "    for (const value: values) {\n"
+           "        total += value * scale   // widen before adding\n"
+           "    }\n"
+           "\n"
+           "    return total\n"
+           "}\n\n";
+  }
+  return out.str();
+}
+
+size_t lexAll(const std::string &source,
+              PositionMode mode = PositionMode::LineColumn) {
+  DiagnosticLogger logger;
+  logger.removeAllSinks();
+  ArenaAllocator arena;
+  StringInterner interner(arena);
+  Lexer lexer("bench.cxy", source, logger, interner, mode);
+
+  size_t tokens = 0;
+  while (lexer.nextCompactToken().kind != TokenKind::EoF) {
+    ++tokens;
+  }
+  return tokens;
+}
+
+// Best of a few runs to shave off scheduler noise
+double best(const std::string &source, size_t repetitions,
+            PositionMode mode = PositionMode::LineColumn) {
+  double fastest = 0;
+  for (int run = 0; run < 5; ++run) {
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < repetitions; ++i) {
+      (void)lexAll(source, mode);
+    }
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    fastest = run == 0 ? elapsed.count() : std::min(fastest, elapsed.count());
+  }
+  return fastest;
+}
+
+// GiB/s of scan::validUtf8Prefix over `text`, best of a few runs
+double utf8Rate(const std::string &text) {
+  double fastest = 0;
+  for (int run = 0; run < 5; ++run) {
+    const auto start = std::chrono::steady_clock::now();
+    size_t valid = 0;
+    for (int i = 0; i < 10; ++i) {
+      valid += scan::validUtf8Prefix(text.data(), text.size());
+    }
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (valid != 10 * text.size()) {
+      std::cerr << "input is not valid UTF-8\n";
+    }
+    fastest = run == 0 ? elapsed.count() : std::min(fastest, elapsed.count());
+  }
+  return 10 * text.size() / fastest / (1024 * 1024 * 1024);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string source;
+  if (argc > 1) {
+    std::ifstream file(argv[1], std::ios::binary);
+    if (!file) {
+      std::cerr << "cannot open " << argv[1] << "\n";
+      return 1;
+    }
+    source.assign(std::istreambuf_iterator<char>(file), {});
+  } else {
+    source = makeSource(20000);
+  }
+  const size_t repetitions =
+      argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 3;
+
+  std::cout << "Lexing " << source.size() / 1024 << " KiB (" << lexAll(source)
+            << " tokens) x" << repetitions << "\n\n";
+
+  const auto detected = scan::detectSimdLevel();
+  double scalar = 0;
+  std::cout << std::fixed << std::setprecision(1);
+  for (auto level :
+       {scan::SimdLevel::Scalar, scan::SimdLevel::SSE2, scan::SimdLevel::AVX2}) {
+    if (level > detected) {
+      break;
+    }
+    scan::setSimdLevel(level);
+    const double seconds = best(source, repetitions);
+    if (level == scan::SimdLevel::Scalar) {
+      scalar = seconds;
+    }
+    std::cout << "  " << std::setw(6) << scan::toString(level) << ": "
+              << std::setw(8)
+              << source.size() * repetitions / seconds / (1024 * 1024)
+              << " MiB/s  (x" << std::setprecision(2) << scalar / seconds
+              << std::setprecision(1) << ")\n";
+  }
+
+  // Best SIMD level, without row/column tracking
+  const double seconds = best(source, repetitions, PositionMode::OffsetsOnly);
+  std::cout << "  " << std::setw(6) << "offset" << ": " << std::setw(8)
+            << source.size() * repetitions / seconds / (1024 * 1024)
+            << " MiB/s  (x" << std::setprecision(2) << scalar / seconds
+            << std::setprecision(1) << ")\n";
+
+  std::string multiByte;
+  while (multiByte.size() < source.size()) {
+    multiByte += "Gr\xc3\xbc\xc3\x9f Gott, "
+                 "\xce\xba\xce\xb1\xce\xbb\xce\xb7"
+                 "\xce\xbc\xce\xad\xcf\x81\xce\xb1 "
+                 "\xe2\x82\xac \xf0\x9f\x98\x80\n";
+  }
+  std::cout << "\nUTF-8 validation (source / multi-byte)\n";
+  for (auto level :
+       {scan::SimdLevel::Scalar, scan::SimdLevel::SSE2, scan::SimdLevel::AVX2}) {
+    if (level > detected) {
+      break;
+    }
+    scan::setSimdLevel(level);
+    std::cout << "  " << std::setw(6) << scan::toString(level) << ": "
+              << std::setw(8) << utf8Rate(source) << " / " << std::setw(5)
+              << utf8Rate(multiByte) << " GiB/s\n";
+  }
+
+  // Literal values live in the lexer's table in both modes; the buffer adds
+  // its arrays on top
+  DiagnosticLogger logger;
+  logger.removeAllSinks();
+  ArenaAllocator arena;
+  StringInterner interner(arena);
+  Lexer lexer("bench.cxy", source, logger, interner);
+  const auto start = std::chrono::steady_clock::now();
+  const TokenBuffer tokens(lexer);
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  const size_t window = 4 * sizeof(CompactToken);
+  const size_t literals = lexer.getLiterals().size() * sizeof(Token::Value);
+  std::cout << "\nToken memory (" << tokens.size() << " tokens)\n"
+            << "  streaming: " << std::setw(10) << window << " bytes\n"
+            << "  buffered:  " << std::setw(10) << tokens.memoryUsage()
+            << " bytes  (" << TokenBuffer::BYTES_PER_TOKEN << " per token, "
+            << std::setprecision(2)
+            << double(tokens.memoryUsage()) / double(source.size())
+            << " per source byte, lexed in " << std::setprecision(1)
+            << elapsed.count() * 1000 << " ms)\n"
+            << "  literals:  " << std::setw(10) << literals
+            << " bytes  (shared)\n";
+  return 0;
+}
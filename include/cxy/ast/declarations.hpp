@@ -35,13 +35,13 @@ public:
  */
 class VariableDeclarationNode : public DeclarationNode {
 public:
-  ArenaVector<ASTNode*> names;      ///< Variable names (identifiers or patterns)
+  ArenaSmallVector<ASTNode*, 1> names; ///< Variable names (identifiers or patterns)
   ASTNode* type = nullptr;          ///< Optional type annotation
   ASTNode* initializer = nullptr;   ///< Optional initializer expression
 
   explicit VariableDeclarationNode(Location loc, ArenaAllocator &arena, bool isConstant = false)
       : DeclarationNode(astVariableDeclaration, loc, arena),
-        names(ArenaSTLAllocator<ASTNode*>(arena)) {
+        names(arena) {
     if (isConstant) {
       flags |= flgConst;
     }
@@ -130,16 +130,16 @@ public:
 class FuncDeclarationNode : public DeclarationNode {
 public:
   ASTNode* name = nullptr;                    ///< Function name (identifier)
-  ArenaVector<ASTNode*> genericParams;        ///< Generic type parameters
-  ArenaVector<ASTNode*> parameters;           ///< Function parameters
+  ArenaSmallVector<ASTNode*, 0> genericParams; ///< Generic type parameters
+  ArenaSmallVector<ASTNode*, 0> parameters;   ///< Function parameters
   ASTNode* returnType = nullptr;              ///< Return type annotation
   ASTNode* body = nullptr;                    ///< Function body (block statement)
   TokenKind operatorToken = TokenKind::Error; ///< Operator token for overloads (Error = not an operator)
 
   explicit FuncDeclarationNode(Location loc, ArenaAllocator &arena)
       : DeclarationNode(astFuncDeclaration, loc, arena),
-        genericParams(ArenaSTLAllocator<ASTNode*>(arena)),
-        parameters(ArenaSTLAllocator<ASTNode*>(arena)) {}
+        genericParams(arena),
+        parameters(arena) {}
 
   void setName(ASTNode* nameNode) {
     if (name) removeChild(name);
@@ -210,13 +210,13 @@ public:
 class MethodDeclarationNode : public DeclarationNode {
 public:
   ASTNode* name = nullptr;                    ///< Method name
-  ArenaVector<ASTNode*> overloads;            ///< Method overloads
-  ArenaVector<const cxy::Type*> typeCache;   ///< Type objects for fast lookup
+  ArenaSmallVector<ASTNode*, 0> overloads;    ///< Method overloads
+  ArenaSmallVector<const cxy::Type*, 0> typeCache; ///< Type objects for fast lookup
 
   explicit MethodDeclarationNode(Location loc, ArenaAllocator &arena)
       : DeclarationNode(astMethodDeclaration, loc, arena),
-        overloads(ArenaSTLAllocator<ASTNode*>(arena)),
-        typeCache(ArenaSTLAllocator<const cxy::Type*>(arena)) {}
+        overloads(arena),
+        typeCache(arena) {}
 
   void setName(ASTNode* nameNode) {
     if (name) removeChild(name);
@@ -390,11 +390,11 @@ class EnumDeclarationNode : public DeclarationNode {
 public:
   ASTNode* name = nullptr;                    ///< Enum name
   ASTNode* base = nullptr;                    ///< Base type for enum backing
-  ArenaVector<ASTNode*> options;              ///< Enum options/variants
+  ArenaSmallVector<ASTNode*, 0> options;      ///< Enum options/variants
 
   explicit EnumDeclarationNode(Location loc, ArenaAllocator &arena)
       : DeclarationNode(astEnumDeclaration, loc, arena),
-        options(ArenaSTLAllocator<ASTNode*>(arena)) {}
+        options(arena) {}
 
   void setName(ASTNode* nameNode) {
     if (name) removeChild(name);
@@ -486,13 +486,13 @@ public:
 class StructDeclarationNode : public DeclarationNode {
 public:
   ASTNode* name = nullptr;                    ///< Struct name
-  ArenaVector<ASTNode*> members;              ///< Struct members (fields and methods)
-  ArenaVector<ASTNode*> annotations;          ///< Struct annotations
+  ArenaSmallVector<ASTNode*, 0> members;      ///< Struct members (fields and methods)
+  ArenaSmallVector<ASTNode*, 0> annotations;  ///< Struct annotations
 
   explicit StructDeclarationNode(Location loc, ArenaAllocator &arena)
       : DeclarationNode(astStructDeclaration, loc, arena),
-        members(ArenaSTLAllocator<ASTNode*>(arena)),
-        annotations(ArenaSTLAllocator<ASTNode*>(arena)) {}
+        members(arena),
+        annotations(arena) {}
 
   void setName(ASTNode* nameNode) {
     if (name) removeChild(name);
@@ -534,13 +534,13 @@ class ClassDeclarationNode : public DeclarationNode {
 public:
   ASTNode* name = nullptr;                    ///< Class name
   ASTNode* base = nullptr;                    ///< Base class
-  ArenaVector<ASTNode*> members;              ///< Class members (fields and methods)
-  ArenaVector<ASTNode*> annotations;          ///< Class annotations
+  ArenaSmallVector<ASTNode*, 0> members;      ///< Class members (fields and methods)
+  ArenaSmallVector<ASTNode*, 0> annotations;  ///< Class annotations
 
   explicit ClassDeclarationNode(Location loc, ArenaAllocator &arena)
       : DeclarationNode(astClassDeclaration, loc, arena),
-        members(ArenaSTLAllocator<ASTNode*>(arena)),
-        annotations(ArenaSTLAllocator<ASTNode*>(arena)) {}
+        members(arena),
+        annotations(arena) {}
 
   void setName(ASTNode* nameNode) {
     if (name) removeChild(name);
@@ -619,13 +619,13 @@ public:
 class ModuleDeclarationNode : public DeclarationNode {
 public:
   ASTNode* name = nullptr;                    ///< Module name
-  ArenaVector<ASTNode*> topLevel;             ///< Top-level declarations
-  ArenaVector<ASTNode*> mainContent;          ///< Main content declarations
+  ArenaSmallVector<ASTNode*, 0> topLevel;     ///< Top-level declarations
+  ArenaSmallVector<ASTNode*, 0> mainContent;  ///< Main content declarations
 
   explicit ModuleDeclarationNode(Location loc, ArenaAllocator &arena)
       : DeclarationNode(astModuleDeclaration, loc, arena),
-        topLevel(ArenaSTLAllocator<ASTNode*>(arena)),
-        mainContent(ArenaSTLAllocator<ASTNode*>(arena)) {}
+        topLevel(arena),
+        mainContent(arena) {}
 
   void setName(ASTNode* nameNode) {
     if (name) removeChild(name);
@@ -717,12 +717,12 @@ public:
   ImportKind kind = WholeModule;              ///< Type of import
   ASTNode* path = nullptr;                    ///< Import path
   ASTNode* name = nullptr;                    ///< Module name
-  ArenaVector<ASTNode*> entities;             ///< Imported entities
+  ArenaSmallVector<ASTNode*, 0> entities;     ///< Imported entities
   ASTNode* alias = nullptr;                   ///< Module alias
 
   explicit ImportDeclarationNode(Location loc, ArenaAllocator &arena)
       : DeclarationNode(astImportDeclaration, loc, arena),
-        entities(ArenaSTLAllocator<ASTNode*>(arena)) {}
+        entities(arena) {}
 
   void setPath(ASTNode* pathNode) {
     if (path) removeChild(path);
@@ -819,12 +819,12 @@ public:
  */
 class GenericDeclarationNode : public DeclarationNode {
 public:
-  ArenaVector<ASTNode*> parameters;           ///< Type parameters
+  ArenaSmallVector<ASTNode*, 0> parameters;   ///< Type parameters
   ASTNode* decl = nullptr;                    ///< Declaration being made generic
 
   explicit GenericDeclarationNode(Location loc, ArenaAllocator &arena)
       : DeclarationNode(astGenericDeclaration, loc, arena),
-        parameters(ArenaSTLAllocator<ASTNode*>(arena)) {}
+        parameters(arena) {}
 
   void addParameter(ASTNode* param) {
     if (param) {
@@ -888,12 +888,12 @@ public:
 class MacroDeclarationNode : public DeclarationNode {
 public:
   ASTNode* name = nullptr;                    ///< Macro name
-  ArenaVector<ASTNode*> parameters;           ///< Macro parameters
+  ArenaSmallVector<ASTNode*, 0> parameters;   ///< Macro parameters
   ASTNode* body = nullptr;                    ///< Macro body
 
   explicit MacroDeclarationNode(Location loc, ArenaAllocator &arena)
       : DeclarationNode(astMacroDeclaration, loc, arena),
-        parameters(ArenaSTLAllocator<ASTNode*>(arena)) {}
+        parameters(arena) {}
 
   void setName(ASTNode* nameNode) {
     if (name) removeChild(name);
@@ -259,11 +259,11 @@ public:
  */
 class StringExpressionNode : public ExpressionNode {
 public:
-  ArenaVector<ASTNode *> parts; ///< String parts and expressions
+  ArenaSmallVector<ASTNode *, 0> parts; ///< String parts and expressions
 
   explicit StringExpressionNode(Location loc, ArenaAllocator &arena)
       : ExpressionNode(astStringExpr, loc, arena),
-        parts(ArenaSTLAllocator<ASTNode *>(arena)) {}
+        parts(arena) {}
 
   void addPart(ASTNode *part) {
     if (part) {
@@ -329,12 +329,12 @@ public:
 class CallExpressionNode : public ExpressionNode {
 public:
   ASTNode *callee;                  ///< Function being called
-  ArenaVector<ASTNode *> arguments; ///< Call arguments
+  ArenaSmallVector<ASTNode *, 2> arguments; ///< Call arguments
 
   explicit CallExpressionNode(ASTNode *callee_expr, Location loc,
                               ArenaAllocator &arena)
       : ExpressionNode(astCallExpr, loc, arena), callee(callee_expr),
-        arguments(ArenaSTLAllocator<ASTNode *>(arena)) {
+        arguments(arena) {
     if (callee) {
       addChild(callee);
     }
@@ -399,11 +399,11 @@ public:
  */
 class ArrayExpressionNode : public ExpressionNode {
 public:
-  ArenaVector<ASTNode *> elements; ///< Array elements
+  ArenaSmallVector<ASTNode *, 0> elements; ///< Array elements
 
   explicit ArrayExpressionNode(Location loc, ArenaAllocator &arena)
       : ExpressionNode(astArrayExpr, loc, arena),
-        elements(ArenaSTLAllocator<ASTNode *>(arena)) {}
+        elements(arena) {}
 
   void addElement(ASTNode *element) {
     if (element) {
@@ -433,11 +433,11 @@ public:
  */
 class TupleExpressionNode : public ExpressionNode {
 public:
-  ArenaVector<ASTNode *> elements; ///< Tuple elements
+  ArenaSmallVector<ASTNode *, 0> elements; ///< Tuple elements
 
   explicit TupleExpressionNode(Location loc, ArenaAllocator &arena)
       : ExpressionNode(astTupleExpr, loc, arena),
-        elements(ArenaSTLAllocator<ASTNode *>(arena)) {}
+        elements(arena) {}
 
   void addElement(ASTNode *element) {
     if (element) {
@@ -498,12 +498,12 @@ public:
 class StructExpressionNode : public ExpressionNode {
 public:
   ASTNode *type; ///< Optional struct type (nullptr for anonymous)
-  ArenaVector<FieldExpressionNode *> fields; ///< Struct fields
+  ArenaSmallVector<FieldExpressionNode *, 0> fields; ///< Struct fields
 
   explicit StructExpressionNode(ASTNode *struct_type, Location loc,
                                 ArenaAllocator &arena)
       : ExpressionNode(astStructExpr, loc, arena), type(struct_type),
-        fields(ArenaSTLAllocator<FieldExpressionNode *>(arena)) {
+        fields(arena) {
     if (type) {
       addChild(type);
     }
@@ -576,12 +576,12 @@ public:
 class MacroCallExpressionNode : public ExpressionNode {
 public:
   ASTNode *callee;                  ///< Macro callee expression
-  ArenaVector<ASTNode *> arguments; ///< Macro arguments
+  ArenaSmallVector<ASTNode *, 2> arguments; ///< Macro arguments
 
   explicit MacroCallExpressionNode(ASTNode *callee_expr, Location loc,
                                    ArenaAllocator &arena)
       : ExpressionNode(astMacroCallExpr, loc, arena), callee(callee_expr),
-        arguments(ArenaSTLAllocator<ASTNode *>(arena)) {
+        arguments(arena) {
     if (callee) {
       addChild(callee);
     }
@@ -616,15 +616,15 @@ public:
  */
 class ClosureExpressionNode : public ExpressionNode {
 public:
-  ArenaVector<ASTNode *> captures;   ///< Captured variables
-  ArenaVector<ASTNode *> parameters; ///< Parameter declarations
+  ArenaSmallVector<ASTNode *, 0> captures;   ///< Captured variables
+  ArenaSmallVector<ASTNode *, 0> parameters; ///< Parameter declarations
   ASTNode *body;                     ///< Closure body expression/block
 
   explicit ClosureExpressionNode(ASTNode *closure_body, Location loc,
                                  ArenaAllocator &arena)
       : ExpressionNode(astClosureExpr, loc, arena),
-        captures(ArenaSTLAllocator<ASTNode *>(arena)),
-        parameters(ArenaSTLAllocator<ASTNode *>(arena)), body(closure_body) {
+        captures(arena),
+        parameters(arena), body(closure_body) {
     if (body) {
       addChild(body);
     }
@@ -10,10 +10,13 @@ namespace cxy::ast {
  * @brief Simple identifier node.
  *
  * Represents a simple identifier like `name`, `variable`, `function`.
- * Contains a direct reference to the declaration it resolves to.
+ * Contains a direct reference to the declaration it resolves to. Like the
+ * literal nodes it is marked ArenaTriviallyDestructible.
  */
 class IdentifierNode : public ASTNode {
 public:
+  using ArenaTriviallyDestructible = IdentifierNode;
+
   InternedString name;             ///< Identifier name
   ASTNode *resolvedNode = nullptr; ///< Points to declaration node
 
@@ -13,6 +13,11 @@ namespace cxy::ast {
  * Literals represent compile-time constant values in the source code.
  * They carry their value directly in the AST node for easy access
  * during compilation phases.
+ *
+ * The concrete literal nodes hold nothing that needs destroying and are
+ * marked ArenaTriviallyDestructible. Building with
+ * CXY_CHECK_TRIVIAL_AST_NODES reports them for as long as ASTNode itself
+ * keeps them from being trivially destructible.
  */
 class LiteralNode : public ASTNode {
 public:
@@ -27,6 +32,8 @@ public:
  */
 class BoolLiteralNode : public LiteralNode {
 public:
+  using ArenaTriviallyDestructible = BoolLiteralNode;
+
   bool value;
 
   explicit BoolLiteralNode(bool val, Location loc, ArenaAllocator &arena)
@@ -47,6 +54,8 @@ public:
  */
 class IntLiteralNode : public LiteralNode {
 public:
+  using ArenaTriviallyDestructible = IntLiteralNode;
+
   __int128 value;
 
   explicit IntLiteralNode(__int128 val, Location loc, ArenaAllocator &arena)
@@ -66,6 +75,8 @@ public:
  */
 class FloatLiteralNode : public LiteralNode {
 public:
+  using ArenaTriviallyDestructible = FloatLiteralNode;
+
   double value;
 
   explicit FloatLiteralNode(double val, Location loc, ArenaAllocator &arena)
@@ -85,6 +96,8 @@ public:
  */
 class StringLiteralNode : public LiteralNode {
 public:
+  using ArenaTriviallyDestructible = StringLiteralNode;
+
   InternedString value;
 
   explicit StringLiteralNode(InternedString val, Location loc,
@@ -105,6 +118,8 @@ public:
  */
 class CharLiteralNode : public LiteralNode {
 public:
+  using ArenaTriviallyDestructible = CharLiteralNode;
+
   uint32_t value; // Unicode code point
 
   explicit CharLiteralNode(uint32_t val, Location loc, ArenaAllocator &arena)
@@ -128,6 +143,8 @@ public:
  */
 class NullLiteralNode : public LiteralNode {
 public:
+  using ArenaTriviallyDestructible = NullLiteralNode;
+
   explicit NullLiteralNode(Location loc, ArenaAllocator &arena)
       : LiteralNode(astNull, loc, arena) {}
 
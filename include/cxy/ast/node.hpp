@@ -1,5 +1,6 @@
 #pragma once
 
+#include "cxy/memory/arena_small_vector.hpp"
 #include "cxy/memory/arena_stl.hpp"
 #include "cxy/ast/kind.hpp"
 #include "cxy/diagnostics.hpp"
@@ -38,11 +39,11 @@ public:
   Location location;         ///< Source location for diagnostics
   ASTNode *parent = nullptr; ///< Parent node (for tree traversal)
 
-  // Arena-allocated children storage
-  ArenaVector<ASTNode *> children;
+  // Children storage; most nodes have at most three, kept inline
+  ArenaSmallVector<ASTNode *, 3> children;
 
-  // Arena-allocated attributes storage
-  ArenaVector<ASTNode *> attrs;
+  // Attributes storage; most nodes have none, so nothing is inline
+  ArenaSmallVector<ASTNode *, 0> attrs;
 
   // Progressive enhancement fields (filled by semantic passes)
   const cxy::Type *type = nullptr;  ///< Semantic type information (from type system)
@@ -59,8 +60,7 @@ public:
    * @param arena Arena allocator for children and metadata
    */
   explicit ASTNode(NodeKind k, Location loc, ArenaAllocator &arena)
-      : kind(k), location(loc), children(ArenaSTLAllocator<ASTNode *>(arena)),
-        attrs(ArenaSTLAllocator<ASTNode *>(arena)),
+      : kind(k), location(loc), children(arena), attrs(arena),
         metadata(
             ArenaSTLAllocator<std::pair<const std::string, std::any>>(arena)) {}
 
@@ -81,6 +81,8 @@ struct PrinterConfig {
   uint32_t indentSize = 2;     ///< Spaces per indent level
   std::string_view nodePrefix; ///< Optional prefix for node names
   std::function<bool(const ASTNode *)> nodeFilter; ///< Optional node filter
+  /// Resolves offset-only locations (PositionMode::OffsetsOnly) to row/column
+  const SourceManager *sourceManager = nullptr;
 
   /**
    * @brief Check if a flag is set.
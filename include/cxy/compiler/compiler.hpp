@@ -72,8 +72,9 @@ public:
     /**
      * @brief Compile a single source file.
      *
-     * Reads the file from disk and runs the complete compilation pipeline.
-     * Handles include processing and module imports automatically.
+     * Maps the file into the source manager (or reads it once where it
+     * cannot be mapped) and runs the complete compilation pipeline on those
+     * bytes. Handles include processing and module imports automatically.
      *
      * @param sourcePath Path to source file to compile
      * @return CompilationResult with status, AST, and diagnostic counts
@@ -93,6 +94,19 @@ public:
     [[nodiscard]] CompilationResult compileSource(std::string_view source, 
                                                   std::string_view filename = "<input>");
 
+    /**
+     * @brief Compile everything on standard input.
+     *
+     * Input is lexed as it arrives, through a streaming lexer that holds
+     * only a window of it. Since the text is not kept, diagnostics for stdin
+     * carry locations but no source excerpts. With the printTokens dev
+     * option the whole input is read into the source manager first.
+     *
+     * @param filename Filename for diagnostic reporting (default: "<stdin>")
+     * @return CompilationResult with status, AST, and diagnostic counts
+     */
+    [[nodiscard]] CompilationResult compileStdin(std::string_view filename = "<stdin>");
+
     /**
      * @brief Compile source code from string (convenience alias).
      *
@@ -307,7 +321,8 @@ private:
      *
      * Executes lexing, parsing, and optional semantic analysis phases.
      *
-     * @param source Source code to compile
+     * @param source Source code to compile, as registered with the source
+     *               manager under filename
      * @param filename Filename for diagnostics
      * @param runSemanticAnalysis Whether to run semantic analysis pass
      * @return CompilationResult with status and AST
@@ -317,6 +332,15 @@ private:
         std::string_view filename,
         bool runSemanticAnalysis = false);
 
+    /**
+     * @brief Run the pipeline over tokens from an existing lexer, which may
+     *        be streaming.
+     */
+    [[nodiscard]] CompilationResult runCompilationPipeline(
+        Lexer& lexer,
+        std::string_view filename,
+        bool runSemanticAnalysis = false);
+
 
 };
 
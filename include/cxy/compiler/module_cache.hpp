@@ -17,7 +17,7 @@ namespace cxy::compiler {
  * process and semantic analysis results.
  */
 struct CachedModule {
-    ast::ASTNode* ast;                          ///< Compiled and semantically analyzed AST (arena-allocated)
+    ast::ASTNode* ast = nullptr;                ///< Compiled and semantically analyzed AST (arena-allocated)
     std::filesystem::path canonicalPath;        ///< Canonical path to source file
     std::filesystem::file_time_type timestamp;  ///< File modification time when cached
     size_t errorCount = 0;                      ///< Number of errors during compilation
@@ -1,10 +1,12 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdio>
 #include <format>
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -23,6 +25,12 @@ struct Position {
   Position(size_t r, size_t c, size_t offset)
       : row(r), column(c), byteOffset(offset) {}
 
+  // Position that only knows its byte offset, as produced by a lexer in
+  // PositionMode::OffsetsOnly; SourceManager::resolve() fills in row/column
+  static Position fromOffset(size_t offset) { return Position(0, 0, offset); }
+
+  [[nodiscard]] bool isResolved() const noexcept { return row != 0; }
+
   bool operator==(const Position &other) const noexcept {
     return row == other.row && column == other.column &&
            byteOffset == other.byteOffset;
@@ -117,6 +125,7 @@ public:
 private:
   std::string getSeverityColor(Severity severity) const;
   std::string getResetColor() const;
+  Location resolve(const Location &loc) const;
   std::string formatLocationHeader(const Location &loc) const;
   std::string getSourceLine(const Location &loc) const;
   std::string createCaretLine(const Location &loc,
@@ -158,14 +167,62 @@ public:
   [[nodiscard]] std::vector<DiagnosticMessage> getWarnings() const;
 };
 
+// Read-only bytes of one source file. Files are mapped privately where the
+// platform allows it, so everything that looks at the source reads the same
+// pages; sources that cannot be mapped (pipes, terminals, empty files) or
+// are handed over as strings live in a single heap buffer. A mapped file
+// must not be truncated while it is in use.
+class SourceBuffer {
+public:
+  SourceBuffer() = default;
+  explicit SourceBuffer(std::string content) : owned(std::move(content)) {}
+  SourceBuffer(SourceBuffer &&other) noexcept;
+  SourceBuffer &operator=(SourceBuffer &&other) noexcept;
+  SourceBuffer(const SourceBuffer &) = delete;
+  SourceBuffer &operator=(const SourceBuffer &) = delete;
+  ~SourceBuffer();
+
+  // Map the file, or read it in one pass if it cannot be mapped; nullopt if
+  // it cannot be opened or read
+  [[nodiscard]] static std::optional<SourceBuffer>
+  fromFile(const std::string &path);
+  // Read a stream to its end
+  [[nodiscard]] static std::optional<SourceBuffer>
+  fromStream(std::FILE *stream);
+
+  [[nodiscard]] std::string_view view() const noexcept {
+    return mapping ? std::string_view(mapping, mappedSize)
+                   : std::string_view(owned);
+  }
+  [[nodiscard]] bool isMapped() const noexcept { return mapping != nullptr; }
+
+private:
+  void release() noexcept;
+
+  std::string owned;
+  const char *mapping = nullptr;
+  size_t mappedSize = 0;
+};
+
 class SourceManager {
 private:
-  std::unordered_map<std::string, std::string> fileContents;
+  std::unordered_map<std::string, SourceBuffer> fileContents;
   std::unordered_map<std::string, std::vector<size_t>>
       lineOffsets; // Cache line start offsets
 
 public:
-  void registerFile(const std::string &filename, std::string content);
+  // Take ownership of content; returns the registered bytes, which stay
+  // valid until the file is registered again
+  std::string_view registerFile(const std::string &filename,
+                                std::string content);
+  // Register the file read from disk (mapped when possible); nullopt if it
+  // cannot be read. The lexer should be given the returned view, so there
+  // is only ever one copy of the source.
+  [[nodiscard]] std::optional<std::string_view>
+  loadFile(const std::string &filename);
+  // Register everything left in stream under filename
+  [[nodiscard]] std::optional<std::string_view>
+  loadStream(const std::string &filename, std::FILE *stream);
   [[nodiscard]] std::optional<std::string> getLine(const std::string &filename,
                                                    size_t lineNumber) const;
   [[nodiscard]] std::optional<std::string>
@@ -176,14 +233,23 @@ public:
   [[nodiscard]] Position createPosition(const std::string &filename,
                                         size_t byteOffset);
 
+  // Fill in row/column of offset-only positions by binary search over the
+  // file's line starts. Resolved positions and unknown files are returned
+  // unchanged.
+  [[nodiscard]] Position resolve(const std::string &filename,
+                                 const Position &position) const;
+  [[nodiscard]] Location resolve(const Location &location) const;
+
   // Check if file is registered
   [[nodiscard]] bool hasFile(const std::string &filename) const;
 
   // Get file content
-  [[nodiscard]] const std::string *
+  [[nodiscard]] std::optional<std::string_view>
   getFileContent(const std::string &filename) const;
 
 private:
+  std::string_view registerBuffer(const std::string &filename,
+                                  SourceBuffer buffer);
   void buildLineOffsets(const std::string &filename);
   [[nodiscard]] std::pair<size_t, size_t>
   getLineAndColumn(const std::string &filename, size_t byteOffset) const;
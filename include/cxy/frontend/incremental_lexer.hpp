@@ -0,0 +1,154 @@
+#pragma once
+
+#include "cxy/frontend/lexer.hpp"
+#include "cxy/token.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cxy {
+
+/**
+ * @brief Token stream of a buffer under edit, kept current by re-lexing only
+ * around each edit.
+ *
+ * Tokens are held in segments of about SEGMENT_TOKENS tokens. Each segment
+ * starts with the lexer state taken before its first token and stores its
+ * length and token offsets relative to its start. The segments sit in a
+ * balanced tree that sums lengths and token counts, so absolute offsets and
+ * token indices are worked out on lookup and nothing after an edit is
+ * touched.
+ *
+ * update() resumes a streaming lexer at the last checkpoint safely before
+ * the edit and stops as soon as, past the edit, it reaches the start of an
+ * old segment in the same lexer state: from there on the old tokens are
+ * exactly what lexing the whole text again would give. An edit costs the
+ * bytes lexed, about two segments plus the edit itself, and a number of
+ * tree steps logarithmic in the segment count; the text is never copied or
+ * scanned as a whole.
+ *
+ * As in TokenBuffer, tokens are lexed outside any template context. Token
+ * positions are byte offsets (PositionMode::OffsetsOnly), to be resolved
+ * through a SourceManager copy of the current text. Lexical errors are
+ * reported again for the bytes that are re-lexed.
+ */
+class IncrementalLexer {
+public:
+  /// Tokens per segment, the granularity of re-lexing
+  static constexpr size_t SEGMENT_TOKENS = 256;
+
+  /**
+   * @brief Replacement of bytes [offset, offset + removed) of the previous
+   * text by @p inserted new bytes.
+   */
+  struct Edit {
+    size_t offset = 0;
+    size_t removed = 0;
+    size_t inserted = 0;
+  };
+
+  /**
+   * @brief What an update() replaced and what it cost.
+   */
+  struct Update {
+    size_t firstToken = 0;     ///< Index of the first token re-lexed
+    size_t removedTokens = 0;  ///< Old tokens replaced from there
+    size_t insertedTokens = 0; ///< New tokens in their place
+    size_t bytesLexed = 0;     ///< Bytes lexed to get back in step
+    size_t treeSteps = 0;      ///< Segment tree nodes visited
+  };
+
+  IncrementalLexer(std::string filename, DiagnosticLogger &logger,
+                   StringInterner &interner);
+  ~IncrementalLexer();
+
+  /**
+   * @brief Lex @p text from scratch.
+   */
+  void reset(std::string_view text);
+
+  /**
+   * @brief Bring the tokens up to date with @p text, which is the text of
+   * the previous call with @p edit applied.
+   *
+   * @p text only needs to stay alive for the duration of the call.
+   */
+  Update update(std::string_view text, const Edit &edit);
+
+  /**
+   * @brief Number of tokens, including the trailing EoF.
+   */
+  size_t size() const;
+
+  /**
+   * @brief Token at @p index, with its absolute offset.
+   *
+   * Integer and float literal values are stored per segment, so their
+   * valueIndex is only meaningful to expand().
+   */
+  CompactToken operator[](size_t index) const;
+
+  /**
+   * @brief Full Token at @p index, with an offset-only location.
+   */
+  Token expand(size_t index) const;
+
+  /**
+   * @brief Number of segments, for tests and diagnostics.
+   */
+  size_t segmentCount() const;
+
+private:
+  struct Segment {
+    Lexer::Checkpoint start;             // State before the first token
+    size_t bytes = 0;                    // Distance to the next segment
+    std::vector<CompactToken> tokens;    // Offsets relative to the start
+    std::vector<Token::Value> literals;  // Integer and float values
+  };
+
+  // Tree node over segments in text order; defined with its operations in
+  // the source file
+  struct Node;
+
+  // A segment found in the tree, with where it starts in the current text.
+  // start.offset of a segment is only kept while it is being lexed.
+  struct Located {
+    const Segment *segment = nullptr;
+    size_t index = 0;      // Position among the segments
+    size_t offset = 0;     // Absolute byte offset of its start
+    size_t firstToken = 0; // Index of its first token
+  };
+
+  // Bytes a token may look at past its end; a checkpoint this close before
+  // an edit is not a safe place to restart
+  static constexpr size_t LOOKAHEAD = 8;
+
+  // Streaming chunk size for re-lexing, a little over one segment of text
+  static constexpr size_t CHUNK_SIZE = 4096;
+
+  // Lex `text` from segment `first` into new segments, until EoF or until a
+  // token boundary at or past `resyncFrom` meets the start of an old segment,
+  // shifted by `delta`, in the same state. Returns the index of that old
+  // segment, or segmentCount() at EoF. The new segments get their lengths,
+  // the last one up to where lexing stopped.
+  size_t relex(std::string_view text, const Located &first, size_t resyncFrom,
+               ptrdiff_t delta, std::vector<Segment> &lexed,
+               size_t &bytesLexed, size_t &steps);
+
+  Located segmentAt(size_t index, size_t &steps) const;
+  Located segmentOf(size_t token) const;
+
+  uint32_t nextPriority();
+
+  std::string filename_;
+  DiagnosticLogger &logger_;
+  StringInterner &interner_;
+  std::unique_ptr<Node> root_;
+  uint32_t seed_ = 0x9e3779b9;  // Node priorities
+};
+
+} // namespace cxy
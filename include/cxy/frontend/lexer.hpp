@@ -1,9 +1,12 @@
 #pragma once
 
 #include "cxy/diagnostics.hpp"
+#include "cxy/frontend/scan.hpp"
 #include "cxy/token.hpp"
 
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -28,10 +31,32 @@ enum class LexError {
   InvalidUtf8           // Invalid UTF-8 sequence
 };
 
+// How token positions are recorded
+enum class PositionMode {
+  LineColumn,  // Track row and column for every byte consumed
+  OffsetsOnly  // Record byte offsets only; row/column are resolved later
+               // through SourceManager::resolve() when something needs them
+};
+
+// Pulls more input for a streaming lexer: fills up to `capacity` bytes at
+// `buffer` and returns how many were written, 0 once the input is exhausted
+using SourceReader = std::function<size_t(char *buffer, size_t capacity)>;
+
 class Lexer {
 public:
   // Core tokenization interface
   Token nextToken();
+  // Same token stream in CompactToken form, without materializing a Location
+  // or the literal value; see getLocation() and expand()
+  CompactToken nextCompactToken();
+
+  // Source location of a token produced by this lexer. Row and column are
+  // found by binary search over the file's line starts, or left unresolved
+  // in PositionMode::OffsetsOnly.
+  Location getLocation(const CompactToken &token) const;
+  // Full Token, with location and literal value, for a token from this lexer
+  Token expand(const CompactToken &token) const;
+  const LiteralTable &getLiterals() const { return literals; }
 
   // Buffer management for includes (Phase 7)
   bool pushBuffer(std::string_view filename, std::string_view content);
@@ -41,18 +66,48 @@ public:
   Location getCurrentLocation() const;
   Location makeLocation(const Position &start) const; // Create range location
 
-  // Debug functionality
+  // Debug functionality. Re-lexes the main buffer from its start, so for
+  // streamed input only the bytes still held in the window are printed.
   void printAllTokens(std::ostream &out = std::cout) const;
 
   // Constructor
   Lexer(std::string_view filename, std::string_view content,
-        DiagnosticLogger &logger, StringInterner &interner);
+        DiagnosticLogger &logger, StringInterner &interner,
+        PositionMode positionMode = PositionMode::LineColumn);
+
+  // Streaming constructor: input is pulled from `reader` in chunks of
+  // `chunkSize` bytes as tokens are requested, and bytes are dropped once
+  // the tokens they belong to have been returned, so a pipe can be lexed
+  // while it is still being written and memory stays at a few chunks plus
+  // the longest token. The source text itself is not kept, so in
+  // PositionMode::LineColumn line starts are recorded as bytes arrive.
+  Lexer(std::string_view filename, SourceReader reader,
+        DiagnosticLogger &logger, StringInterner &interner,
+        size_t chunkSize = DEFAULT_CHUNK_SIZE,
+        PositionMode positionMode = PositionMode::LineColumn);
+  ~Lexer();
+
+  static constexpr size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+  bool isStreaming() const { return stream != nullptr; }
+
+  PositionMode getPositionMode() const { return positionMode; }
 
   // Template context management for >> splitting
   void enterTemplateContext();
   void exitTemplateContext();
   bool inTemplateContext() const;
 
+  // Lexer state between two tokens of the main buffer, for incremental
+  // re-lexing (see IncrementalLexer)
+  struct Checkpoint;
+  Checkpoint checkpoint() const;
+  // Start a streaming lexer that has not produced a token yet from a
+  // checkpoint: its reader must begin at checkpoint.offset, and offsets
+  // continue from there. Use PositionMode::OffsetsOnly, as rows would count
+  // from the checkpoint.
+  void resume(const Checkpoint &checkpoint);
+
 private:
   // Buffer stack for include directives
   struct LexerBuffer {
@@ -62,9 +117,24 @@ private:
     size_t line;
     size_t column;
     size_t byteOffset;
+    FileID file;
+    // content[0, validUtf8) is well-formed UTF-8, checked in bulk when the
+    // buffer is pushed, so code points inside it are decoded unchecked
+    size_t validUtf8;
+  };
+
+  // Every buffer ever pushed, indexed by FileID, so tokens can be mapped back
+  // to their source after an include has been popped
+  struct SourceFile {
+    std::string_view filename;
+    std::string_view content;
+    mutable std::vector<uint32_t> lineStarts; // Built on first lookup
   };
 
   std::vector<LexerBuffer> bufferStack;
+  std::vector<SourceFile> files;
+  LiteralTable literals;
+  Position tokenStart; // Start of the token made last, for nextToken()
   DiagnosticLogger &logger;
   StringInterner &interner;
 
@@ -76,6 +146,8 @@ private:
 
     InterpolationContext()
         : active(false), inExpression(false), braceDepth(0) {}
+
+    bool operator==(const InterpolationContext &) const = default;
   };
 
   std::vector<InterpolationContext> interpolationStack;
@@ -83,20 +155,47 @@ private:
   // Template context tracking for >> splitting in generics
   int templateDepth;
 
+  PositionMode positionMode;
+
+  // Streaming input (see the streaming constructor). The main buffer's
+  // content is a window over the input starting at byte `base`; a token that
+  // ends within STREAM_MARGIN bytes of the window end while more input is
+  // pending may continue past it, so the lexer state is rolled back to the
+  // saved copies and the token lexed again over a larger window. Errors are
+  // held in `deferred` until the token is final, so each is reported once.
+  struct StreamInput {
+    SourceReader reader;
+    size_t chunkSize;
+    std::string window;
+    size_t base = 0;
+    bool exhausted = false;
+    bool deferErrors = false;
+    std::vector<std::pair<Location, std::string>> deferred;
+    std::vector<LexerBuffer> savedBuffers;
+    std::vector<InterpolationContext> savedInterpolation;
+  };
+  static constexpr size_t STREAM_MARGIN = 16;
+  std::unique_ptr<StreamInput> stream;
+
   // Core lexing methods
-  Token lexNextToken();
+  CompactToken lexToken(); // Next token from the buffer stack as it stands
+  CompactToken nextStreamedToken();
+  void fillStream(size_t lookahead);
+  CompactToken lexNextToken();
   char currentChar() const;
   char peekChar(size_t offset = 1) const;
   void advance();
   void skipWhitespace();
+  void skipScanned(const scan::Skip &skip); // Move past a scanned run
+  void skipUntilAny(char first, char second, char third);
   void skipLineComment();
   void skipBlockComment();
 
   // Phase 6: String interpolation
   bool hasInterpolation();
-  Token lexInterpolatedString();
-  Token continueStringAfterExpression();
-  Token lexRegularString(const Position &start);
+  CompactToken lexInterpolatedString();
+  CompactToken continueStringAfterExpression();
+  CompactToken lexRegularString(const Position &start);
   void pushInterpolationContext();
   void popInterpolationContext();
   void enterExpressionMode();
@@ -110,20 +209,21 @@ private:
   void popBuffer();
 
   // Token parsing methods (will be implemented in later phases)
-  Token lexNumber();
-  Token lexFloat(const Position &start, int base, __uint128_t integerPart,
-                 bool hasIntegerPart);
-  Token lexString();
-  Token lexRawString();
-  Token lexCharacter();
-  Token lexIdentifierOrKeyword();
-  Token lexSymbol();
+  CompactToken lexNumber();
+  CompactToken lexFloat(const Position &start, size_t startPos, int base,
+                        __uint128_t integerPart, bool hasIntegerPart);
+  CompactToken lexString();
+  CompactToken lexRawString();
+  CompactToken lexCharacter();
+  CompactToken lexIdentifierOrKeyword();
+  CompactToken lexSymbol();
 
   // String processing helpers
-  Token createProcessedStringToken(const char *contentStart,
-                                   size_t sourceLength, bool hasEscapes,
-                                   size_t estimatedLength,
-                                   const Position &start, TokenKind tokenKind);
+  CompactToken createProcessedStringToken(const char *contentStart,
+                                          size_t sourceLength, bool hasEscapes,
+                                          size_t estimatedLength,
+                                          const Position &start,
+                                          TokenKind tokenKind);
 
   // Helper for scanning interpolated string content
   struct InterpolatedScanResult {
@@ -134,19 +234,33 @@ private:
     bool foundInterpolation; // true if stopped at {, false if stopped at "
   };
   InterpolatedScanResult scanInterpolatedStringContent(const Position &start);
+  // Scan a string body up to the closing quote, or also up to an unescaped
+  // '{' when @p stopAtInterpolation is set, jumping over plain bytes with the
+  // SIMD scanner
+  InterpolatedScanResult scanStringContent(bool stopAtInterpolation);
 
   size_t processEscapeSequences(const char *source, size_t sourceLength,
                                 char *dest);
 
   // Helper methods
   bool isAtBufferEnd() const;
+  Position currentPosition() const; // Cursor position in the current mode
+  Position resolvePosition(const SourceFile &file, size_t offset) const;
+
+  // Token spanning from start to the cursor, optionally carrying a value
+  // (see CompactToken for what valueIndex holds per kind)
+  CompactToken makeToken(TokenKind kind, const Position &start);
+  CompactToken makeToken(TokenKind kind, const Position &start,
+                         uint32_t valueIndex);
+  Token expand(const CompactToken &token, Location location) const;
   void advancePosition();
 
   // Error reporting
   void reportError(LexError error, const std::string &message);
   void reportError(LexError error, const Location &location,
                    const std::string &message);
-  Token createErrorToken();
+  CompactToken createErrorToken();
+  size_t errorCount() const; // Errors reported so far, including deferred
 
   // Character classification helpers
   static bool isIdentifierStart(char c);
@@ -168,11 +282,24 @@ private:
   parseEscapeSequenceForChar(); // For character literals (returns full Unicode)
   uint32_t parseUnicodeEscape(int digitCount);
   uint32_t parseUTF8Codepoint();
-  bool isValidUTF8Start(char c) const;
 
   // Current buffer access
   LexerBuffer &currentBuffer();
   const LexerBuffer &currentBuffer() const;
 };
 
+// Everything that decides how the bytes from `offset` on are lexed: lexing
+// the same bytes from checkpoints in the same state gives the same tokens
+struct Lexer::Checkpoint {
+  size_t offset = 0;
+  int templateDepth = 0;
+  std::vector<InterpolationContext> interpolation; // Open strings, innermost
+                                                   // last
+
+  bool sameState(const Checkpoint &other) const {
+    return templateDepth == other.templateDepth &&
+           interpolation == other.interpolation;
+  }
+};
+
 } // namespace cxy
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+namespace cxy::numbers {
+
+/**
+ * @brief Eight source bytes as one little-endian word, first byte lowest.
+ */
+inline uint64_t loadEight(const char *data) noexcept {
+  uint64_t chunk;
+  std::memcpy(&chunk, data, sizeof(chunk));
+  if constexpr (std::endian::native == std::endian::big) {
+    chunk = std::byteswap(chunk);
+  }
+  return chunk;
+}
+
+/**
+ * @brief Whether all eight bytes of @p chunk are '0'..'9'.
+ */
+inline bool isEightDigits(uint64_t chunk) noexcept {
+  return ((chunk & 0xF0F0F0F0F0F0F0F0) |
+          (((chunk + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) ==
+         0x3333333333333333;
+}
+
+/**
+ * @brief Value of eight decimal digits, checked with isEightDigits().
+ *
+ * Adjacent digits are combined pairwise in three multiply steps instead of
+ * eight dependent multiply-adds.
+ */
+inline uint32_t parseEightDigits(uint64_t chunk) noexcept {
+  constexpr uint64_t mask = 0x000000FF000000FF;
+  constexpr uint64_t high = 100 + (1000000ull << 32);
+  constexpr uint64_t low = 1 + (10000ull << 32);
+  chunk -= 0x3030303030303030;
+  chunk = (chunk * 10) + (chunk >> 8);
+  return static_cast<uint32_t>(
+      (((chunk & mask) * high) + (((chunk >> 16) & mask) * low)) >> 32);
+}
+
+namespace detail {
+
+// High bit of each byte set where lo <= byte <= hi; bytes must be below 0x80
+constexpr uint64_t bytesInRange(uint64_t chunk, uint8_t lo,
+                                uint8_t hi) noexcept {
+  constexpr uint64_t ones = 0x0101010101010101;
+  const uint64_t atLeastLo = chunk + ones * (0x80 - lo);
+  const uint64_t aboveHi = chunk + ones * (0x7F - hi);
+  return atLeastLo & ~aboveHi & (ones * 0x80);
+}
+
+} // namespace detail
+
+/**
+ * @brief Whether all eight bytes of @p chunk are hexadecimal digits.
+ */
+inline bool isEightHexDigits(uint64_t chunk) noexcept {
+  if (chunk & 0x8080808080808080) {
+    return false;
+  }
+  const uint64_t digits = detail::bytesInRange(chunk, '0', '9');
+  const uint64_t letters =
+      detail::bytesInRange(chunk | 0x2020202020202020, 'a', 'f');
+  return (digits | letters) == 0x8080808080808080;
+}
+
+/**
+ * @brief Value of eight hexadecimal digits, checked with isEightHexDigits().
+ */
+inline uint32_t parseEightHexDigits(uint64_t chunk) noexcept {
+  // Letters have bit 6 set and 1..6 in the low nibble
+  chunk = (chunk & 0x0F0F0F0F0F0F0F0F) + ((chunk >> 6) & 0x0101010101010101) * 9;
+  chunk = ((chunk & 0x000F000F000F000F) << 4) |
+          ((chunk >> 8) & 0x000F000F000F000F);
+  chunk = ((chunk & 0x000000FF000000FF) << 8) |
+          ((chunk >> 16) & 0x000000FF000000FF);
+  return static_cast<uint32_t>(((chunk & 0xFFFF) << 16) |
+                               ((chunk >> 32) & 0xFFFF));
+}
+
+/**
+ * @brief Correctly rounded double nearest to @p mantissa * 10^@p exponent.
+ *
+ * Exact products of small operands take Clinger's fast path; everything else
+ * goes through the Eisel-Lemire algorithm with a 128-bit truncated power of
+ * five, which settles rounding for any mantissa that was read in full.
+ * Exponents beyond the double range give zero or infinity.
+ */
+double decimalToDouble(uint64_t mantissa, int64_t exponent) noexcept;
+
+} // namespace cxy::numbers
@@ -5,6 +5,7 @@
 #include "cxy/ast/node.hpp"
 #include "cxy/diagnostics.hpp"
 #include "cxy/frontend/lexer.hpp"
+#include "cxy/frontend/token_buffer.hpp"
 #include "cxy/token.hpp"
 #include "cxy/types/registry.hpp"
 
@@ -32,7 +33,7 @@ public:
   ParseErrorType type;
   Location location;
   std::string message;
-  std::vector<TokenKind> expectedTokens;
+  TokenSet expectedTokens;
   Token actualToken;
 
   ParseError(ParseErrorType error_type, Location loc, std::string msg,
@@ -41,9 +42,9 @@ public:
         actualToken(actual) {}
 
   ParseError(ParseErrorType error_type, Location loc, std::string msg,
-             std::vector<TokenKind> expected, Token actual)
+             TokenSet expected, Token actual)
       : type(error_type), location(loc), message(std::move(msg)),
-        expectedTokens(std::move(expected)), actualToken(actual) {}
+        expectedTokens(expected), actualToken(actual) {}
 };
 
 /**
@@ -77,8 +78,44 @@ public:
    */
   void initialize();
 
+  /**
+   * @brief Initialize the parser to read from a pre-lexed token stream.
+   *
+   * The tokens must come from this parser's lexer. They are read by index
+   * instead of being pulled from the lexer one at a time, and lookahead()
+   * accepts any positive offset.
+   *
+   * @param tokens Token stream, which must outlive the parse
+   */
+  void initialize(const TokenBuffer &tokens);
+
   // Phase 2: Expression parsing interface
 
+  /**
+   * @brief Binding strength of the expression operators, loosest first.
+   *
+   * Each parse*Expression entry point below parses an expression of its
+   * level: operands joined by operators of that level or tighter.
+   */
+  enum class Precedence : uint8_t {
+    None,           ///< Does not continue an expression
+    Assignment,     ///< = += -= ... (right-associative)
+    Conditional,    ///< ?: (right-associative)
+    LogicalOr,      ///< ||
+    LogicalAnd,     ///< &&
+    BitwiseOr,      ///< |
+    BitwiseXor,     ///< ^
+    BitwiseAnd,     ///< &
+    Equality,       ///< == !=
+    Relational,     ///< < <= > >=
+    Range,          ///< .. ..< (non-associative)
+    Shift,          ///< << >>
+    Additive,       ///< + -
+    Multiplicative, ///< * / %
+    Cast,           ///< as !: (postfix, takes a type)
+    Unary           ///< Prefix operators and postfix expressions
+  };
+
   /**
    * @brief Parse a complete expression.
    *
@@ -510,20 +547,44 @@ public:
   /**
    * @brief Get the current token being processed.
    *
+   * The window holds compact tokens; this expands tokens_[1] with its
+   * location and literal value. Prefer currentKind() when only the kind
+   * matters.
+   *
    * @return Current token (tokens_[1])
    */
-  Token current() const { return tokens_[1]; }
+  Token current() const { return lexer_.expand(tokens_[1]); }
+
+  /**
+   * @brief Get the kind of the current token without expanding it.
+   */
+  TokenKind currentKind() const { return tokens_[1].kind; }
 
   /**
    * @brief Get a lookahead token at the specified offset.
    *
-   * @param offset Lookahead offset (1 or 2 for LL(3))
-   * @return Lookahead token (tokens_[1 + offset])
+   * @param offset Lookahead offset (1 or 2 for LL(3); any positive offset
+   *               when reading from a TokenBuffer, where inside generic
+   *               arguments each '>>' or '>>=' ahead counts as the two
+   *               tokens advance() will split it into)
+   * @return Lookahead token, or an Error token when out of range
    */
   Token lookahead(int offset = 1) const {
-    if (offset < 1 || offset > 2)
+    if (offset < 1 || (offset > 2 && !tokenBuffer_))
       return Token{};
-    return tokens_[1 + offset];
+    return lexer_.expand(peekToken(offset));
+  }
+
+  /**
+   * @brief Get the kind of a lookahead token without expanding it.
+   *
+   * @param offset Lookahead offset, as for lookahead()
+   * @return Lookahead token kind, or Error when out of range
+   */
+  TokenKind lookaheadKind(int offset = 1) const {
+    if (offset < 1 || (offset > 2 && !tokenBuffer_))
+      return TokenKind::Error;
+    return peekToken(offset).kind;
   }
 
   /**
@@ -531,13 +592,13 @@ public:
    *
    * @return Previous token (tokens_[0])
    */
-  Token previous() const { return tokens_[0]; }
+  Token previous() const { return lexer_.expand(tokens_[0]); }
 
   /**
    * @brief Advance to the next token in the stream.
    *
    * Shifts the token buffer: previous <- current, current <- lookahead1,
-   * lookahead1 <- lookahead2, lookahead2 <- lexer.nextToken()
+   * lookahead1 <- lookahead2, lookahead2 <- lexer.nextCompactToken()
    */
   void advance();
 
@@ -549,15 +610,17 @@ public:
    * @param kind Expected token kind
    * @return True if current token matches
    */
-  bool check(TokenKind kind) const { return current().kind == kind; }
+  bool check(TokenKind kind) const { return tokens_[1].kind == kind; }
 
   /**
    * @brief Check if the current token matches any of the expected kinds.
    *
-   * @param kinds Vector of expected token kinds
-   * @return True if current token matches any of them
+   * @param kinds Set of expected token kinds
+   * @return True if current token is in the set
    */
-  bool checkAny(const std::vector<TokenKind> &kinds) const;
+  bool checkAny(const TokenSet &kinds) const {
+    return kinds.contains(tokens_[1].kind);
+  }
 
   /**
    * @brief Consume the current token if it matches the expected kind.
@@ -590,13 +653,16 @@ public:
   /**
    * @brief Create a parse error for an unexpected token.
    *
+   * Without a custom message, the message lists the expected kinds in
+   * TokenKind order.
+   *
    * @param expected Expected token kind(s)
    * @param message Custom error message
    * @return ParseError object
    */
   ParseError createUnexpectedTokenError(TokenKind expected,
                                         const std::string &message = "");
-  ParseError createUnexpectedTokenError(const std::vector<TokenKind> &expected,
+  ParseError createUnexpectedTokenError(const TokenSet &expected,
                                         const std::string &message = "");
 
   /**
@@ -604,7 +670,7 @@ public:
    *
    * @return True if current token is EOF
    */
-  bool isAtEnd() const { return current().isEof(); }
+  bool isAtEnd() const { return tokens_[1].isEof(); }
 
   // Phase 4: Statement parsing interface
 
@@ -659,10 +725,33 @@ public:
   ast::ASTNode *parseExpressionStatement();
 
 private:
-  // LL(3) sliding window buffer
-  Token
+  // LL(3) sliding window buffer of 16-byte tokens, so shifting it is cheap
+  CompactToken
       tokens_[4]; ///< Token buffer: [previous, current, lookahead1, lookahead2]
 
+  // Pre-lexed token stream, when initialized from one
+  const TokenBuffer *tokenBuffer_ = nullptr;
+  size_t nextIndex_ = 0; ///< Stream index of the token after tokens_[3]
+
+  CompactToken nextToken();
+  CompactToken peekToken(int offset) const;
+  void splitTemplateClose();
+
+  /**
+   * @brief Parse an expression of level @p minimum or tighter.
+   *
+   * One precedence-climbing loop serves every level from assignment down to
+   * cast, so an operand takes a handful of calls to reach its primary
+   * expression instead of one per level.
+   */
+  ast::ASTNode *parseBinaryExpression(Precedence minimum,
+                                      bool withoutStructLiterals);
+
+  /**
+   * @brief Whether a `..` at the current token has no end operand.
+   */
+  bool isOpenRangeEnd() const;
+
   // Core parser state
   Lexer &lexer_;                  ///< Token source
   ArenaAllocator &arena_;         ///< Memory allocator for AST nodes
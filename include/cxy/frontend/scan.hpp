@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace cxy::scan {
+
+/**
+ * @brief Instruction set used by the scanning kernels.
+ *
+ * The best level the CPU supports is picked on first use. SSE2 is the x86-64
+ * baseline; AVX2 is used when the CPU reports it, without requiring the whole
+ * build to target it. Other targets use the scalar kernels.
+ */
+enum class SimdLevel { Scalar, SSE2, AVX2 };
+
+/** @brief Best level supported by this CPU and build. */
+SimdLevel detectSimdLevel() noexcept;
+
+/** @brief Level the kernels currently run at. */
+SimdLevel getSimdLevel() noexcept;
+
+/**
+ * @brief Force a level, for tests and benchmarks.
+ *
+ * Levels above detectSimdLevel() are clamped to it. Not meant to be changed
+ * while another thread is lexing.
+ */
+void setSimdLevel(SimdLevel level) noexcept;
+
+std::string_view toString(SimdLevel level) noexcept;
+
+/**
+ * @brief Extent of a skipped run of bytes and the line breaks inside it.
+ */
+struct Skip {
+  size_t length = 0;    ///< Bytes skipped
+  size_t newlines = 0;  ///< '\n' bytes among them
+  size_t lineStart = 0; ///< Offset just past the last '\n', if newlines > 0
+};
+
+/**
+ * @brief Skip the run of whitespace (' ', '\t', '\r', '\n') at the start of
+ * [data, data + size).
+ */
+Skip skipWhitespace(const char *data, size_t size) noexcept;
+
+/**
+ * @brief Skip up to the first byte equal to @p first, @p second or @p third.
+ *
+ * The stop byte itself is not skipped; if none occurs the whole range is.
+ * One masked compare per 16 or 32 bytes finds it, so long runs of ordinary
+ * bytes such as comment or string bodies cost no per-byte work.
+ */
+Skip skipUntil(const char *data, size_t size, char first, char second,
+               char third) noexcept;
+
+inline Skip skipUntil(const char *data, size_t size, char first,
+                      char second) noexcept {
+  return skipUntil(data, size, first, second, second);
+}
+
+/**
+ * @brief Length of the longest prefix of [data, data + size) that is
+ * well-formed UTF-8.
+ *
+ * The result is the offset of the first byte of the first ill-formed or
+ * truncated sequence, or @p size if there is none, so it always falls on a
+ * character boundary. Overlong forms, surrogates and code points above
+ * U+10FFFF are ill-formed. Runs of ASCII are checked a block at a time; at
+ * SimdLevel::AVX2 multi-byte text is too, with the nibble lookup tables of
+ * Keiser and Lemire.
+ */
+size_t validUtf8Prefix(const char *data, size_t size) noexcept;
+
+} // namespace cxy::scan
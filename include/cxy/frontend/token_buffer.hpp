@@ -0,0 +1,79 @@
+#pragma once
+
+#include "cxy/frontend/lexer.hpp"
+#include "cxy/token.hpp"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace cxy {
+
+/**
+ * @brief A whole buffer lexed up front, stored as a struct of arrays.
+ *
+ * Each CompactToken field lives in its own array, so a scan over token kinds
+ * touches one byte per token, and any token can be reached by index. This
+ * gives the parser unlimited lookahead (Parser::initialize(const
+ * TokenBuffer &)) and lets a range of indices be handed to another worker.
+ *
+ * Tokens are lexed outside any template context, so `>>` always appears as
+ * TokenKind::Shr; the parser splits it where generic arguments close.
+ * Locations and literal values are still resolved through the lexer that
+ * produced the tokens, which must outlive the buffer.
+ */
+class TokenBuffer {
+public:
+  /**
+   * @brief Lex everything the lexer has left, up to and including EoF.
+   */
+  explicit TokenBuffer(Lexer &lexer);
+
+  /**
+   * @brief Number of tokens, including the trailing EoF.
+   */
+  size_t size() const { return kinds_.size(); }
+
+  /**
+   * @brief Token at @p index. Indices past the end read as the EoF token,
+   * mirroring a lexer that keeps returning EoF.
+   */
+  CompactToken operator[](size_t index) const;
+
+  TokenKind kind(size_t index) const { return kinds_[clamp(index)]; }
+
+  std::span<const TokenKind> kinds() const { return kinds_; }
+  std::span<const uint32_t> offsets() const { return offsets_; }
+  std::span<const uint32_t> values() const { return values_; }
+
+  Lexer &getLexer() const { return lexer_; }
+
+  /**
+   * @brief Bytes held by the token arrays.
+   *
+   * Literal values live in the lexer's LiteralTable either way, so this is
+   * the cost on top of streaming, which only ever holds the parser's
+   * four-token window.
+   */
+  size_t memoryUsage() const;
+
+  /// Bytes per token across all arrays
+  static constexpr size_t BYTES_PER_TOKEN =
+      sizeof(TokenKind) + sizeof(uint8_t) + sizeof(FileID) +
+      3 * sizeof(uint32_t);
+
+private:
+  size_t clamp(size_t index) const {
+    return index < kinds_.size() ? index : kinds_.size() - 1;
+  }
+
+  Lexer &lexer_;
+  std::vector<TokenKind> kinds_;
+  std::vector<uint8_t> flags_;
+  std::vector<FileID> files_;
+  std::vector<uint32_t> offsets_;
+  std::vector<uint32_t> lengths_;
+  std::vector<uint32_t> values_;
+};
+
+} // namespace cxy
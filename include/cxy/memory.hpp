@@ -4,7 +4,9 @@
 
 #include <cxy/memory/arena.hpp>
 #include <cxy/memory/arena_ptr.hpp>
+#include <cxy/memory/arena_small_vector.hpp>
 #include <cxy/memory/arena_stl.hpp>
+#include <cxy/memory/concurrent_arena.hpp>
 #include <cxy/strings.hpp>
 
 namespace cxy {
@@ -1,19 +1,34 @@
 #pragma once
 
+#include <array>
+#include <concepts>
 #include <cstddef>
 #include <memory>
 #include <new>
+#include <type_traits>
 #include <vector>
 
 namespace cxy {
 
+// Block sizing and backing-memory policy for ArenaAllocator
+struct ArenaOptions {
+  size_t initialBlockSize = 64 * 1024;
+  size_t maxBlockSize = 64 * 1024 * 1024; // Cap for geometric growth
+  size_t growthFactor = 2;                // 1 keeps every block the same size
+  size_t mmapThreshold = 1024 * 1024;     // Blocks this large come from mmap
+  bool hugePages = false; // Advise transparent huge pages on mapped blocks
+  bool prefault = false;  // Populate mapped blocks up front
+};
+
 struct MemoryBlock {
   void *data;
   size_t size;
   size_t used;
   MemoryBlock *next;
+  bool mapped; // Backed by mmap rather than the C heap
 
-  explicit MemoryBlock(size_t blockSize);
+  explicit MemoryBlock(size_t blockSize, bool map = false,
+                       bool hugePages = false, bool prefault = false);
   ~MemoryBlock();
 
   // Non-copyable, movable
@@ -32,20 +47,65 @@ struct MemoryBlock {
 private:
   [[nodiscard]] static size_t alignAddress(size_t address,
                                            size_t alignment) noexcept;
+  void release() noexcept;
+};
+
+// Types declaring `using ArenaTriviallyDestructible = <the type itself>;`
+// promise to be trivially destructible. Naming the type keeps the promise
+// from being inherited by derived classes. With
+// CXY_ARENA_CHECK_TRIVIAL_DESTRUCTORS defined, constructing one that is not
+// fails to compile instead of silently taking a finalizer.
+template <typename T>
+concept ArenaTrivialDestructionExpected =
+    std::same_as<typename T::ArenaTriviallyDestructible, T>;
+
+// Holds unless T makes that promise and breaks it. A class of its own so
+// that a failed check names T.
+template <typename T> struct ArenaTriviallyDestructibleAsPromised {
+  static constexpr bool value = !ArenaTrivialDestructionExpected<T> ||
+                                std::is_trivially_destructible_v<T>;
 };
 
 class ArenaAllocator {
 private:
+  // Destructor to run for an object (or array) built by construct(). Records
+  // live in the arena and form a stack, newest first.
+  struct Finalizer {
+    void (*destroy)(void *object, size_t count) noexcept;
+    void *object;
+    size_t count;
+    Finalizer *next;
+  };
+
+  // Buffers handed back through deallocate(), kept in power-of-two size
+  // classes from 16 bytes to 512KB. A buffer of `size` bytes sits in the
+  // largest class that fits inside it.
+  struct FreeBuffer {
+    FreeBuffer *next;
+    size_t size;
+  };
+
+  static constexpr size_t MIN_SIZE_CLASS_SHIFT = 4;
+  static constexpr size_t SIZE_CLASS_COUNT = 16;
+
   MemoryBlock *firstBlock;
+  MemoryBlock *lastBlock;
   MemoryBlock *currentBlock;
-  size_t defaultBlockSize;
+  ArenaOptions options;
+  size_t nextBlockSize; // Size of the next regular block (grows geometrically)
+  size_t blockCount;
   size_t totalAllocated;
   size_t totalUsed;
+  Finalizer *finalizers;
+  size_t finalizerCount;
+  std::array<FreeBuffer *, SIZE_CLASS_COUNT> freeBuffers;
+  size_t recyclableBytes; // Bytes parked in freeBuffers
 
   friend class StackArena; // Allow StackArena to access private members
 
 public:
   explicit ArenaAllocator(size_t blockSize = 64 * 1024); // 64KB default
+  explicit ArenaAllocator(const ArenaOptions &arenaOptions);
   ~ArenaAllocator();
 
   // Non-copyable, movable
@@ -58,6 +118,31 @@ public:
   [[nodiscard]] void *allocate(size_t size,
                                size_t alignment = alignof(std::max_align_t));
 
+  // Allocation that reuses buffers released through deallocate() before
+  // bumping. Meant for growable containers; plain objects should use
+  // allocate().
+  [[nodiscard]] void *
+  allocateRecycled(size_t size, size_t alignment = alignof(std::max_align_t));
+
+  // Give a buffer back. The most recent allocation is rolled back in place,
+  // anything else is kept for allocateRecycled(). Buffers must be returned
+  // before the arena is reset or a checkpoint below them is restored.
+  void deallocate(void *ptr, size_t size) noexcept;
+
+  // Whether [ptr, ptr + size) lies in memory handed out since the last
+  // reset() or checkpoint restore. Walks the live blocks; deallocate()
+  // asserts it in debug builds.
+  [[nodiscard]] bool isLive(const void *ptr, size_t size) const noexcept;
+
+  // Grow the most recent allocation in place when its block has room
+  [[nodiscard]] bool tryExtend(void *ptr, size_t oldSize,
+                               size_t newSize) noexcept;
+
+  // Resize a buffer of trivially copyable bytes, in place when possible
+  [[nodiscard]] void *
+  reallocate(void *ptr, size_t oldSize, size_t newSize,
+             size_t alignment = alignof(std::max_align_t));
+
   // Typed allocation helpers
   template <typename T> [[nodiscard]] T *allocate() {
     return static_cast<T *>(allocate(sizeof(T), alignof(T)));
@@ -67,22 +152,49 @@ public:
     return static_cast<T *>(allocate(sizeof(T) * count, alignof(T)));
   }
 
-  // Construction helpers using C++23 perfect forwarding
+  // Construction helpers using C++23 perfect forwarding. Objects that are not
+  // trivially destructible are destroyed on reset(), clear() or destruction,
+  // newest first.
   template <typename T, typename... Args>
   [[nodiscard]] T *construct(Args &&...args)
     requires std::constructible_from<T, Args...>
   {
+    checkTrivialDestruction<T>();
     T *ptr = allocate<T>();
-    return new (ptr) T(std::forward<Args>(args)...);
+    if constexpr (std::is_trivially_destructible_v<T>) {
+      return new (ptr) T(std::forward<Args>(args)...);
+    } else {
+      auto *finalizer = allocate<Finalizer>();
+      new (ptr) T(std::forward<Args>(args)...);
+      registerFinalizer(finalizer, &destroyObjects<T>, ptr, 1);
+      return ptr;
+    }
   }
 
   template <typename T, typename... Args>
   [[nodiscard]] T *constructArray(size_t count, Args &&...args)
     requires std::constructible_from<T, Args...>
   {
+    checkTrivialDestruction<T>();
     T *ptr = allocateArray<T>(count);
-    for (size_t i = 0; i < count; ++i) {
-      new (ptr + i) T(args...);
+    if constexpr (std::is_trivially_destructible_v<T>) {
+      for (size_t i = 0; i < count; ++i) {
+        new (ptr + i) T(args...);
+      }
+    } else {
+      auto *finalizer = allocate<Finalizer>();
+      size_t constructed = 0;
+      try {
+        for (; constructed < count; ++constructed) {
+          new (ptr + constructed) T(args...);
+        }
+      } catch (...) {
+        destroyObjects<T>(ptr, constructed);
+        throw;
+      }
+      if (count > 0) {
+        registerFinalizer(finalizer, &destroyObjects<T>, ptr, count);
+      }
     }
     return ptr;
   }
@@ -95,20 +207,62 @@ public:
   [[nodiscard]] size_t getTotalAllocated() const noexcept {
     return totalAllocated;
   }
+  // Live bytes; buffers given back through deallocate() no longer count
   [[nodiscard]] size_t getTotalUsed() const noexcept { return totalUsed; }
+  [[nodiscard]] size_t getRecyclableBytes() const noexcept {
+    return recyclableBytes;
+  }
   [[nodiscard]] size_t getWastePercentage() const noexcept;
-  [[nodiscard]] size_t getBlockCount() const noexcept;
+  [[nodiscard]] size_t getBlockCount() const noexcept { return blockCount; }
+  [[nodiscard]] size_t getFinalizerCount() const noexcept {
+    return finalizerCount;
+  }
+  [[nodiscard]] const ArenaOptions &getOptions() const noexcept {
+    return options;
+  }
 
 private:
+  template <typename T> static constexpr void checkTrivialDestruction() {
+#ifdef CXY_ARENA_CHECK_TRIVIAL_DESTRUCTORS
+    static_assert(ArenaTriviallyDestructibleAsPromised<T>::value,
+                  "type marked ArenaTriviallyDestructible needs a finalizer");
+#endif
+  }
+
+  template <typename T>
+  static void destroyObjects(void *object, size_t count) noexcept {
+    auto *objects = static_cast<T *>(object);
+    for (size_t i = count; i > 0; --i) {
+      objects[i - 1].~T();
+    }
+  }
+
+  void registerFinalizer(Finalizer *finalizer,
+                         void (*destroy)(void *, size_t) noexcept,
+                         void *object, size_t count) noexcept {
+    *finalizer = {destroy, object, count, finalizers};
+    finalizers = finalizer;
+    ++finalizerCount;
+  }
+
+  // Run finalizers registered after `until`, newest first
+  void runFinalizers(Finalizer *until = nullptr) noexcept;
+  void dropFreeBuffers() noexcept;
+  [[nodiscard]] bool isTopAllocation(const void *ptr,
+                                     size_t size) const noexcept;
   MemoryBlock *allocateNewBlock(size_t minSize);
   void freeAllBlocks() noexcept;
 };
 
 class StackArena : public ArenaAllocator {
 public:
+  // Everything needed to rewind in constant time
   struct Checkpoint {
     MemoryBlock *block;
     size_t offset;
+    size_t totalUsed;      // Arena-wide usage when saved
+    Finalizer *finalizers; // Objects built after this point die on restore
+    size_t depth;          // Position in the checkpoint stack
 
     bool operator==(const Checkpoint &) const = default;
   };
@@ -172,4 +326,26 @@ public:
   }
 };
 
+// Short-lived temporaries on a per-thread StackArena. Opening a ScratchArena
+// saves a checkpoint and closing it rewinds, so scopes nest like stack frames
+// and nothing touches the long-lived arenas. Each thread owns two scratch
+// stacks; a scope that must keep allocating into an outer scratch arena while
+// it is open passes that arena as `conflict` and gets the other stack.
+class ScratchArena {
+  StackArena *stack;
+
+public:
+  explicit ScratchArena(const ArenaAllocator *conflict = nullptr);
+  ~ScratchArena();
+
+  // Bound to a checkpoint on a thread-local stack, so pinned in place
+  ScratchArena(const ScratchArena &) = delete;
+  ScratchArena &operator=(const ScratchArena &) = delete;
+  ScratchArena(ScratchArena &&) = delete;
+  ScratchArena &operator=(ScratchArena &&) = delete;
+
+  [[nodiscard]] StackArena &get() const noexcept { return *stack; }
+  operator ArenaAllocator &() const noexcept { return *stack; }
+};
+
 } // namespace cxy
@@ -0,0 +1,338 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <cxy/memory/arena.hpp>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+namespace cxy {
+
+namespace detail {
+
+// Uninitialized inline slots of an ArenaSmallVector
+template <typename T, size_t N> struct InlineSlots {
+  T slots[N];
+
+  T *data() noexcept { return slots; }
+  const T *data() const noexcept { return slots; }
+};
+
+// No slots take no space: std::array<T, 0> still takes a byte, which pads
+// the vector by a whole pointer
+template <typename T> struct InlineSlots<T, 0> {
+  T *data() noexcept { return nullptr; }
+  const T *data() const noexcept { return nullptr; }
+};
+
+} // namespace detail
+
+// Vector of trivially copyable values that keeps its first N elements inline
+// and spills to its arena after that. Spilled buffers grow in place when they
+// are the arena's most recent allocation and are handed back to the arena's
+// size-class free lists when outgrown, so the type stays trivially
+// destructible and never needs an arena finalizer.
+template <typename T, size_t N>
+  requires std::is_trivially_copyable_v<T> &&
+           std::is_trivially_default_constructible_v<T>
+class ArenaSmallVector {
+public:
+  using value_type = T;
+  using size_type = size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = T &;
+  using const_reference = const T &;
+  using pointer = T *;
+  using const_pointer = const T *;
+  using iterator = T *;
+  using const_iterator = const T *;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+private:
+  T *elements;
+  uint32_t count;
+  uint32_t reserved;
+  ArenaAllocator *arena;
+  [[no_unique_address]] detail::InlineSlots<T, N> inlineStorage;
+
+public:
+  explicit ArenaSmallVector(ArenaAllocator &a) noexcept
+      : elements(nullptr), count(0), reserved(N), arena(&a) {
+    // Inline slots stay uninitialized; only their address is taken
+    elements = inlineStorage.data();
+  }
+
+  ArenaSmallVector(std::initializer_list<T> init, ArenaAllocator &a)
+      : ArenaSmallVector(a) {
+    assign(init.begin(), init.end());
+  }
+
+  ArenaSmallVector(const ArenaSmallVector &other)
+      : ArenaSmallVector(*other.arena) {
+    assign(other.begin(), other.end());
+  }
+
+  ArenaSmallVector(ArenaSmallVector &&other) noexcept
+      : ArenaSmallVector(*other.arena) {
+    takeFrom(other);
+  }
+
+  ArenaSmallVector &operator=(const ArenaSmallVector &other) {
+    if (this != &other) {
+      assign(other.begin(), other.end());
+    }
+    return *this;
+  }
+
+  ArenaSmallVector &operator=(ArenaSmallVector &&other) noexcept {
+    if (this != &other) {
+      if (other.arena == arena) {
+        release();
+        takeFrom(other);
+      } else {
+        // Buffers belong to their arena, so copy across arenas
+        assign(other.begin(), other.end());
+        other.clear();
+      }
+    }
+    return *this;
+  }
+
+  ArenaSmallVector &operator=(std::initializer_list<T> init) {
+    assign(init.begin(), init.end());
+    return *this;
+  }
+
+  template <std::input_iterator It> void assign(It first, It last) {
+    clear();
+    insert(end(), first, last);
+  }
+
+  void assign(std::initializer_list<T> init) {
+    assign(init.begin(), init.end());
+  }
+
+  // Element access
+  [[nodiscard]] reference operator[](size_type index) noexcept {
+    assert(index < count);
+    return elements[index];
+  }
+  [[nodiscard]] const_reference operator[](size_type index) const noexcept {
+    assert(index < count);
+    return elements[index];
+  }
+
+  [[nodiscard]] reference at(size_type index) {
+    if (index >= count) {
+      throw std::out_of_range("ArenaSmallVector index out of range");
+    }
+    return elements[index];
+  }
+  [[nodiscard]] const_reference at(size_type index) const {
+    if (index >= count) {
+      throw std::out_of_range("ArenaSmallVector index out of range");
+    }
+    return elements[index];
+  }
+
+  [[nodiscard]] reference front() noexcept { return (*this)[0]; }
+  [[nodiscard]] const_reference front() const noexcept { return (*this)[0]; }
+  [[nodiscard]] reference back() noexcept { return (*this)[count - 1]; }
+  [[nodiscard]] const_reference back() const noexcept {
+    return (*this)[count - 1];
+  }
+
+  [[nodiscard]] T *data() noexcept { return elements; }
+  [[nodiscard]] const T *data() const noexcept { return elements; }
+
+  // Iterators
+  [[nodiscard]] iterator begin() noexcept { return elements; }
+  [[nodiscard]] const_iterator begin() const noexcept { return elements; }
+  [[nodiscard]] const_iterator cbegin() const noexcept { return elements; }
+  [[nodiscard]] iterator end() noexcept { return elements + count; }
+  [[nodiscard]] const_iterator end() const noexcept {
+    return elements + count;
+  }
+  [[nodiscard]] const_iterator cend() const noexcept {
+    return elements + count;
+  }
+  [[nodiscard]] reverse_iterator rbegin() noexcept {
+    return reverse_iterator(end());
+  }
+  [[nodiscard]] const_reverse_iterator rbegin() const noexcept {
+    return const_reverse_iterator(end());
+  }
+  [[nodiscard]] reverse_iterator rend() noexcept {
+    return reverse_iterator(begin());
+  }
+  [[nodiscard]] const_reverse_iterator rend() const noexcept {
+    return const_reverse_iterator(begin());
+  }
+
+  // Capacity
+  [[nodiscard]] bool empty() const noexcept { return count == 0; }
+  [[nodiscard]] size_type size() const noexcept { return count; }
+  [[nodiscard]] size_type capacity() const noexcept { return reserved; }
+  [[nodiscard]] static constexpr size_type inlineCapacity() noexcept {
+    return N;
+  }
+  [[nodiscard]] bool isInline() const noexcept {
+    return elements == inlineStorage.data();
+  }
+  [[nodiscard]] ArenaAllocator *getArena() const noexcept { return arena; }
+
+  void reserve(size_type newCapacity) {
+    if (newCapacity > reserved) {
+      grow(newCapacity);
+    }
+  }
+
+  // Modifiers
+  void push_back(const T &value) {
+    if (count == reserved) {
+      // `value` may live in our own buffer, which growing can move
+      const T copy = value;
+      grow(count + 1);
+      elements[count++] = copy;
+      return;
+    }
+    elements[count++] = value;
+  }
+
+  template <typename... Args> reference emplace_back(Args &&...args) {
+    push_back(T(std::forward<Args>(args)...));
+    return back();
+  }
+
+  void pop_back() noexcept {
+    assert(count > 0);
+    --count;
+  }
+
+  iterator insert(const_iterator pos, const T &value) {
+    const auto index = static_cast<size_type>(pos - elements);
+    assert(index <= count);
+    const T copy = value;
+    if (count == reserved) {
+      grow(count + 1);
+    }
+    if (index < count) {
+      std::memmove(elements + index + 1, elements + index,
+                   (count - index) * sizeof(T));
+    }
+    elements[index] = copy;
+    ++count;
+    return elements + index;
+  }
+
+  template <std::input_iterator It>
+  iterator insert(const_iterator pos, It first, It last) {
+    const auto index = static_cast<size_type>(pos - elements);
+    assert(index <= count);
+    if constexpr (std::forward_iterator<It>) {
+      const auto extra = static_cast<size_type>(std::distance(first, last));
+      if (count + extra > reserved) {
+        grow(count + extra);
+      }
+      if (index < count) {
+        std::memmove(elements + index + extra, elements + index,
+                     (count - index) * sizeof(T));
+      }
+      std::copy(first, last, elements + index);
+      count += static_cast<uint32_t>(extra);
+    } else {
+      for (auto at = index; first != last; ++first, ++at) {
+        insert(elements + at, *first);
+      }
+    }
+    return elements + index;
+  }
+
+  iterator erase(const_iterator pos) noexcept { return erase(pos, pos + 1); }
+
+  iterator erase(const_iterator first, const_iterator last) noexcept {
+    const auto index = static_cast<size_type>(first - elements);
+    const auto removed = static_cast<size_type>(last - first);
+    assert(index + removed <= count);
+    if (index + removed < count) {
+      std::memmove(elements + index, elements + index + removed,
+                   (count - index - removed) * sizeof(T));
+    }
+    count -= static_cast<uint32_t>(removed);
+    return elements + index;
+  }
+
+  void resize(size_type newSize, const T &value = T{}) {
+    if (newSize > reserved) {
+      grow(newSize);
+    }
+    std::fill(elements + std::min<size_type>(count, newSize),
+              elements + newSize, value);
+    count = static_cast<uint32_t>(newSize);
+  }
+
+  void clear() noexcept { count = 0; }
+
+  [[nodiscard]] bool operator==(const ArenaSmallVector &other) const noexcept {
+    return std::equal(begin(), end(), other.begin(), other.end());
+  }
+
+private:
+  void grow(size_type minCapacity) {
+    if (minCapacity > std::numeric_limits<uint32_t>::max()) {
+      throw std::length_error("ArenaSmallVector capacity exceeded");
+    }
+    const size_type newCapacity = std::min<size_type>(
+        std::max<size_type>({minCapacity, size_type{reserved} * 2, 4}),
+        std::numeric_limits<uint32_t>::max());
+
+    if (isInline()) {
+      auto *spilled = static_cast<T *>(
+          arena->allocateRecycled(newCapacity * sizeof(T), alignof(T)));
+      if (count > 0) {
+        std::memcpy(spilled, elements, count * sizeof(T));
+      }
+      elements = spilled;
+    } else {
+      elements = static_cast<T *>(arena->reallocate(
+          elements, reserved * sizeof(T), newCapacity * sizeof(T), alignof(T)));
+    }
+    reserved = static_cast<uint32_t>(newCapacity);
+  }
+
+  // Hand a spilled buffer back to the arena and fall back to inline storage
+  void release() noexcept {
+    if (!isInline()) {
+      arena->deallocate(elements, reserved * sizeof(T));
+    }
+    elements = inlineStorage.data();
+    count = 0;
+    reserved = N;
+  }
+
+  void takeFrom(ArenaSmallVector &other) noexcept {
+    if (other.isInline()) {
+      std::copy(other.begin(), other.end(), inlineStorage.data());
+      count = other.count;
+    } else {
+      elements = other.elements;
+      count = other.count;
+      reserved = other.reserved;
+    }
+    other.elements = other.inlineStorage.data();
+    other.count = 0;
+    other.reserved = N;
+  }
+};
+
+// Without inline slots the vector is a pointer, two counts and its arena
+static_assert(sizeof(ArenaSmallVector<void *, 0>) ==
+              sizeof(void *) + 2 * sizeof(uint32_t) + sizeof(ArenaAllocator *));
+
+} // namespace cxy
@@ -6,6 +6,7 @@
 #include <map>
 #include <memory>
 #include <set>
+#include <string>
 #include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
@@ -58,12 +59,34 @@ public:
       throw std::bad_array_new_length{};
     }
 
-    return static_cast<pointer>(arena->allocate(n * sizeof(T), alignof(T)));
+    return static_cast<pointer>(
+        arena->allocateRecycled(n * sizeof(T), alignof(T)));
   }
 
-  void deallocate(pointer, size_type) noexcept {
-    // Arena allocator doesn't support individual deallocation
-    // This is intentionally a no-op
+  // Released buffers are rolled back if they were the last allocation and
+  // otherwise recycled by size class for the next container that grows
+  void deallocate(pointer p, size_type n) noexcept {
+    arena->deallocate(p, n * sizeof(T));
+  }
+
+  // In-place growth for arena-aware containers; std containers never call
+  // these since they always allocate the new buffer before releasing the old
+  [[nodiscard]] bool tryExtend(pointer p, size_type oldN,
+                               size_type newN) noexcept {
+    if (newN > std::numeric_limits<size_type>::max() / sizeof(T)) {
+      return false;
+    }
+    return arena->tryExtend(p, oldN * sizeof(T), newN * sizeof(T));
+  }
+
+  [[nodiscard]] pointer reallocate(pointer p, size_type oldN, size_type newN)
+    requires std::is_trivially_copyable_v<T>
+  {
+    if (newN > std::numeric_limits<size_type>::max() / sizeof(T)) {
+      throw std::bad_array_new_length{};
+    }
+    return static_cast<pointer>(arena->reallocate(p, oldN * sizeof(T),
+                                                  newN * sizeof(T), alignof(T)));
   }
 
   // C++20 style construct/destroy (using placement new)
@@ -103,6 +126,9 @@ public:
 // Type aliases for common containers using C++23 features
 template <typename T> using ArenaVector = std::vector<T, ArenaSTLAllocator<T>>;
 
+using ArenaString =
+    std::basic_string<char, std::char_traits<char>, ArenaSTLAllocator<char>>;
+
 template <typename Key, typename Value, typename Hash = std::hash<Key>,
           typename KeyEqual = std::equal_to<Key>>
 using ArenaUnorderedMap =
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cxy/memory/arena.hpp>
+#include <mutex>
+#include <type_traits>
+
+namespace cxy {
+
+// Arena shared by several worker threads. Every thread bump-allocates from
+// its own chunk without taking a lock; chunks are carved from a block pool
+// owned by the arena, so allocations outlive the thread that made them and
+// are released together when the arena is reset, cleared or destroyed.
+class ConcurrentArena {
+private:
+  // Per-thread allocation state. Owned by the arena, never by the thread.
+  struct ThreadCache {
+    char *cursor = nullptr;
+    char *limit = nullptr;
+    std::atomic<size_t> used{0}; // Written only by the owning thread
+    ThreadCache *next = nullptr;
+  };
+
+  // Most recently used (arena, cache) pair of the calling thread. Zero
+  // initialized as a thread_local, and arena ids start at 1.
+  struct LocalSlot {
+    uint64_t arenaId;
+    ThreadCache *cache;
+  };
+
+  static inline thread_local LocalSlot localSlot;
+
+  uint64_t arenaId; // Never reused, so stale thread slots never match
+  const size_t chunkSize;
+  const size_t poolBlockSize;
+
+  mutable std::mutex poolMutex;   // Guards everything below
+  MemoryBlock *firstPoolBlock;    // Blocks chunks are carved from
+  MemoryBlock *lastPoolBlock;
+  MemoryBlock *currentPoolBlock;  // Block the next chunk is carved from
+  MemoryBlock *largeBlocks;       // Dedicated blocks for large requests
+  ThreadCache *threadCaches;      // Every cache handed out so far
+  size_t threadCacheCount;
+  std::atomic<size_t> totalAllocated;
+  std::atomic<size_t> largeUsed;
+
+public:
+  explicit ConcurrentArena(size_t chunkSize = 64 * 1024,
+                           size_t blockSize = 1024 * 1024); // 1MB pool blocks
+  ~ConcurrentArena();
+
+  // Threads hold pointers into the arena, so it can neither move nor copy
+  ConcurrentArena(const ConcurrentArena &) = delete;
+  ConcurrentArena &operator=(const ConcurrentArena &) = delete;
+  ConcurrentArena(ConcurrentArena &&) = delete;
+  ConcurrentArena &operator=(ConcurrentArena &&) = delete;
+
+  // Core allocation interface, safe to call from any thread
+  [[nodiscard]] void *allocate(size_t size,
+                               size_t alignment = alignof(std::max_align_t)) {
+    if (size == 0) {
+      return nullptr;
+    }
+
+    ThreadCache *cache = localSlot.arenaId == arenaId ? localSlot.cache
+                                                      : bindThreadCache();
+    const auto cursor = reinterpret_cast<uintptr_t>(cache->cursor);
+    const auto aligned = (cursor + alignment - 1) & ~(alignment - 1);
+    if (cache->cursor && aligned + size <=
+                             reinterpret_cast<uintptr_t>(cache->limit)) {
+      cache->cursor = reinterpret_cast<char *>(aligned + size);
+      cache->used.store(cache->used.load(std::memory_order_relaxed) + size,
+                        std::memory_order_relaxed);
+      return reinterpret_cast<void *>(aligned);
+    }
+
+    return allocateSlow(*cache, size, alignment);
+  }
+
+  // Typed allocation helpers
+  template <typename T> [[nodiscard]] T *allocate() {
+    return static_cast<T *>(allocate(sizeof(T), alignof(T)));
+  }
+
+  template <typename T> [[nodiscard]] T *allocateArray(size_t count) {
+    return static_cast<T *>(allocate(sizeof(T) * count, alignof(T)));
+  }
+
+  // Construction helpers. Unlike ArenaAllocator there is no finalizer list,
+  // so only trivially destructible types are accepted.
+  template <typename T, typename... Args>
+  [[nodiscard]] T *construct(Args &&...args)
+    requires std::constructible_from<T, Args...>
+  {
+    static_assert(std::is_trivially_destructible_v<T>,
+                  "ConcurrentArena never runs destructors");
+    T *ptr = allocate<T>();
+    return new (ptr) T(std::forward<Args>(args)...);
+  }
+
+  template <typename T, typename... Args>
+  [[nodiscard]] T *constructArray(size_t count, Args &&...args)
+    requires std::constructible_from<T, Args...>
+  {
+    static_assert(std::is_trivially_destructible_v<T>,
+                  "ConcurrentArena never runs destructors");
+    T *ptr = allocateArray<T>(count);
+    for (size_t i = 0; i < count; ++i) {
+      new (ptr + i) T(args...);
+    }
+    return ptr;
+  }
+
+  // Memory management. Callers must ensure no thread is allocating.
+  void reset() noexcept; // Drop all allocations, keep pool blocks
+  void clear() noexcept; // Free all blocks
+
+  // Statistics (approximate while other threads are allocating)
+  [[nodiscard]] size_t getTotalAllocated() const noexcept {
+    return totalAllocated.load(std::memory_order_relaxed);
+  }
+  [[nodiscard]] size_t getTotalUsed() const noexcept;
+  [[nodiscard]] size_t getWastePercentage() const noexcept;
+  [[nodiscard]] size_t getBlockCount() const noexcept;
+  [[nodiscard]] size_t getThreadCacheCount() const noexcept;
+  [[nodiscard]] size_t getChunkSize() const noexcept { return chunkSize; }
+
+private:
+  ThreadCache *bindThreadCache();
+  void *allocateSlow(ThreadCache &cache, size_t size, size_t alignment);
+  void *allocateLarge(size_t size, size_t alignment);
+  void refillChunk(ThreadCache &cache);
+  void freeBlocks(MemoryBlock *block) noexcept;
+  void freeThreadCaches() noexcept;
+};
+
+} // namespace cxy
@@ -2,14 +2,19 @@
 
 #include <compare>
 #include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <functional>
+#include <memory>
+#include <span>
 #include <string>
 #include <string_view>
-#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <cxy/memory/arena.hpp>
-#include <cxy/memory/arena_stl.hpp>
+#include <cxy/strings/concurrent_table.hpp>
+#include <cxy/strings/hash.hpp>
 
 // Define builtin names that need to be interned
 #define CXY_BUILTIN_NAMES(f, ff)    \
@@ -110,18 +115,18 @@ namespace cxy {
 // Forward declaration
 class StringInterner;
 class InternedString;
+struct BuiltinTable;
 
-// Static builtin name accessors for easy access
+// Static builtin name accessors for easy access. These are constant
+// initialized from the builtin string table (see BuiltinStrings), which every
+// interner created with preInternKeywords is seeded with, so they compare
+// equal to the same name interned by any such interner.
 namespace S {
-  // Forward declare all builtin names as extern
   #define DECLARE_BUILTIN_NAME(name) extern const InternedString S_##name;
   #define DECLARE_BUILTIN_NAME_STR(name, str) extern const InternedString S_##name;
   CXY_BUILTIN_NAMES(DECLARE_BUILTIN_NAME, DECLARE_BUILTIN_NAME_STR)
   #undef DECLARE_BUILTIN_NAME
   #undef DECLARE_BUILTIN_NAME_STR
-  
-  // Initialize all builtin names (defined in strings.cpp)
-  void initializeBuiltinNames(StringInterner& interner);
 }
 
 class InternedString {
@@ -131,20 +136,24 @@ private:
   size_t hash;      // Pre-computed hash for fast lookups
 
   // Private constructor - only StringInterner can create these
-  InternedString(const char *str, size_t len, size_t h)
+  constexpr InternedString(const char *str, size_t len, size_t h)
       : data(str), length(len), hash(h) {}
 
   friend class StringInterner;
+  friend class ConcurrentStringTable;
+  friend struct BuiltinTable; // Builds the constant builtin strings
 
 public:
   // Default constructor for empty string
-  InternedString() : data(nullptr), length(0), hash(0) {}
+  constexpr InternedString() : data(nullptr), length(0), hash(0) {}
 
   // Accessors
-  [[nodiscard]] const char *c_str() const noexcept { return data ? data : ""; }
-  [[nodiscard]] size_t size() const noexcept { return length; }
-  [[nodiscard]] size_t getHash() const noexcept { return hash; }
-  [[nodiscard]] bool empty() const noexcept { return length == 0; }
+  [[nodiscard]] constexpr const char *c_str() const noexcept {
+    return data ? data : "";
+  }
+  [[nodiscard]] constexpr size_t size() const noexcept { return length; }
+  [[nodiscard]] constexpr size_t getHash() const noexcept { return hash; }
+  [[nodiscard]] constexpr bool empty() const noexcept { return length == 0; }
 
   // Fast O(1) equality comparison
   bool operator==(const InternedString &other) const noexcept {
@@ -164,7 +173,7 @@ public:
   }
 
   // String view conversion
-  [[nodiscard]] std::string_view view() const noexcept {
+  [[nodiscard]] constexpr std::string_view view() const noexcept {
     return std::string_view(c_str(), length);
   }
 
@@ -181,27 +190,99 @@ public:
   }
 };
 
-class StringInterner {
+// Dense 4-byte handle to a string interned by a StringInterner. Ids are
+// handed out in interning order starting at 1, with 0 standing for the empty
+// string, so they can index per-pass side tables directly (see SymbolMap).
+// An id is only meaningful to the interner that produced it.
+class SymbolId {
 private:
-  ArenaAllocator &arena;
+  uint32_t value = 0;
+
+public:
+  constexpr SymbolId() noexcept = default;
+  constexpr explicit SymbolId(uint32_t index) noexcept : value(index) {}
+
+  [[nodiscard]] constexpr uint32_t index() const noexcept { return value; }
+  [[nodiscard]] constexpr bool empty() const noexcept { return value == 0; }
+
+  constexpr auto operator<=>(const SymbolId &) const noexcept = default;
 
-  // Use arena-allocated map to store string mappings
-  using StringMap = std::unordered_map<
-      std::string_view, InternedString, std::hash<std::string_view>,
-      std::equal_to<std::string_view>,
-      ArenaSTLAllocator<std::pair<const std::string_view, InternedString>>>;
+  struct Hash {
+    size_t operator()(SymbolId id) const noexcept { return id.value; }
+  };
+};
+
+static_assert(sizeof(SymbolId) == 4);
+
+// Array indexed by SymbolId, for per-pass data about identifiers. Missing
+// entries read as a default constructed T; writing grows the array to cover
+// the id.
+template <typename T> class SymbolMap {
+private:
+  std::vector<T> values;
+  T missing{};
 
-  StringMap internedStrings;
+public:
+  SymbolMap() = default;
+  // Size up front for every id an interner has handed out so far
+  explicit SymbolMap(size_t symbolLimit) : values(symbolLimit) {}
+
+  [[nodiscard]] T &operator[](SymbolId id) {
+    if (id.index() >= values.size()) {
+      values.resize(static_cast<size_t>(id.index()) + 1);
+    }
+    return values[id.index()];
+  }
+
+  [[nodiscard]] const T &operator[](SymbolId id) const noexcept {
+    return id.index() < values.size() ? values[id.index()] : missing;
+  }
+
+  [[nodiscard]] size_t size() const noexcept { return values.size(); }
+  void clear() noexcept { values.clear(); }
+};
+
+// How a StringInterner may be used
+enum class InternerMode {
+  SingleThreaded, // Strings live in the caller's arena
+  Concurrent,     // Any thread may intern; strings live as long as the interner
+};
+
+class StringInterner {
+private:
+  ArenaAllocator &arena;
+  std::unique_ptr<ConcurrentStringTable> concurrentTable; // Concurrent mode
+
+  // Flat open-addressing table. Each slot has a control byte that is either
+  // EMPTY_CONTROL or the low seven bits of the slot's hash; probing matches
+  // a whole group of control bytes at once and only compares strings whose
+  // seven bits agree. Slots hold symbol ids into `symbols`, the dense table
+  // of every interned string in interning order, with the empty string at
+  // id 0. Both live on the heap so rehashing does not strand old tables in
+  // the arena; string data stays in the arena.
+  static constexpr size_t GROUP_SIZE = 16;
+  static constexpr size_t INITIAL_CAPACITY = 512;
+  static constexpr int8_t EMPTY_CONTROL = -128;
+
+  std::unique_ptr<int8_t[]> controls;
+  std::unique_ptr<uint32_t[]> slots;
+  std::vector<InternedString> symbols;
+  size_t capacity = 0;    // Power of two, multiple of GROUP_SIZE
+  size_t count = 0;
+  size_t growthLimit = 0; // Rehash past 7/8 load
 
 public:
-  explicit StringInterner(ArenaAllocator &allocator, bool preInternKeywords = true)
-      : arena(allocator),
-        internedStrings(
-            ArenaSTLAllocator<
-                std::pair<const std::string_view, InternedString>>(allocator)) {
+  explicit StringInterner(ArenaAllocator &allocator, bool preInternKeywords = true,
+                          InternerMode mode = InternerMode::SingleThreaded)
+      : arena(allocator) {
+    if (mode == InternerMode::Concurrent) {
+      concurrentTable = std::make_unique<ConcurrentStringTable>();
+    } else {
+      symbols.emplace_back();
+      rehash(INITIAL_CAPACITY);
+    }
     if (preInternKeywords) {
-      internCommonStrings();
-      S::initializeBuiltinNames(*this);
+      seedBuiltins();
     }
   }
 
@@ -210,11 +291,26 @@ public:
   // Non-copyable, movable (but move assignment deleted due to reference member)
   StringInterner(const StringInterner &) = delete;
   StringInterner &operator=(const StringInterner &) = delete;
-  StringInterner(StringInterner &&) = default;
+  StringInterner(StringInterner &&other) noexcept
+      : arena(other.arena),
+        concurrentTable(std::move(other.concurrentTable)),
+        controls(std::move(other.controls)),
+        slots(std::move(other.slots)),
+        symbols(std::move(other.symbols)),
+        capacity(std::exchange(other.capacity, 0)),
+        count(std::exchange(other.count, 0)),
+        growthLimit(std::exchange(other.growthLimit, 0)) {}
   StringInterner &operator=(StringInterner &&) = delete;
 
-  // Main interning interface
-  [[nodiscard]] InternedString intern(std::string_view str);
+  // Main interning interface. Thread-safe only in concurrent mode.
+  [[nodiscard]] InternedString intern(std::string_view str) {
+    return intern(str, hashString(str));
+  }
+
+  // Intern with a hash the caller already has, e.g. one a scanner computed
+  // with StringHasher while reading the token. Must equal hashString(str).
+  [[nodiscard]] InternedString intern(std::string_view str,
+                                      size_t precomputedHash);
 
   [[nodiscard]] InternedString intern(const char *str) {
     return intern(std::string_view(str));
@@ -224,29 +320,91 @@ public:
     return intern(std::string_view(str));
   }
 
+  // Symbol id interface. Interning through either interface yields the same
+  // string, so ids and InternedStrings can be converted back and forth.
+  [[nodiscard]] SymbolId internSymbol(std::string_view str) {
+    return internSymbol(str, hashString(str));
+  }
+  [[nodiscard]] SymbolId internSymbol(std::string_view str,
+                                      size_t precomputedHash);
+
+  // Id of a string interned by this interner
+  [[nodiscard]] SymbolId getSymbolId(InternedString str) const noexcept;
+
+  // O(1) access to the string behind an id from this interner
+  [[nodiscard]] InternedString getString(SymbolId id) const noexcept {
+    if (concurrentTable) {
+      return id.empty() ? InternedString()
+                        : concurrentTable->getString(id.index());
+    }
+    return symbols[id.index()];
+  }
+  [[nodiscard]] std::string_view view(SymbolId id) const noexcept {
+    return getString(id).view();
+  }
+
+  // One past the largest id handed out so far; sizes a SymbolMap
+  [[nodiscard]] size_t getSymbolLimit() const noexcept {
+    return concurrentTable ? concurrentTable->getIdLimit() : symbols.size();
+  }
+
+  [[nodiscard]] bool isConcurrent() const noexcept {
+    return concurrentTable != nullptr;
+  }
+
   // Statistics
   [[nodiscard]] size_t getStringCount() const noexcept {
-    return internedStrings.size();
+    return concurrentTable ? concurrentTable->getStringCount() : count;
   }
   [[nodiscard]] size_t getBucketCount() const noexcept {
-    return internedStrings.bucket_count();
+    return concurrentTable ? concurrentTable->getBucketCount() : capacity;
   }
   [[nodiscard]] double getLoadFactor() const noexcept {
-    return internedStrings.load_factor();
+    const size_t buckets = getBucketCount();
+    return buckets ? static_cast<double>(getStringCount()) / buckets : 0.0;
   }
 
+  // Entry i counts the strings found on the i-th probed group (1-based)
+  [[nodiscard]] std::vector<size_t> getProbeLengthHistogram() const;
+
   // Memory usage
   [[nodiscard]] size_t getTotalMemoryUsed() const noexcept;
 
   // Debug utilities
   void printStatistics() const;
-  void printAllStrings() const; // Iterate over internedStrings map
+  void printAllStrings() const; // Iterate over the interned strings
 
 private:
-  [[nodiscard]] InternedString internNewString(std::string_view str);
-  
-  // Pre-intern common strings for performance
-  void internCommonStrings();
+  // Slot holding `str`, or the empty slot it would be inserted into
+  struct ProbeResult {
+    size_t slot;
+    size_t groupsProbed;
+    bool found;
+  };
+
+  [[nodiscard]] ProbeResult probe(std::string_view str, size_t hash) const noexcept;
+  [[nodiscard]] uint32_t internNewString(std::string_view str, size_t hash);
+  void rehash(size_t newCapacity);
+
+  [[nodiscard]] static constexpr int8_t hashControl(size_t hash) noexcept {
+    return static_cast<int8_t>(hash & 0x7f);
+  }
+
+  // Adopt the static keyword and builtin name table. Its strings keep fixed
+  // ids starting at 1 and are referenced in place, so nothing is hashed or
+  // copied; the single-threaded index is copied from a prebuilt image.
+  void seedBuiltins();
+  struct SeedIndex;
+  static const SeedIndex seedIndex;
+};
+
+// Keywords from KEYWORD_LIST followed by CXY_BUILTIN_NAMES, without
+// duplicates, as constant-initialized interned strings. An interner created
+// with preInternKeywords gives strings()[i] the SymbolId i + 1.
+class BuiltinStrings {
+public:
+  [[nodiscard]] static std::span<const InternedString> strings() noexcept;
+  [[nodiscard]] static SymbolId find(std::string_view str) noexcept;
 };
 
 
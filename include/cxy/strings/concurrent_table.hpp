@@ -0,0 +1,130 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include <cxy/memory/concurrent_arena.hpp>
+
+namespace cxy {
+
+class InternedString;
+
+// Interning table shared by several threads, used by StringInterner in
+// concurrent mode. Strings are striped over shards by hash; each shard is a
+// linear-probing table of atomic entry pointers kept at most half full.
+// Finding a string that is already interned is wait-free: readers never
+// lock, and an insert or a resize only ever publishes fully built entries and
+// tables. Misses take the shard lock and probe again before inserting, so
+// each string gets exactly one entry and pointer identity holds across
+// threads. Entries and string data live in a ConcurrentArena owned by the
+// table.
+//
+// Every entry also gets a dense 32-bit id, assigned in insertion order from
+// 1. Ids index a segmented directory whose segments double in size and are
+// never moved, so id lookups are lock-free as well.
+class ConcurrentStringTable {
+private:
+  static constexpr size_t SHARD_BITS = 6;
+  static constexpr size_t SHARD_COUNT = size_t{1} << SHARD_BITS;
+  static constexpr size_t INITIAL_SHARD_CAPACITY = 64;
+  static constexpr size_t FIRST_SEGMENT_BITS = 10;
+  static constexpr size_t SEGMENT_COUNT = 33 - FIRST_SEGMENT_BITS;
+
+  struct Entry; // An InternedString and its id
+
+  struct Table {
+    size_t capacity; // Power of two
+    std::unique_ptr<std::atomic<const Entry *>[]> slots;
+
+    explicit Table(size_t capacity);
+  };
+
+  struct alignas(64) Shard {
+    std::atomic<Table *> table{nullptr};
+    std::atomic<size_t> count{0};
+    std::mutex mutex; // Serializes inserts and resizes
+    // Every table this shard ever published; readers may still be probing
+    // an old one, so they are only freed with the whole table
+    std::vector<std::unique_ptr<Table>> tables;
+  };
+
+  ConcurrentArena strings;
+  std::array<Shard, SHARD_COUNT> shards;
+  std::atomic<uint32_t> nextId{1};
+  // Segment k holds the entries of ids [2^(k+10) - 2^10, 2^(k+11) - 2^10)
+  std::array<std::atomic<std::atomic<const Entry *> *>, SEGMENT_COUNT>
+      segments{};
+
+public:
+  ConcurrentStringTable();
+  ~ConcurrentStringTable();
+
+  ConcurrentStringTable(const ConcurrentStringTable &) = delete;
+  ConcurrentStringTable &operator=(const ConcurrentStringTable &) = delete;
+
+  // Insert strings whose data outlives the table, such as the builtin
+  // table, without copying them. Only valid before the table is shared.
+  void seed(std::span<const InternedString> prebuilt);
+
+  // Safe to call from any thread
+  [[nodiscard]] InternedString intern(std::string_view str, size_t hash);
+  [[nodiscard]] uint32_t internId(std::string_view str, size_t hash);
+
+  // Id of an interned string, or 0 when it is not in the table
+  [[nodiscard]] uint32_t findId(std::string_view str,
+                                size_t hash) const noexcept;
+  // `id` must have been handed out by this table
+  [[nodiscard]] InternedString getString(uint32_t id) const noexcept;
+  // One past the largest id handed out so far
+  [[nodiscard]] uint32_t getIdLimit() const noexcept {
+    return nextId.load(std::memory_order_acquire);
+  }
+
+  // Statistics (approximate while other threads are interning)
+  [[nodiscard]] size_t getStringCount() const noexcept;
+  [[nodiscard]] size_t getBucketCount() const noexcept;
+  [[nodiscard]] std::vector<size_t> getProbeLengthHistogram() const;
+  [[nodiscard]] size_t getTotalMemoryUsed() const noexcept;
+
+  // Visit every entry; callers must ensure no thread is interning
+  template <typename Visitor> void forEach(Visitor &&visit) const {
+    for (const auto &shard : shards) {
+      const Table *table = shard.table.load(std::memory_order_acquire);
+      for (size_t i = 0; i < table->capacity; ++i) {
+        if (const auto *entry =
+                table->slots[i].load(std::memory_order_acquire)) {
+          visit(stringOf(*entry));
+        }
+      }
+    }
+  }
+
+private:
+  // Top hash bits pick the shard, low bits the slot within it
+  [[nodiscard]] Shard &shardFor(size_t hash) noexcept {
+    return shards[hash >> (sizeof(size_t) * 8 - SHARD_BITS)];
+  }
+  [[nodiscard]] const Shard &shardFor(size_t hash) const noexcept {
+    return shards[hash >> (sizeof(size_t) * 8 - SHARD_BITS)];
+  }
+
+  [[nodiscard]] static const InternedString &
+  stringOf(const Entry &entry) noexcept;
+  [[nodiscard]] const Entry &internEntry(std::string_view str, size_t hash);
+  [[nodiscard]] static const Entry *
+  find(const Table &table, std::string_view str, size_t hash) noexcept;
+  [[nodiscard]] const Entry *insertLocked(Shard &shard, std::string_view str,
+                                          size_t hash,
+                                          const char *stored = nullptr);
+  void growLocked(Shard &shard);
+  void publishId(const Entry &entry);
+};
+
+} // namespace cxy
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace cxy {
+
+// String hash used by the interner. Input is consumed as little-endian 64-bit
+// words, each folded in with a 64x64->128 bit multiply, which is several
+// times faster than std::hash on identifier-sized strings. StringHasher
+// computes the same value one character at a time, so a scanner can hash a
+// token while it reads it.
+namespace hashing {
+
+inline constexpr uint64_t SEED = 0x9e3779b97f4a7c15ULL;
+inline constexpr uint64_t WORD_MULTIPLIER = 0xa0761d6478bd642fULL;
+inline constexpr uint64_t FINAL_MULTIPLIER = 0xe7037ed1a0b428dbULL;
+
+// Fold the two halves of the 128-bit product together
+[[nodiscard]] constexpr uint64_t mix(uint64_t a, uint64_t b) noexcept {
+#ifdef __SIZEOF_INT128__
+  __extension__ using Uint128 = unsigned __int128;
+  const auto product = static_cast<Uint128>(a) * b;
+  return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+#else
+  const uint64_t aLo = a & 0xffffffffULL, aHi = a >> 32;
+  const uint64_t bLo = b & 0xffffffffULL, bHi = b >> 32;
+  const uint64_t loLo = aLo * bLo, hiLo = aHi * bLo;
+  const uint64_t loHi = aLo * bHi, hiHi = aHi * bHi;
+  const uint64_t cross = (loLo >> 32) + (hiLo & 0xffffffffULL) + loHi;
+  const uint64_t lo = (cross << 32) | (loLo & 0xffffffffULL);
+  const uint64_t hi = hiHi + (hiLo >> 32) + (cross >> 32);
+  return lo ^ hi;
+#endif
+}
+
+[[nodiscard]] constexpr uint64_t loadWord(const char *data) noexcept {
+  if consteval {
+    uint64_t word = 0;
+    for (size_t i = 0; i < sizeof(word); ++i) {
+      word |= uint64_t{static_cast<unsigned char>(data[i])} << (i * 8);
+    }
+    return word;
+  } else {
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    if constexpr (std::endian::native == std::endian::big) {
+      word = std::byteswap(word);
+    }
+    return word;
+  }
+}
+
+} // namespace hashing
+
+// Usable at compile time, so tables of known strings can be prehashed
+[[nodiscard]] constexpr size_t hashString(std::string_view str) noexcept {
+  const char *data = str.data();
+  const size_t length = str.size();
+
+  uint64_t state = hashing::SEED;
+  size_t offset = 0;
+  for (; offset + 8 <= length; offset += 8) {
+    state = hashing::mix(state ^ hashing::loadWord(data + offset),
+                         hashing::WORD_MULTIPLIER);
+  }
+
+  uint64_t tail = 0;
+  for (size_t shift = 0; offset < length; ++offset, shift += 8) {
+    tail |= uint64_t{static_cast<unsigned char>(data[offset])} << shift;
+  }
+
+  return static_cast<size_t>(
+      hashing::mix(state ^ tail, hashing::FINAL_MULTIPLIER ^ length));
+}
+
+// Incremental form of hashString(): feeding the characters of a string one
+// by one and calling finish() gives the same value
+class StringHasher {
+  uint64_t state = hashing::SEED;
+  uint64_t word = 0;
+  size_t length = 0;
+
+public:
+  void add(char c) noexcept {
+    word |= uint64_t{static_cast<unsigned char>(c)} << ((length & 7) * 8);
+    if ((++length & 7) == 0) {
+      state = hashing::mix(state ^ word, hashing::WORD_MULTIPLIER);
+      word = 0;
+    }
+  }
+
+  void reset() noexcept { *this = StringHasher{}; }
+
+  [[nodiscard]] size_t size() const noexcept { return length; }
+
+  [[nodiscard]] size_t finish() const noexcept {
+    return static_cast<size_t>(
+        hashing::mix(state ^ word, hashing::FINAL_MULTIPLIER ^ length));
+  }
+};
+
+} // namespace cxy
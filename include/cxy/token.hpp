@@ -2,10 +2,17 @@
 
 #include "cxy/diagnostics.hpp"
 #include "cxy/strings.hpp"
+#include <array>
+#include <bit>
+#include <cstddef>
 #include <cstdint>
 #include <format>
+#include <initializer_list>
+#include <iterator>
 #include <string>
 #include <string_view>
+#include <type_traits>
+#include <vector>
 
 namespace cxy {
 
@@ -233,7 +240,7 @@ enum class FloatKind : uint8_t {
  * This enum is automatically generated from the TOKEN_LIST macro
  * and represents every possible token type that the lexer can produce.
  */
-enum class TokenKind : uint32_t {
+enum class TokenKind : uint8_t {
 #define TOKEN_ENUM(name, str) name,
   TOKEN_LIST(TOKEN_ENUM)
 #undef TOKEN_ENUM
@@ -247,6 +254,10 @@ enum class TokenKind : uint32_t {
   LastSpecial = Error
 };
 
+// A byte is enough and keeps CompactToken at 16 bytes
+static_assert(static_cast<unsigned>(TokenKind::LastSpecial) < 256,
+              "TokenKind no longer fits in a byte");
+
 /**
  * @brief Convert a TokenKind to its string representation.
  *
@@ -370,6 +381,134 @@ constexpr bool isAssignmentOperator(TokenKind kind) {
          kind == TokenKind::ShrEqual;
 }
 
+/**
+ * @brief A set of token kinds, stored as a bitset over TokenKind.
+ *
+ * Membership is a single bit test and union, intersection and difference
+ * work a word at a time. Every operation is constexpr, so lookahead and
+ * recovery sets are built at compile time rather than as a list on each
+ * call. Iteration visits the kinds in TokenKind order.
+ */
+class TokenSet {
+public:
+  /// Number of token kinds a set can hold
+  static constexpr size_t CAPACITY = size_t(TokenKind::LastSpecial) + 1;
+
+  class Iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = TokenKind;
+    using difference_type = std::ptrdiff_t;
+
+    constexpr Iterator() = default;
+    constexpr Iterator(const TokenSet *owner, size_t from)
+        : set(owner), index(owner->next(from)) {}
+
+    constexpr TokenKind operator*() const { return TokenKind(index); }
+    constexpr Iterator &operator++() {
+      index = set->next(index + 1);
+      return *this;
+    }
+    constexpr Iterator operator++(int) {
+      Iterator previous = *this;
+      ++*this;
+      return previous;
+    }
+    constexpr bool operator==(const Iterator &other) const {
+      return index == other.index;
+    }
+
+  private:
+    const TokenSet *set = nullptr;
+    size_t index = CAPACITY;
+  };
+
+  constexpr TokenSet() = default;
+  constexpr TokenSet(std::initializer_list<TokenKind> kinds) {
+    for (TokenKind kind : kinds) {
+      insert(kind);
+    }
+  }
+
+  constexpr bool contains(TokenKind kind) const {
+    return (words[size_t(kind) / 64] >> (size_t(kind) % 64)) & 1;
+  }
+
+  constexpr TokenSet &insert(TokenKind kind) {
+    words[size_t(kind) / 64] |= uint64_t{1} << (size_t(kind) % 64);
+    return *this;
+  }
+
+  constexpr TokenSet &erase(TokenKind kind) {
+    words[size_t(kind) / 64] &= ~(uint64_t{1} << (size_t(kind) % 64));
+    return *this;
+  }
+
+  constexpr size_t size() const {
+    size_t count = 0;
+    for (uint64_t word : words) {
+      count += std::popcount(word);
+    }
+    return count;
+  }
+
+  constexpr bool empty() const { return *this == TokenSet{}; }
+
+  constexpr TokenSet &operator|=(const TokenSet &other) {
+    for (size_t i = 0; i < WORDS; ++i) {
+      words[i] |= other.words[i];
+    }
+    return *this;
+  }
+
+  constexpr TokenSet &operator&=(const TokenSet &other) {
+    for (size_t i = 0; i < WORDS; ++i) {
+      words[i] &= other.words[i];
+    }
+    return *this;
+  }
+
+  constexpr TokenSet &operator-=(const TokenSet &other) {
+    for (size_t i = 0; i < WORDS; ++i) {
+      words[i] &= ~other.words[i];
+    }
+    return *this;
+  }
+
+  friend constexpr TokenSet operator|(TokenSet lhs, const TokenSet &rhs) {
+    return lhs |= rhs;
+  }
+  friend constexpr TokenSet operator&(TokenSet lhs, const TokenSet &rhs) {
+    return lhs &= rhs;
+  }
+  friend constexpr TokenSet operator-(TokenSet lhs, const TokenSet &rhs) {
+    return lhs -= rhs;
+  }
+
+  constexpr bool operator==(const TokenSet &) const = default;
+
+  constexpr Iterator begin() const { return Iterator(this, 0); }
+  constexpr Iterator end() const { return Iterator(); }
+
+private:
+  static constexpr size_t WORDS = (CAPACITY + 63) / 64;
+
+  // First kind at or after `index` in the set, or CAPACITY
+  constexpr size_t next(size_t index) const {
+    while (index < CAPACITY) {
+      const uint64_t word = words[index / 64] >> (index % 64);
+      if (word != 0) {
+        index += std::countr_zero(word);
+        return index < CAPACITY ? index : CAPACITY;
+      }
+      index = (index / 64 + 1) * 64;
+    }
+    return CAPACITY;
+  }
+
+  std::array<uint64_t, WORDS> words{};
+};
+
 /**
  * @brief Represents a single token in the Cxy language.
  *
@@ -626,6 +765,68 @@ struct Token {
   }
 };
 
+/**
+ * @brief Index of a source buffer within one lexer.
+ *
+ * The main file is 0 and every pushed include gets the next id.
+ */
+using FileID = uint16_t;
+
+/**
+ * @brief Out-of-line storage for the literal values of compact tokens.
+ *
+ * Integer and float literals are too wide to live in a CompactToken, so the
+ * lexer appends their values here and the token keeps the index.
+ */
+class LiteralTable {
+public:
+  uint32_t add(const Token::Value &value) {
+    values.push_back(value);
+    return static_cast<uint32_t>(values.size() - 1);
+  }
+
+  const Token::Value &operator[](uint32_t index) const { return values[index]; }
+
+  size_t size() const { return values.size(); }
+  void clear() { values.clear(); }
+  // Drop entries added after the first `count`
+  void truncate(size_t count) {
+    values.erase(values.begin() + count, values.end());
+  }
+
+private:
+  std::vector<Token::Value> values;
+};
+
+/**
+ * @brief Trivially copyable 16-byte form of a token.
+ *
+ * Only the kind, the source buffer and the byte range are stored inline.
+ * Filename, row and column are recovered from the lexer that produced the
+ * token (Lexer::getLocation()), and the literal value is found through
+ * valueIndex (Lexer::expand() does both):
+ *  - Ident, StringLiteral, LString, RString: SymbolId::index() in the interner
+ *  - CharLiteral: the codepoint itself
+ *  - IntLiteral, FloatLiteral: index into the lexer's LiteralTable
+ */
+struct CompactToken {
+  static constexpr uint8_t HAS_VALUE = 1u << 0;
+
+  TokenKind kind = TokenKind::Error;
+  uint8_t flags = 0;
+  FileID file = 0;
+  uint32_t offset = 0;     ///< Byte offset of the first character
+  uint32_t length = 0;     ///< Length of the token text in bytes
+  uint32_t valueIndex = 0; ///< Meaning depends on kind, see above
+
+  bool is(TokenKind k) const { return kind == k; }
+  bool isEof() const { return kind == TokenKind::EoF; }
+  bool hasLiteralValue() const { return (flags & HAS_VALUE) != 0; }
+};
+
+static_assert(sizeof(CompactToken) == 16);
+static_assert(std::is_trivially_copyable_v<CompactToken>);
+
 /**
  * @brief Check if a token kind should have its text interned.
  *
@@ -4,6 +4,7 @@
 #include <cxy/ast/printer.hpp>
 #include <cxy/diagnostics.hpp>
 #include <cxy/memory/arena.hpp>
+#include <cstdio>
 #include <fstream>
 #include <filesystem>
 
@@ -15,7 +16,8 @@ Compiler::Compiler(CompilerOptions options, std::filesystem::path projectRoot)
     , typeRegistry_()
     , diagnostics_()
     , sourceManager_()
-    , arena_(1024 * 1024) // 1MB arena
+    , arena_(ArenaOptions{.initialBlockSize = 1024 * 1024, // 1MB, growing
+                          .hugePages = true})
     , stringInterner_(arena_)
     , moduleCache_()
 {
@@ -31,29 +33,49 @@ Compiler::Compiler(CompilerOptions options, std::filesystem::path projectRoot)
 Compiler::~Compiler() = default;
 
 CompilationResult Compiler::compileFile(const std::filesystem::path& sourcePath) {
-    // Read file content
-    std::ifstream file(sourcePath);
-    if (!file.is_open()) {
-        diagnostics_.error("Cannot open file: " + sourcePath.string(), 
-                          Location{sourcePath.string(), Position{1, 1, 0}});
+    // The source manager maps the file; lexing and diagnostics read those bytes
+    const std::string filename = sourcePath.string();
+    auto content = sourceManager_.loadFile(filename);
+    if (!content) {
+        diagnostics_.error("Cannot open file: " + filename, 
+                          Location{filename, Position{1, 1, 0}});
         return createErrorResult(CompilationResult::Status::IOError, 1);
     }
     
-    std::string content((std::istreambuf_iterator<char>(file)),
-                        std::istreambuf_iterator<char>());
-    file.close();
-    
-    if (!file.good() && !file.eof()) {
-        diagnostics_.error("Error reading file: " + sourcePath.string(), 
-                          Location{sourcePath.string(), Position{1, 1, 0}});
-        return createErrorResult(CompilationResult::Status::IOError, 1);
-    }
-    
-    return compileSource(content, sourcePath.string());
+    return runCompilationPipeline(*content, filename, false);
 }
 
 CompilationResult Compiler::compileSource(std::string_view source, std::string_view filename) {
-    return runCompilationPipeline(source, filename, false);
+    // Keep one copy the diagnostics can refer back to, and lex that copy
+    auto content = sourceManager_.registerFile(std::string(filename), std::string(source));
+    return runCompilationPipeline(content, filename, false);
+}
+
+CompilationResult Compiler::compileStdin(std::string_view filename) {
+    auto* devOpts = options_.getDevOptions();
+    if (devOpts && devOpts->printTokens) {
+        // The token dump re-lexes from the start, so it needs all of the input
+        auto content = sourceManager_.loadStream(std::string(filename), stdin);
+        if (!content) {
+            diagnostics_.error("Error reading standard input", Location{});
+            return createErrorResult(CompilationResult::Status::IOError, 1);
+        }
+        return runCompilationPipeline(*content, filename, false);
+    }
+
+    // Lex while the producer is still writing; only a window of the input is
+    // held at any time
+    Lexer lexer(filename,
+                [](char* buffer, size_t capacity) {
+                    return std::fread(buffer, 1, capacity, stdin);
+                },
+                diagnostics_, stringInterner_);
+    auto result = runCompilationPipeline(lexer, filename, false);
+    if (std::ferror(stdin)) {
+        diagnostics_.error("Error reading standard input", Location{});
+        return createErrorResult(CompilationResult::Status::IOError, 1);
+    }
+    return result;
 }
 
 CompilationResult Compiler::compileString(std::string_view source, std::string_view filename) {
@@ -225,24 +247,15 @@ ast::ASTNode* Compiler::loadModule(
     const std::filesystem::path& modulePath,
     const Location& importLocation) {
     
-    // Read the module file
-    std::ifstream file(modulePath);
-    if (!file.is_open()) {
+    // Map the module file into the source manager
+    auto content = sourceManager_.loadFile(modulePath.string());
+    if (!content) {
         diagnostics_.error("Cannot open imported module: " + modulePath.string(), importLocation);
         return nullptr;
     }
     
-    std::string content((std::istreambuf_iterator<char>(file)),
-                        std::istreambuf_iterator<char>());
-    file.close();
-    
-    if (!file.good() && !file.eof()) {
-        diagnostics_.error("Error reading imported module: " + modulePath.string(), importLocation);
-        return nullptr;
-    }
-    
     // Compile the module with semantic analysis for complete type information
-    auto result = runCompilationPipeline(content, modulePath.string(), true);
+    auto result = runCompilationPipeline(*content, modulePath.string(), true);
     
     if (result.isFailure()) {
         diagnostics_.error("Failed to compile imported module: " + modulePath.string(), importLocation);
@@ -269,13 +282,16 @@ CompilationResult Compiler::runCompilationPipeline(
     // Clear diagnostics for this compilation
     // (Note: this depends on whether we want to accumulate diagnostics across compilations)
     
-    // Register source with source manager
-    sourceManager_.registerFile(std::string(filename), std::string(source));
+    Lexer lexer(filename, source, diagnostics_, stringInterner_);
+    return runCompilationPipeline(lexer, filename, runSemanticAnalysis);
+}
+
+CompilationResult Compiler::runCompilationPipeline(
+    Lexer& lexer,
+    std::string_view filename,
+    bool runSemanticAnalysis) {
     
     try {
-        // Lexical Analysis
-        Lexer lexer(filename, source, diagnostics_, stringInterner_);
-        
         // Token printing debug functionality
         if (auto* devOpts = options_.getDevOptions()) {
             if (devOpts->printTokens) {
@@ -1,9 +1,20 @@
 #include <cxy/diagnostics.hpp>
+#include <cxy/memory/arena_stl.hpp>
 
 #include <algorithm>
+#include <cerrno>
 #include <iostream>
+#include <iterator>
 #include <sstream>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CXY_SOURCE_HAVE_MMAP 1
+#endif
+
 namespace cxy {
 
 // ANSI color codes
@@ -37,51 +48,58 @@ void ConsoleDiagnosticSink::emit(const DiagnosticMessage &msg) {
     break;
   }
 
-  std::cout << getSeverityColor(msg.severity) << severityStr << ": "
-            << getResetColor() << msg.message << "\n";
+  // The diagnostic is assembled in scratch memory and written in one go
+  ScratchArena scratch;
+  ArenaString text{ArenaSTLAllocator<char>(scratch)};
+  auto out = std::back_inserter(text);
+
+  std::format_to(out, "{}{}: {}{}\n", getSeverityColor(msg.severity),
+                 severityStr, getResetColor(), msg.message);
+
+  // Offset-only locations get their row/column here, the first time anyone
+  // needs them
+  const Location primary = resolve(msg.primaryLocation);
 
   // Print location header only if location is valid
-  if (msg.primaryLocation.isValid()) {
-    std::cout << formatLocationHeader(msg.primaryLocation) << "\n";
+  if (primary.isValid()) {
+    std::format_to(out, "{}\n", formatLocationHeader(primary));
   }
 
   // Print source line with caret if available
-  if (sourceManager && sourceManager->hasFile(msg.primaryLocation.filename)) {
-    auto sourceLine = getSourceLine(msg.primaryLocation);
+  if (sourceManager && sourceManager->hasFile(primary.filename)) {
+    auto sourceLine = getSourceLine(primary);
     if (!sourceLine.empty()) {
-      std::cout << "     |\n";
-      std::cout << std::format("{:4} | {}\n", msg.primaryLocation.start.row,
-                               sourceLine);
-      std::cout << "     | " << createCaretLine(msg.primaryLocation, sourceLine)
-                << "\n";
+      std::format_to(out, "     |\n{:4} | {}\n     | {}\n", primary.start.row,
+                     sourceLine, createCaretLine(primary, sourceLine));
     }
   }
 
   // Print secondary locations
-  for (const auto &loc : msg.secondaryLocations) {
-    std::cout << "note: see " << formatLocationHeader(loc) << "\n";
+  for (const auto &secondary : msg.secondaryLocations) {
+    const Location loc = resolve(secondary);
+    std::format_to(out, "note: see {}\n", formatLocationHeader(loc));
 
     if (sourceManager && sourceManager->hasFile(loc.filename)) {
       auto sourceLine = getSourceLine(loc);
       if (!sourceLine.empty()) {
-        std::cout << "     |\n";
-        std::cout << std::format("{:4} | {}\n", loc.start.row, sourceLine);
-        std::cout << "     | " << createCaretLine(loc, sourceLine) << "\n";
+        std::format_to(out, "     |\n{:4} | {}\n     | {}\n", loc.start.row,
+                       sourceLine, createCaretLine(loc, sourceLine));
       }
     }
   }
 
   // Print notes
   for (const auto &note : msg.notes) {
-    std::cout << "note: " << note << "\n";
+    std::format_to(out, "note: {}\n", note);
   }
 
   // Print suggestion
   if (msg.suggestion) {
-    std::cout << "suggestion: " << *msg.suggestion << "\n";
+    std::format_to(out, "suggestion: {}\n", *msg.suggestion);
   }
 
-  std::cout << "\n"; // Add blank line after each diagnostic
+  text += '\n'; // Add blank line after each diagnostic
+  std::cout.write(text.data(), static_cast<std::streamsize>(text.size()));
 }
 
 void ConsoleDiagnosticSink::flush() { std::cout << std::flush; }
@@ -107,8 +125,23 @@ std::string ConsoleDiagnosticSink::getResetColor() const {
   return useColors ? Colors::RESET : "";
 }
 
+Location ConsoleDiagnosticSink::resolve(const Location &loc) const {
+  if (!sourceManager || loc.start.isResolved()) {
+    return loc;
+  }
+  return sourceManager->resolve(loc);
+}
+
 std::string
 ConsoleDiagnosticSink::formatLocationHeader(const Location &loc) const {
+  if (!loc.start.isResolved()) {
+    // No source to resolve against, the offset is all we have
+    std::string header = "     in " + loc.filename + " at byte " +
+                         std::to_string(loc.start.byteOffset);
+    return (useColors ? Colors::DIM : "") + header +
+           (useColors ? Colors::RESET : "");
+  }
+
   std::string header = "     in " + loc.filename + ":" +
                        std::to_string(loc.start.row) + ":" +
                        std::to_string(loc.start.column);
@@ -255,11 +288,136 @@ std::vector<DiagnosticMessage> InMemoryDiagnosticSink::getWarnings() const {
   return getMessagesBySeverity(Severity::Warning);
 }
 
+// SourceBuffer implementation
+SourceBuffer::SourceBuffer(SourceBuffer &&other) noexcept
+    : owned(std::move(other.owned)), mapping(other.mapping),
+      mappedSize(other.mappedSize) {
+  other.mapping = nullptr;
+  other.mappedSize = 0;
+}
+
+SourceBuffer &SourceBuffer::operator=(SourceBuffer &&other) noexcept {
+  if (this != &other) {
+    release();
+    owned = std::move(other.owned);
+    mapping = other.mapping;
+    mappedSize = other.mappedSize;
+    other.mapping = nullptr;
+    other.mappedSize = 0;
+  }
+  return *this;
+}
+
+SourceBuffer::~SourceBuffer() { release(); }
+
+void SourceBuffer::release() noexcept {
+#ifdef CXY_SOURCE_HAVE_MMAP
+  if (mapping) {
+    munmap(const_cast<char *>(mapping), mappedSize);
+  }
+#endif
+  mapping = nullptr;
+  mappedSize = 0;
+}
+
+std::optional<SourceBuffer> SourceBuffer::fromFile(const std::string &path) {
+#ifdef CXY_SOURCE_HAVE_MMAP
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return std::nullopt;
+  }
+
+  struct stat info {};
+  const bool regular = fstat(fd, &info) == 0 && S_ISREG(info.st_mode);
+  if (regular && info.st_size > 0) {
+    const auto size = static_cast<size_t>(info.st_size);
+    void *memory = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (memory != MAP_FAILED) {
+      close(fd);
+      SourceBuffer buffer;
+      buffer.mapping = static_cast<const char *>(memory);
+      buffer.mappedSize = size;
+      return buffer;
+    }
+  }
+
+  // Not mappable: read it in one pass, sized up front when the size is known
+  std::string content;
+  content.reserve(regular ? static_cast<size_t>(info.st_size) : 0);
+  char chunk[64 * 1024];
+  for (;;) {
+    const ssize_t count = read(fd, chunk, sizeof(chunk));
+    if (count == 0) {
+      break;
+    }
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      close(fd);
+      return std::nullopt;
+    }
+    content.append(chunk, static_cast<size_t>(count));
+  }
+  close(fd);
+  return SourceBuffer(std::move(content));
+#else
+  std::FILE *file = std::fopen(path.c_str(), "rb");
+  if (!file) {
+    return std::nullopt;
+  }
+  auto buffer = fromStream(file);
+  std::fclose(file);
+  return buffer;
+#endif
+}
+
+std::optional<SourceBuffer> SourceBuffer::fromStream(std::FILE *stream) {
+  // Read through stdio rather than the descriptor, so bytes the stream has
+  // already buffered (say, after a peek) are not lost
+  std::string content;
+  char chunk[64 * 1024];
+  size_t count;
+  while ((count = std::fread(chunk, 1, sizeof(chunk), stream)) > 0) {
+    content.append(chunk, count);
+  }
+  if (std::ferror(stream)) {
+    return std::nullopt;
+  }
+  return SourceBuffer(std::move(content));
+}
+
 // SourceManager implementation
-void SourceManager::registerFile(const std::string &filename,
-                                 std::string content) {
-  fileContents[filename] = std::move(content);
+std::string_view SourceManager::registerFile(const std::string &filename,
+                                             std::string content) {
+  return registerBuffer(filename, SourceBuffer(std::move(content)));
+}
+
+std::optional<std::string_view>
+SourceManager::loadFile(const std::string &filename) {
+  auto buffer = SourceBuffer::fromFile(filename);
+  if (!buffer) {
+    return std::nullopt;
+  }
+  return registerBuffer(filename, std::move(*buffer));
+}
+
+std::optional<std::string_view>
+SourceManager::loadStream(const std::string &filename, std::FILE *stream) {
+  auto buffer = SourceBuffer::fromStream(stream);
+  if (!buffer) {
+    return std::nullopt;
+  }
+  return registerBuffer(filename, std::move(*buffer));
+}
+
+std::string_view SourceManager::registerBuffer(const std::string &filename,
+                                               SourceBuffer buffer) {
+  // Map nodes do not move, so the view stays valid as other files come in
+  auto &stored = fileContents[filename];
+  stored = std::move(buffer);
   buildLineOffsets(filename);
+  return stored.view();
 }
 
 std::optional<std::string> SourceManager::getLine(const std::string &filename,
@@ -279,7 +437,7 @@ std::optional<std::string> SourceManager::getLine(const std::string &filename,
     return std::nullopt;
   }
 
-  const std::string &content = contentIt->second;
+  const std::string_view content = contentIt->second.view();
   size_t startOffset = offsets[lineNumber - 1];
   size_t endOffset = (lineNumber < offsets.size())
                          ? offsets[lineNumber] - 1
@@ -289,7 +447,7 @@ std::optional<std::string> SourceManager::getLine(const std::string &filename,
     return "";
   }
 
-  return content.substr(startOffset, endOffset - startOffset);
+  return std::string(content.substr(startOffset, endOffset - startOffset));
 }
 
 std::optional<std::string>
@@ -299,7 +457,7 @@ SourceManager::getRange(const Location &location) const {
     return std::nullopt;
   }
 
-  const std::string &content = contentIt->second;
+  const std::string_view content = contentIt->second.view();
   size_t start = location.start.byteOffset;
   size_t length = location.getLength();
 
@@ -311,7 +469,7 @@ SourceManager::getRange(const Location &location) const {
     length = content.length() - start;
   }
 
-  return content.substr(start, length);
+  return std::string(content.substr(start, length));
 }
 
 std::string_view SourceManager::getRangeView(const Location &location) const {
@@ -320,7 +478,7 @@ std::string_view SourceManager::getRangeView(const Location &location) const {
     return {}; // Return empty string_view
   }
 
-  const std::string &content = contentIt->second;
+  const std::string_view content = contentIt->second.view();
   size_t start = location.start.byteOffset;
   size_t length = location.getLength();
 
@@ -332,7 +490,7 @@ std::string_view SourceManager::getRangeView(const Location &location) const {
     length = content.length() - start;
   }
 
-  return std::string_view(content.data() + start, length);
+  return content.substr(start, length);
 }
 
 Position SourceManager::createPosition(const std::string &filename,
@@ -341,14 +499,31 @@ Position SourceManager::createPosition(const std::string &filename,
   return Position(row, column, byteOffset);
 }
 
+Position SourceManager::resolve(const std::string &filename,
+                               const Position &position) const {
+  if (position.isResolved() || lineOffsets.find(filename) == lineOffsets.end()) {
+    return position;
+  }
+  auto [row, column] = getLineAndColumn(filename, position.byteOffset);
+  return Position(row, column, position.byteOffset);
+}
+
+Location SourceManager::resolve(const Location &location) const {
+  return Location(location.filename, resolve(location.filename, location.start),
+                  resolve(location.filename, location.end));
+}
+
 bool SourceManager::hasFile(const std::string &filename) const {
   return fileContents.find(filename) != fileContents.end();
 }
 
-const std::string *
+std::optional<std::string_view>
 SourceManager::getFileContent(const std::string &filename) const {
   auto it = fileContents.find(filename);
-  return (it != fileContents.end()) ? &it->second : nullptr;
+  if (it == fileContents.end()) {
+    return std::nullopt;
+  }
+  return it->second.view();
 }
 
 void SourceManager::buildLineOffsets(const std::string &filename) {
@@ -357,7 +532,7 @@ void SourceManager::buildLineOffsets(const std::string &filename) {
     return;
   }
 
-  const std::string &content = contentIt->second;
+  const std::string_view content = contentIt->second.view();
   std::vector<size_t> &offsets = lineOffsets[filename];
   offsets.clear();
   offsets.push_back(0); // First line starts at offset 0
@@ -405,7 +405,10 @@ void ASTPrinter::printNodeStartInline(const ASTNode *node) {
   }
 }
 
-void ASTPrinter::printLocation(const Location &loc) {
+void ASTPrinter::printLocation(const Location &location) {
+  const Location loc = config_.sourceManager && !location.start.isResolved()
+                           ? config_.sourceManager->resolve(location)
+                           : location;
   if (!loc.filename.empty()) {
     *output_ << " @" << loc.start.row << ":" << loc.start.column;
     if (loc.start.row != loc.end.row || loc.start.column != loc.end.column) {
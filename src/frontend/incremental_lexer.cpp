@@ -0,0 +1,303 @@
+#include "cxy/frontend/incremental_lexer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace cxy {
+
+/**
+ * Segments are kept in a treap ordered by position in the text: a binary
+ * tree in text order that is also a heap on random priorities, which keeps
+ * it balanced in expectation. Each node sums the segments, bytes and tokens
+ * of its subtree, so the segment at an index, byte offset or token index is
+ * one walk from the root, and a run of segments is replaced by splitting the
+ * tree around it and merging the new segments in.
+ */
+struct IncrementalLexer::Node {
+  struct Sums {
+    size_t count = 0;
+    size_t bytes = 0;
+    size_t tokens = 0;
+
+    Sums operator+(const Sums &other) const {
+      return {count + other.count, bytes + other.bytes, tokens + other.tokens};
+    }
+  };
+
+  Segment segment;
+  uint32_t priority;
+  Sums total; // Over this subtree
+  std::unique_ptr<Node> left;
+  std::unique_ptr<Node> right;
+
+  Node(Segment segment, uint32_t priority)
+      : segment(std::move(segment)), priority(priority), total(own()) {}
+
+  Sums own() const { return {1, segment.bytes, segment.tokens.size()}; }
+
+  static Sums sums(const std::unique_ptr<Node> &node) {
+    return node ? node->total : Sums{};
+  }
+
+  void refresh() { total = sums(left) + own() + sums(right); }
+
+  // Splits off the first `count` segments
+  static std::pair<std::unique_ptr<Node>, std::unique_ptr<Node>>
+  split(std::unique_ptr<Node> node, size_t count, size_t &steps) {
+    if (!node) {
+      return {};
+    }
+    ++steps;
+    const size_t before = sums(node->left).count;
+    if (count <= before) {
+      auto [first, rest] = split(std::move(node->left), count, steps);
+      node->left = std::move(rest);
+      node->refresh();
+      return {std::move(first), std::move(node)};
+    }
+    auto [first, rest] = split(std::move(node->right), count - before - 1, steps);
+    node->right = std::move(first);
+    node->refresh();
+    return {std::move(node), std::move(rest)};
+  }
+
+  // Joins two trees, all of `first` going before `second`
+  static std::unique_ptr<Node> merge(std::unique_ptr<Node> first,
+                                     std::unique_ptr<Node> second,
+                                     size_t &steps) {
+    if (!first || !second) {
+      return first ? std::move(first) : std::move(second);
+    }
+    ++steps;
+    if (first->priority > second->priority) {
+      first->right = merge(std::move(first->right), std::move(second), steps);
+      first->refresh();
+      return first;
+    }
+    second->left = merge(std::move(first), std::move(second->left), steps);
+    second->refresh();
+    return second;
+  }
+
+  // The last segment whose start, measured in `key` (segments, bytes or
+  // tokens before it), is at most `target`
+  static Located find(const Node *node, size_t target, size_t Sums::*key,
+                      size_t &steps) {
+    Located found;
+    Sums before;
+    while (node) {
+      ++steps;
+      const Sums start = before + sums(node->left);
+      if (start.*key > target) {
+        node = node->left.get();
+        continue;
+      }
+      found = {&node->segment, start.count, start.bytes, start.tokens};
+      before = start + node->own();
+      node = node->right.get();
+    }
+    return found;
+  }
+};
+
+IncrementalLexer::IncrementalLexer(std::string filename,
+                                   DiagnosticLogger &logger,
+                                   StringInterner &interner)
+    : filename_(std::move(filename)), logger_(logger), interner_(interner) {}
+
+IncrementalLexer::~IncrementalLexer() = default;
+
+void IncrementalLexer::reset(std::string_view text) {
+  std::vector<Segment> lexed;
+  size_t bytesLexed = 0;
+  size_t steps = 0;
+  root_.reset();
+  relex(text, Located{}, 0, 0, lexed, bytesLexed, steps);
+  for (auto &segment : lexed) {
+    root_ = Node::merge(
+        std::move(root_),
+        std::make_unique<Node>(std::move(segment), nextPriority()), steps);
+  }
+}
+
+IncrementalLexer::Update IncrementalLexer::update(std::string_view text,
+                                                  const Edit &edit) {
+  if (!root_) {
+    reset(text);
+    return {0, 0, size(), text.size(), 0};
+  }
+
+  // Restart at the last segment whose first token cannot have looked at the
+  // edited bytes; the first segment starts with no token before it
+  Update result;
+  const Located first = Node::find(
+      root_.get(), edit.offset > LOOKAHEAD ? edit.offset - LOOKAHEAD : 0,
+      &Node::Sums::bytes, result.treeSteps);
+  result.firstToken = first.firstToken;
+
+  const ptrdiff_t delta = static_cast<ptrdiff_t>(edit.inserted) -
+                          static_cast<ptrdiff_t>(edit.removed);
+  std::vector<Segment> lexed;
+  const size_t last =
+      relex(text, first, edit.offset + edit.inserted, delta, lexed,
+            result.bytesLexed, result.treeSteps);
+
+  // The segments after the resync point keep their lengths and tokens, which
+  // are relative to the segment start, so they move without being touched
+  auto [before, rest] =
+      Node::split(std::move(root_), first.index, result.treeSteps);
+  auto [replaced, after] =
+      Node::split(std::move(rest), last - first.index, result.treeSteps);
+  result.removedTokens = Node::sums(replaced).tokens;
+
+  std::unique_ptr<Node> inserted;
+  for (auto &segment : lexed) {
+    result.insertedTokens += segment.tokens.size();
+    inserted = Node::merge(
+        std::move(inserted),
+        std::make_unique<Node>(std::move(segment), nextPriority()),
+        result.treeSteps);
+  }
+  root_ = Node::merge(
+      Node::merge(std::move(before), std::move(inserted), result.treeSteps),
+      std::move(after), result.treeSteps);
+  return result;
+}
+
+size_t IncrementalLexer::relex(std::string_view text, const Located &first,
+                               size_t resyncFrom, ptrdiff_t delta,
+                               std::vector<Segment> &lexed,
+                               size_t &bytesLexed, size_t &steps) {
+  Lexer::Checkpoint state;
+  if (first.segment) {
+    state = first.segment->start;
+  }
+  state.offset = first.offset;
+
+  size_t next = first.offset;
+  Lexer lexer(
+      filename_,
+      [&](char *buffer, size_t capacity) {
+        const size_t count = std::min(capacity, text.size() - next);
+        std::memcpy(buffer, text.data() + next, count);
+        next += count;
+        return count;
+      },
+      logger_, interner_, CHUNK_SIZE, PositionMode::OffsetsOnly);
+  lexer.resume(state);
+
+  // Lengths run up to the next segment start, the last one to `end`
+  const auto finish = [&](size_t end) {
+    for (size_t i = 0; i < lexed.size(); ++i) {
+      const size_t to = i + 1 < lexed.size() ? lexed[i + 1].start.offset : end;
+      lexed[i].bytes = to - lexed[i].start.offset;
+    }
+    for (auto &segment : lexed) {
+      segment.start.offset = 0;
+    }
+    bytesLexed = end - first.offset;
+  };
+
+  // Old segment starts, moved to where they are in the new text
+  const size_t count = segmentCount();
+  size_t old = first.index;
+  Located oldSegment = root_ ? segmentAt(old, steps) : Located{};
+  ptrdiff_t oldStart = static_cast<ptrdiff_t>(oldSegment.offset) + delta;
+  while (true) {
+    if (state.offset >= resyncFrom) {
+      while (old < count && oldStart < static_cast<ptrdiff_t>(state.offset)) {
+        oldStart += static_cast<ptrdiff_t>(oldSegment.segment->bytes);
+        if (++old < count) {
+          oldSegment = segmentAt(old, steps);
+        }
+      }
+      if (old < count && oldStart == static_cast<ptrdiff_t>(state.offset) &&
+          oldSegment.segment->start.sameState(state)) {
+        finish(state.offset);
+        return old;
+      }
+    }
+
+    if (lexed.empty() || lexed.back().tokens.size() == SEGMENT_TOKENS) {
+      lexed.emplace_back().start = std::move(state);
+    }
+    Segment &segment = lexed.back();
+    CompactToken token = lexer.nextCompactToken();
+    if (token.hasLiteralValue() && (token.is(TokenKind::IntLiteral) ||
+                                    token.is(TokenKind::FloatLiteral))) {
+      segment.literals.push_back(lexer.getLiterals()[token.valueIndex]);
+      token.valueIndex = static_cast<uint32_t>(segment.literals.size() - 1);
+    }
+    token.offset -= static_cast<uint32_t>(segment.start.offset);
+    segment.tokens.push_back(token);
+    if (token.isEof()) {
+      finish(text.size());
+      return count;
+    }
+    state = lexer.checkpoint();
+  }
+}
+
+uint32_t IncrementalLexer::nextPriority() {
+  // xorshift32
+  seed_ ^= seed_ << 13;
+  seed_ ^= seed_ >> 17;
+  seed_ ^= seed_ << 5;
+  return seed_;
+}
+
+size_t IncrementalLexer::size() const {
+  return Node::sums(root_).tokens;
+}
+
+size_t IncrementalLexer::segmentCount() const {
+  return Node::sums(root_).count;
+}
+
+IncrementalLexer::Located IncrementalLexer::segmentAt(size_t index,
+                                                      size_t &steps) const {
+  return Node::find(root_.get(), index, &Node::Sums::count, steps);
+}
+
+IncrementalLexer::Located IncrementalLexer::segmentOf(size_t token) const {
+  size_t steps = 0;
+  return Node::find(root_.get(), token, &Node::Sums::tokens, steps);
+}
+
+CompactToken IncrementalLexer::operator[](size_t index) const {
+  const Located found = segmentOf(index);
+  CompactToken token = found.segment->tokens[index - found.firstToken];
+  token.offset += static_cast<uint32_t>(found.offset);
+  return token;
+}
+
+Token IncrementalLexer::expand(size_t index) const {
+  const Located found = segmentOf(index);
+  const Segment &segment = *found.segment;
+  const CompactToken &token = segment.tokens[index - found.firstToken];
+  const size_t offset = found.offset + token.offset;
+  Location location(filename_, Position::fromOffset(offset),
+                    Position::fromOffset(offset + token.length));
+  if (!token.hasLiteralValue()) {
+    return Token(token.kind, std::move(location));
+  }
+
+  switch (token.kind) {
+  case TokenKind::IntLiteral: {
+    const auto &literal = segment.literals[token.valueIndex].intValue;
+    return Token(token.kind, std::move(location), literal.value, literal.type);
+  }
+  case TokenKind::FloatLiteral: {
+    const auto &literal = segment.literals[token.valueIndex].floatValue;
+    return Token(token.kind, std::move(location), literal.value, literal.type);
+  }
+  case TokenKind::CharLiteral:
+    return Token(token.kind, std::move(location), token.valueIndex);
+  default:
+    return Token(token.kind, std::move(location),
+                 interner_.getString(SymbolId(token.valueIndex)));
+  }
+}
+
+} // namespace cxy
@@ -1,21 +1,79 @@
 #include "cxy/frontend/lexer.hpp"
 #include "cxy/diagnostics.hpp"
+#include "cxy/frontend/numbers.hpp"
+#include "cxy/frontend/scan.hpp"
 
+#include <algorithm>
+#include <array>
 #include <cctype>
+#include <charconv>
+#include <cstdint>
 #include <fstream>
-#include <unordered_map>
+#include <limits>
 
 namespace cxy {
 
 // Constructor
 Lexer::Lexer(std::string_view filename, std::string_view content,
-             DiagnosticLogger &logger, StringInterner &interner)
-    : logger(logger), interner(interner), templateDepth(0) {
-  bufferStack.push_back({filename, content, 0, 1, 1, 0});
+             DiagnosticLogger &logger, StringInterner &interner,
+             PositionMode positionMode)
+    : logger(logger), interner(interner), templateDepth(0),
+      positionMode(positionMode) {
+  if (content.size() > UINT32_MAX) {
+    // Token offsets are 32-bit
+    reportError(LexError::BufferOverflow,
+                Location(std::string(filename), Position()),
+                "Source file exceeds 4 GiB: " + std::string(filename));
+    content = {};
+  }
+  files.push_back({filename, content, {}});
+  bufferStack.push_back(
+      {filename, content, 0, 1, 1, 0, 0,
+       scan::validUtf8Prefix(content.data(), content.size())});
+}
+
+Lexer::Lexer(std::string_view filename, SourceReader reader,
+             DiagnosticLogger &logger, StringInterner &interner,
+             size_t chunkSize, PositionMode positionMode)
+    : logger(logger), interner(interner), templateDepth(0),
+      positionMode(positionMode),
+      stream(std::make_unique<StreamInput>()) {
+  stream->reader = std::move(reader);
+  stream->chunkSize = std::max<size_t>(chunkSize, STREAM_MARGIN);
+  // Line starts are recorded as bytes arrive, since the bytes themselves
+  // are gone by the time a location is resolved
+  files.push_back({filename, {}, {0}});
+  bufferStack.push_back({filename, {}, 0, 1, 1, 0, 0, 0});
+}
+
+Lexer::~Lexer() = default;
+
+Lexer::Checkpoint Lexer::checkpoint() const {
+  return {bufferStack.front().byteOffset, templateDepth, interpolationStack};
+}
+
+void Lexer::resume(const Checkpoint &checkpoint) {
+  // Nothing has been read, so the window starts at the checkpoint
+  stream->base = checkpoint.offset;
+  bufferStack.front().byteOffset = checkpoint.offset;
+  templateDepth = checkpoint.templateDepth;
+  interpolationStack = checkpoint.interpolation;
 }
 
 // Core tokenization interface
 Token Lexer::nextToken() {
+  const CompactToken token = nextCompactToken();
+  // The cursor still sits at the end of the token and its start was recorded
+  // when it was made, so nothing needs to be looked up
+  return expand(token, Location(std::string(files[token.file].filename),
+                                tokenStart, currentPosition()));
+}
+
+CompactToken Lexer::nextCompactToken() {
+  return stream ? nextStreamedToken() : lexToken();
+}
+
+CompactToken Lexer::lexToken() {
   while (true) {
     skipWhitespace();
 
@@ -23,7 +81,7 @@ Token Lexer::nextToken() {
       // If we're at the end of the current buffer
       if (bufferStack.size() <= 1) {
         // This is the main file, return EOF
-        return Token(TokenKind::EoF, getCurrentLocation());
+        return makeToken(TokenKind::EoF, currentPosition());
       } else {
         // We're at the end of an included file, pop back to parent
         popBuffer();
@@ -35,6 +93,132 @@ Token Lexer::nextToken() {
   }
 }
 
+CompactToken Lexer::nextStreamedToken() {
+  auto &input = *stream;
+  size_t lookahead = input.chunkSize;
+  while (true) {
+    if (input.window.size() - bufferStack.front().position < lookahead) {
+      fillStream(lookahead + input.chunkSize);
+    }
+
+    input.savedBuffers = bufferStack;
+    input.savedInterpolation = interpolationStack;
+    const size_t literalCount = literals.size();
+    const Position savedTokenStart = tokenStart;
+    const int savedTemplateDepth = templateDepth;
+
+    input.deferErrors = true;
+    const CompactToken token = lexToken();
+    input.deferErrors = false;
+
+    const size_t remaining =
+        input.window.size() - bufferStack.front().position;
+    if (input.exhausted || remaining >= STREAM_MARGIN) {
+      for (const auto &[location, message] : input.deferred) {
+        logger.error(location, "Lexical error: {}", message);
+      }
+      input.deferred.clear();
+      return token;
+    }
+
+    // The token, or the whitespace before it, ran up against the end of the
+    // window. Lex it again with twice the lookahead, which keeps the total
+    // work for a long token linear in its length.
+    bufferStack = input.savedBuffers;
+    interpolationStack = input.savedInterpolation;
+    literals.truncate(literalCount);
+    tokenStart = savedTokenStart;
+    templateDepth = savedTemplateDepth;
+    input.deferred.clear();
+    lookahead = 2 * (input.window.size() - bufferStack.front().position);
+  }
+}
+
+void Lexer::fillStream(size_t lookahead) {
+  auto &input = *stream;
+  auto &buffer = bufferStack.front();
+
+  // Everything before the cursor belongs to tokens already returned
+  input.window.erase(0, buffer.position);
+  input.base += buffer.position;
+  buffer.validUtf8 -= std::min(buffer.validUtf8, buffer.position);
+  buffer.position = 0;
+
+  auto &lineStarts = files.front().lineStarts;
+  while (!input.exhausted && input.window.size() < lookahead) {
+    const size_t size = input.window.size();
+    input.window.resize(size + input.chunkSize);
+    const size_t count =
+        input.reader(input.window.data() + size, input.chunkSize);
+    input.window.resize(size + count);
+    input.exhausted = count == 0;
+
+    for (size_t i = size;
+         positionMode == PositionMode::LineColumn && i < size + count; ++i) {
+      if (input.window[i] == '\n') {
+        lineStarts.push_back(static_cast<uint32_t>(input.base + i + 1));
+      }
+    }
+
+    if (input.base + input.window.size() > UINT32_MAX) {
+      // Token offsets are 32-bit
+      reportError(LexError::BufferOverflow,
+                  Location(std::string(buffer.filename), Position()),
+                  "Source file exceeds 4 GiB: " +
+                      std::string(buffer.filename));
+      input.window.resize(UINT32_MAX - input.base);
+      input.exhausted = true;
+    }
+  }
+
+  buffer.content = input.window;
+  files.front().content = input.window;
+  // Resume where the last check stopped, possibly on a sequence that was
+  // cut off by the end of the previous read
+  buffer.validUtf8 += scan::validUtf8Prefix(
+      input.window.data() + buffer.validUtf8,
+      input.window.size() - buffer.validUtf8);
+}
+
+Location Lexer::getLocation(const CompactToken &token) const {
+  const SourceFile &file = files[token.file];
+  const size_t end = size_t{token.offset} + token.length;
+  if (positionMode == PositionMode::OffsetsOnly) {
+    return Location(std::string(file.filename),
+                    Position::fromOffset(token.offset),
+                    Position::fromOffset(end));
+  }
+  return Location(std::string(file.filename),
+                  resolvePosition(file, token.offset),
+                  resolvePosition(file, end));
+}
+
+Token Lexer::expand(const CompactToken &token) const {
+  return expand(token, getLocation(token));
+}
+
+Token Lexer::expand(const CompactToken &token, Location location) const {
+  if (!token.hasLiteralValue()) {
+    return Token(token.kind, std::move(location));
+  }
+
+  switch (token.kind) {
+  case TokenKind::IntLiteral: {
+    const auto &literal = literals[token.valueIndex].intValue;
+    return Token(token.kind, std::move(location), literal.value, literal.type);
+  }
+  case TokenKind::FloatLiteral: {
+    const auto &literal = literals[token.valueIndex].floatValue;
+    return Token(token.kind, std::move(location), literal.value, literal.type);
+  }
+  case TokenKind::CharLiteral:
+    return Token(token.kind, std::move(location), token.valueIndex);
+  default:
+    return Token(token.kind, std::move(location),
+                 interner.getString(SymbolId(token.valueIndex)));
+  }
+}
+
 // State queries
 bool Lexer::isAtEnd() const { return bufferStack.empty() || isAtBufferEnd(); }
 
@@ -44,7 +228,7 @@ Location Lexer::getCurrentLocation() const {
   }
 
   const auto &buffer = currentBuffer();
-  Position pos(buffer.line, buffer.column, buffer.byteOffset);
+  Position pos = currentPosition();
   return Location(std::string(buffer.filename), pos,
                   pos); // Single position location
 }
@@ -56,7 +240,7 @@ Location Lexer::makeLocation(const Position &start) const {
   }
 
   const auto &buffer = currentBuffer();
-  Position end(buffer.line, buffer.column, buffer.byteOffset);
+  Position end = currentPosition();
   return Location(std::string(buffer.filename), start, end);
 }
 
@@ -69,7 +253,18 @@ bool Lexer::pushBuffer(std::string_view filename, std::string_view content) {
     return false;
   }
 
-  bufferStack.push_back({filename, content, 0, 1, 1, 0});
+  if (files.size() > UINT16_MAX || content.size() > UINT32_MAX) {
+    reportError(LexError::BufferOverflow,
+                "Cannot include " + std::string(filename) +
+                    ": too many files or file exceeds 4 GiB");
+    return false;
+  }
+
+  const auto file = static_cast<FileID>(files.size());
+  files.push_back({filename, content, {}});
+  bufferStack.push_back(
+      {filename, content, 0, 1, 1, 0, file,
+       scan::validUtf8Prefix(content.data(), content.size())});
   return true;
 }
 
@@ -79,231 +274,171 @@ void Lexer::popBuffer() {
   }
 }
 
+// Operator lexing generated from SYMBOL_LIST at compile time. The operators
+// form a trie over their characters. Bytes that occur in some operator are
+// numbered by a 256-entry class table, and each trie state holds one
+// transition per class, so the longest operator at the cursor is found with
+// one transition lookup per character, at most three, and the cursor is
+// bumped once by its length.
+namespace {
+
+struct SymbolEntry {
+  std::string_view text;
+  TokenKind kind;
+};
+
+constexpr SymbolEntry SYMBOLS[] = {
+#define SYMBOL_ENTRY(name, str) {str, TokenKind::name},
+    SYMBOL_LIST(SYMBOL_ENTRY)
+#undef SYMBOL_ENTRY
+};
+
+// Operator overload names in SYMBOL_LIST, such as `[]=`, are spelled with
+// several tokens that the parser puts together, so the lexer never forms them
+constexpr bool isLexedSymbol(TokenKind kind) {
+  return kind != TokenKind::CallOverride && kind != TokenKind::IndexOverride &&
+         kind != TokenKind::IndexAssignOvd &&
+         kind != TokenKind::TruthyOverload;
+}
+
+class OperatorTrie {
+public:
+  static constexpr size_t MAX_LENGTH = 3;
+
+  struct Match {
+    TokenKind kind;
+    size_t length; // 0 when no operator starts at the cursor
+  };
+
+private:
+  static constexpr size_t MAX_CLASSES = 32;
+  static constexpr size_t MAX_STATES = 64;
+
+  // Class 0 is every byte that occurs in no operator, and state 0 is the
+  // root, which no transition leads back to, so 0 doubles as "no match"
+  std::array<uint8_t, 256> classes{};
+  std::array<std::array<uint8_t, MAX_CLASSES>, MAX_STATES> transitions{};
+  std::array<TokenKind, MAX_STATES> accepts{};
+
+public:
+  consteval OperatorTrie() {
+    accepts.fill(TokenKind::Error);
+    size_t classCount = 1;
+    size_t stateCount = 1;
+    for (const auto &symbol : SYMBOLS) {
+      if (!isLexedSymbol(symbol.kind)) {
+        continue;
+      }
+      if (symbol.text.empty() || symbol.text.size() > MAX_LENGTH) {
+        throw "operators must be one to MAX_LENGTH characters long";
+      }
+
+      size_t state = 0;
+      for (char c : symbol.text) {
+        auto &byteClass = classes[static_cast<unsigned char>(c)];
+        if (byteClass == 0) {
+          if (classCount == MAX_CLASSES) {
+            throw "too many distinct operator characters; raise MAX_CLASSES";
+          }
+          byteClass = static_cast<uint8_t>(classCount++);
+        }
+        auto &next = transitions[state][byteClass];
+        if (next == 0) {
+          if (stateCount == MAX_STATES) {
+            throw "too many operator prefixes; raise MAX_STATES";
+          }
+          next = static_cast<uint8_t>(stateCount++);
+        }
+        state = next;
+      }
+      if (accepts[state] != TokenKind::Error) {
+        throw "two operators share a spelling";
+      }
+      accepts[state] = symbol.kind;
+    }
+  }
+
+  // Longest operator at the start of [text, text + available)
+  [[nodiscard]] constexpr Match longest(const char *text,
+                                        size_t available) const {
+    Match match{TokenKind::Error, 0};
+    size_t state = 0;
+    const size_t limit = std::min(available, MAX_LENGTH);
+    for (size_t i = 0; i < limit; ++i) {
+      state = transitions[state][classes[static_cast<unsigned char>(text[i])]];
+      if (state == 0) {
+        break;
+      }
+      if (accepts[state] != TokenKind::Error) {
+        match = {accepts[state], i + 1};
+      }
+    }
+    return match;
+  }
+};
+
+constexpr OperatorTrie operatorTrie;
+
+static_assert(
+    [] {
+      for (const auto &symbol : SYMBOLS) {
+        const auto match =
+            operatorTrie.longest(symbol.text.data(), symbol.text.size());
+        if (isLexedSymbol(symbol.kind)
+                ? match.kind != symbol.kind ||
+                      match.length != symbol.text.size()
+                : match.length == symbol.text.size()) {
+          return false;
+        }
+      }
+      // Maximal munch, falling back to a shorter prefix
+      return operatorTrie.longest("..=", 3).kind == TokenKind::DotDot &&
+             operatorTrie.longest("<<<", 3).kind == TokenKind::Shl &&
+             operatorTrie.longest("a", 1).length == 0;
+    }(),
+    "operator trie does not round-trip");
+
+} // namespace
+
 // Core lexing methods
-Token Lexer::lexNextToken() {
+CompactToken Lexer::lexNextToken() {
   char c = currentChar();
-  const auto &buffer = currentBuffer();
-  Position start(buffer.line, buffer.column, buffer.byteOffset);
+  Position start = currentPosition();
 
-  // Handle basic punctuation and operators
+  // Characters that start something other than a plain operator
   switch (c) {
-  case '+':
-    advance();
-    if (currentChar() == '+') {
-      advance();
-      return Token(TokenKind::PlusPlus, makeLocation(start));
-    } else if (currentChar() == '=') {
-      advance();
-      return Token(TokenKind::PlusEqual, makeLocation(start));
-    }
-    return Token(TokenKind::Plus, makeLocation(start));
-  case '-':
-    advance();
-    if (currentChar() == '-') {
-      advance();
-      return Token(TokenKind::MinusMinus, makeLocation(start));
-    } else if (currentChar() == '=') {
-      advance();
-      return Token(TokenKind::MinusEqual, makeLocation(start));
-    } else if (currentChar() == '>') {
-      advance();
-      return Token(TokenKind::ThinArrow, makeLocation(start));
-    }
-    return Token(TokenKind::Minus, makeLocation(start));
-  case '*':
-    advance();
-    if (currentChar() == '=') {
-      advance();
-      return Token(TokenKind::MultEqual, makeLocation(start));
-    }
-    return Token(TokenKind::Mult, makeLocation(start));
   case '/':
-    advance();
-    if (currentChar() == '/') {
+    if (peekChar(1) == '/') {
       // Line comment - skip to end of line
+      advance();
       skipLineComment();
-      return nextToken(); // Use nextToken() to handle whitespace properly
-    } else if (currentChar() == '*') {
+      return lexToken(); // Handles the whitespace that follows
+    } else if (peekChar(1) == '*') {
       // Block comment - skip to closing */
-      skipBlockComment();
-      return nextToken(); // Use nextToken() to handle whitespace properly
-    } else if (currentChar() == '=') {
-      advance();
-      return Token(TokenKind::DivEqual, makeLocation(start));
-    }
-    return Token(TokenKind::Div, makeLocation(start));
-  case '%':
-    advance();
-    if (currentChar() == '=') {
-      advance();
-      return Token(TokenKind::ModEqual, makeLocation(start));
-    }
-    return Token(TokenKind::Mod, makeLocation(start));
-  case '=':
-    advance();
-    if (currentChar() == '=') {
-      advance();
-      return Token(TokenKind::Equal, makeLocation(start));
-    } else if (currentChar() == '>') {
-      advance();
-      return Token(TokenKind::FatArrow, makeLocation(start));
-    }
-    return Token(TokenKind::Assign, makeLocation(start));
-  case '!':
-    advance();
-    if (currentChar() == '=') {
-      advance();
-      return Token(TokenKind::NotEqual, makeLocation(start));
-    } else if (currentChar() == ':') {
-      advance();
-      return Token(TokenKind::BangColon, makeLocation(start));
-    }
-    return Token(TokenKind::LNot, makeLocation(start));
-  case '<':
-    advance();
-    if (currentChar() == '=') {
-      advance();
-      return Token(TokenKind::LessEqual, makeLocation(start));
-    } else if (currentChar() == '<') {
-      advance();
-      if (currentChar() == '=') {
-        advance();
-        return Token(TokenKind::ShlEqual, makeLocation(start));
-      }
-      return Token(TokenKind::Shl, makeLocation(start));
-    }
-    return Token(TokenKind::Less, makeLocation(start));
-  case '>':
-    advance();
-    if (currentChar() == '=') {
-      advance();
-      return Token(TokenKind::GreaterEqual, makeLocation(start));
-    } else if (currentChar() == '>') {
-      // In template context, split >> into two separate > tokens
-      if (inTemplateContext()) {
-        // Don't advance past the second >, return first > and let next call handle second >
-        return Token(TokenKind::Greater, makeLocation(start));
-      }
-      // Normal >> handling outside template context
-      advance();
-      if (currentChar() == '=') {
-        advance();
-        return Token(TokenKind::ShrEqual, makeLocation(start));
-      }
-      return Token(TokenKind::Shr, makeLocation(start));
-    }
-    return Token(TokenKind::Greater, makeLocation(start));
-  case '&':
-    advance();
-    if (currentChar() == '&') {
-      advance();
-      return Token(TokenKind::LAnd, makeLocation(start));
-    } else if (currentChar() == '=') {
       advance();
-      return Token(TokenKind::BAndEqual, makeLocation(start));
-    } else if (currentChar() == '.') {
-      advance();
-      return Token(TokenKind::BAndDot, makeLocation(start));
-    }
-    return Token(TokenKind::BAnd, makeLocation(start));
-  case '|':
-    advance();
-    if (currentChar() == '|') {
-      advance();
-      return Token(TokenKind::LOr, makeLocation(start));
-    } else if (currentChar() == '=') {
-      advance();
-      return Token(TokenKind::BOrEqual, makeLocation(start));
-    }
-    return Token(TokenKind::BOr, makeLocation(start));
-  case '^':
-    advance();
-    if (currentChar() == '=') {
-      advance();
-      return Token(TokenKind::BXorEqual, makeLocation(start));
-    }
-    return Token(TokenKind::BXor, makeLocation(start));
-  case '~':
-    advance();
-    return Token(TokenKind::BNot, makeLocation(start));
-  case ';':
-    advance();
-    return Token(TokenKind::Semicolon, makeLocation(start));
-  case ',':
-    advance();
-    return Token(TokenKind::Comma, makeLocation(start));
-  case ':':
-    advance();
-    if (currentChar() == ':') {
-      advance();
-      return Token(TokenKind::ColonColon, makeLocation(start));
-    }
-    return Token(TokenKind::Colon, makeLocation(start));
-  case '?':
-    advance();
-    return Token(TokenKind::Question, makeLocation(start));
-  case '@':
-    advance();
-    return Token(TokenKind::At, makeLocation(start));
-  case '`':
-    advance();
-    return Token(TokenKind::Quote, makeLocation(start));
-  case '#':
-    advance();
-    if (!isAtEnd() && currentChar() == '#') {
-      advance();
-      return Token(TokenKind::Define, makeLocation(start));
-    } else if (!isAtEnd() && currentChar() == '.') {
-      advance();
-      return Token(TokenKind::AstMacroAccess, makeLocation(start));
-    }
-    return Token(TokenKind::Hash, makeLocation(start));
-  case '.':
-    advance();
-    if (currentChar() == '.') {
-      advance();
-      if (currentChar() == '<') {
-        advance();
-        return Token(TokenKind::DotDotLess, makeLocation(start));
-      }
-      if (currentChar() == '.') {
-        advance();
-        return Token(TokenKind::Elipsis, makeLocation(start));
-      }
-      return Token(TokenKind::DotDot, makeLocation(start));
+      skipBlockComment();
+      return lexToken(); // Handles the whitespace that follows
     }
-    return Token(TokenKind::Dot, makeLocation(start));
-  case '(':
-    advance();
-    return Token(TokenKind::LParen, makeLocation(start));
-  case ')':
-    advance();
-    return Token(TokenKind::RParen, makeLocation(start));
+    break;
   case '{':
     advance();
     if (inInterpolation() && currentInterpolationContext().inExpression) {
       currentInterpolationContext().braceDepth++;
     }
-    return Token(TokenKind::LBrace, makeLocation(start));
+    return makeToken(TokenKind::LBrace, start);
   case '}':
     advance();
     if (inInterpolation() && currentInterpolationContext().inExpression) {
       if (currentInterpolationContext().braceDepth > 0) {
         currentInterpolationContext().braceDepth--;
-        return Token(TokenKind::RBrace, makeLocation(start));
+        return makeToken(TokenKind::RBrace, start);
       } else {
         // End of interpolation expression - transition back to string parsing
         exitExpressionMode();
         return continueStringAfterExpression();
       }
     }
-    return Token(TokenKind::RBrace, makeLocation(start));
-  case '[':
-    advance();
-    return Token(TokenKind::LBracket, makeLocation(start));
-  case ']':
-    advance();
-    return Token(TokenKind::RBracket, makeLocation(start));
+    return makeToken(TokenKind::RBrace, start);
   case '"': {
     // For nested strings within expressions, the string will manage its own
     // interpolation context via the stack
@@ -315,6 +450,27 @@ Token Lexer::lexNextToken() {
     break;
   }
 
+  // Operators and punctuation, none of which spans a line
+  auto &buffer = currentBuffer();
+  const auto match =
+      operatorTrie.longest(buffer.content.data() + buffer.position,
+                           buffer.content.size() - buffer.position);
+  if (match.length > 0) {
+    TokenKind kind = match.kind;
+    size_t length = match.length;
+    if ((kind == TokenKind::Shr || kind == TokenKind::ShrEqual) &&
+        inTemplateContext()) {
+      // In template context `>>` closes two argument lists: take the first
+      // `>` and leave the rest for the next call
+      kind = TokenKind::Greater;
+      length = 1;
+    }
+    buffer.position += length;
+    buffer.byteOffset += length;
+    buffer.column += length;
+    return makeToken(kind, start);
+  }
+
   // Handle identifiers, keywords, and raw strings
   if (isIdentifierStart(c)) {
     // Check for raw string literal
@@ -370,11 +526,15 @@ void Lexer::advance() {
   if (!isAtBufferEnd()) {
     auto &buffer = currentBuffer();
 
-    if (buffer.content[buffer.position] == '\n') {
-      buffer.line++;
-      buffer.column = 1;
-    } else {
-      buffer.column++;
+    // In offset-only mode row and column are recovered from the offset on
+    // demand, so the per-byte bookkeeping is skipped altogether
+    if (positionMode == PositionMode::LineColumn) {
+      if (buffer.content[buffer.position] == '\n') {
+        buffer.line++;
+        buffer.column = 1;
+      } else {
+        buffer.column++;
+      }
     }
 
     buffer.position++;
@@ -382,49 +542,305 @@ void Lexer::advance() {
   }
 }
 
+void Lexer::skipScanned(const scan::Skip &skip) {
+  auto &buffer = currentBuffer();
+  if (positionMode == PositionMode::LineColumn) {
+    if (skip.newlines > 0) {
+      buffer.line += skip.newlines;
+      buffer.column = skip.length - skip.lineStart + 1;
+    } else {
+      buffer.column += skip.length;
+    }
+  }
+  buffer.position += skip.length;
+  buffer.byteOffset += skip.length;
+}
+
+void Lexer::skipUntilAny(char first, char second, char third) {
+  const auto &buffer = currentBuffer();
+  skipScanned(scan::skipUntil(buffer.content.data() + buffer.position,
+                              buffer.content.size() - buffer.position, first,
+                              second, third));
+}
+
 void Lexer::skipWhitespace() {
-  while (!isAtEnd() && isWhitespace(currentChar())) {
-    advance();
+  if (isAtEnd()) {
+    return;
   }
+  const auto &buffer = currentBuffer();
+  skipScanned(scan::skipWhitespace(buffer.content.data() + buffer.position,
+                                   buffer.content.size() - buffer.position));
 }
 
-// Keyword lookup table generated from KEYWORD_LIST macro
-static const std::unordered_map<std::string_view, TokenKind> keywordMap = {
+// Keyword lookup generated from KEYWORD_LIST at compile time. Each keyword is
+// keyed on its length, first and last two characters, which are unique
+// across the list, and placed by a minimal perfect hash built with hash and
+// displace: the key's bucket picks a displacement, and the displaced hash
+// picks one of exactly KEYWORD_COUNT slots. Classifying an identifier is then
+// a single slot compare, with no static initializer at startup.
+namespace {
+
+struct KeywordEntry {
+  std::string_view text;
+  TokenKind kind;
+};
+
+constexpr KeywordEntry KEYWORDS[] = {
 #define KEYWORD_ENTRY(name, str) {str, TokenKind::name},
     KEYWORD_LIST(KEYWORD_ENTRY)
 #undef KEYWORD_ENTRY
 };
 
+class KeywordTable {
+public:
+  static constexpr size_t KEYWORD_COUNT = std::size(KEYWORDS);
+  static constexpr size_t BUCKET_COUNT = 32;
+
+private:
+  std::array<KeywordEntry, KEYWORD_COUNT> slots{};
+  std::array<uint8_t, BUCKET_COUNT> displacements{};
+  size_t minLength = SIZE_MAX;
+  size_t maxLength = 0;
+
+  // Callers guarantee text.size() >= 2
+  [[nodiscard]] static constexpr uint32_t keyOf(std::string_view text) {
+    const auto at = [&](size_t i) {
+      return static_cast<uint32_t>(static_cast<unsigned char>(text[i]));
+    };
+    return static_cast<uint32_t>(text.size() & 0xff) | at(0) << 8 |
+           at(text.size() - 2) << 16 | at(text.size() - 1) << 24;
+  }
+
+  [[nodiscard]] static constexpr uint32_t hashKey(uint32_t key,
+                                                  uint32_t seed) {
+    const uint64_t mixed =
+        (key ^ (seed * 0x9e3779b97f4a7c15ULL)) * 0xbf58476d1ce4e5b9ULL;
+    return static_cast<uint32_t>(mixed >> 32);
+  }
+
+  // Map a 32-bit hash onto [0, range) without a division
+  [[nodiscard]] static constexpr size_t reduce(uint32_t hash, size_t range) {
+    return static_cast<size_t>((uint64_t{hash} * range) >> 32);
+  }
+
+public:
+  consteval KeywordTable() {
+    std::array<uint32_t, KEYWORD_COUNT> keys{};
+    std::array<size_t, KEYWORD_COUNT> bucketOf{};
+    std::array<size_t, BUCKET_COUNT> bucketSizes{};
+    for (size_t i = 0; i < KEYWORD_COUNT; ++i) {
+      const std::string_view text = KEYWORDS[i].text;
+      if (text.size() < 2) {
+        throw "keywords must be at least two characters long";
+      }
+      minLength = std::min(minLength, text.size());
+      maxLength = std::max(maxLength, text.size());
+      keys[i] = keyOf(text);
+      for (size_t j = 0; j < i; ++j) {
+        if (keys[j] == keys[i]) {
+          throw "two keywords share length, first and last two characters";
+        }
+      }
+      bucketOf[i] = reduce(hashKey(keys[i], 0), BUCKET_COUNT);
+      ++bucketSizes[bucketOf[i]];
+    }
+
+    // Place the crowded buckets first, while most slots are still free
+    std::array<size_t, BUCKET_COUNT> order{};
+    for (size_t b = 0; b < BUCKET_COUNT; ++b) {
+      order[b] = b;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      return bucketSizes[a] != bucketSizes[b] ? bucketSizes[a] > bucketSizes[b]
+                                              : a < b;
+    });
+
+    std::array<bool, KEYWORD_COUNT> used{};
+    for (size_t bucket : order) {
+      if (bucketSizes[bucket] == 0) {
+        break;
+      }
+      bool placed = false;
+      for (uint32_t displacement = 1; displacement <= 0xff && !placed;
+           ++displacement) {
+        std::array<bool, KEYWORD_COUNT> taken = used;
+        placed = true;
+        for (size_t i = 0; i < KEYWORD_COUNT && placed; ++i) {
+          if (bucketOf[i] != bucket) {
+            continue;
+          }
+          const size_t slot =
+              reduce(hashKey(keys[i], displacement), KEYWORD_COUNT);
+          placed = !taken[slot];
+          taken[slot] = true;
+        }
+        if (placed) {
+          used = taken;
+          displacements[bucket] = static_cast<uint8_t>(displacement);
+          for (size_t i = 0; i < KEYWORD_COUNT; ++i) {
+            if (bucketOf[i] == bucket) {
+              slots[reduce(hashKey(keys[i], displacement), KEYWORD_COUNT)] =
+                  KEYWORDS[i];
+            }
+          }
+        }
+      }
+      if (!placed) {
+        throw "no keyword displacement found; adjust BUCKET_COUNT";
+      }
+    }
+  }
+
+  // Returns TokenKind::Ident when `text` is not a keyword
+  [[nodiscard]] constexpr TokenKind find(std::string_view text) const {
+    if (text.size() < minLength || text.size() > maxLength) {
+      return TokenKind::Ident;
+    }
+    const uint32_t key = keyOf(text);
+    const uint32_t displacement =
+        displacements[reduce(hashKey(key, 0), BUCKET_COUNT)];
+    const KeywordEntry &entry =
+        slots[reduce(hashKey(key, displacement), KEYWORD_COUNT)];
+    return entry.text == text ? entry.kind : TokenKind::Ident;
+  }
+};
+
+constexpr KeywordTable keywordTable;
+
+static_assert(
+    [] {
+      for (const auto &keyword : KEYWORDS) {
+        if (keywordTable.find(keyword.text) != keyword.kind) {
+          return false;
+        }
+      }
+      return keywordTable.find("raisf") == TokenKind::Ident;
+    }(),
+    "keyword perfect hash does not round-trip");
+
+} // namespace
+
 // Basic identifier/keyword lexing
-Token Lexer::lexIdentifierOrKeyword() {
-  const auto &buffer = currentBuffer();
-  Position start(buffer.line, buffer.column, buffer.byteOffset);
-  size_t startPos = buffer.position;
+CompactToken Lexer::lexIdentifierOrKeyword() {
+  auto &buffer = currentBuffer();
+  Position start = currentPosition();
+  const char *text = buffer.content.data() + buffer.position;
+  const size_t available = buffer.content.size() - buffer.position;
+
+  // Identifiers never span lines, so scan the bytes directly, hashing each one
+  // as it is read, and move the cursor once at the end
+  StringHasher hasher;
+  size_t length = 0;
+  while (length < available && isIdentifierContinue(text[length])) {
+    hasher.add(text[length++]);
+  }
+  buffer.position += length;
+  buffer.byteOffset += length;
+  buffer.column += length;
+
+  const std::string_view identifier(text, length);
+  const TokenKind kind = keywordTable.find(identifier);
+  if (kind != TokenKind::Ident) {
+    return makeToken(kind, start);
+  }
+
+  // Intern the identifier text, reusing the scan hash
+  const SymbolId symbol = interner.internSymbol(identifier, hasher.finish());
+  return makeToken(TokenKind::Ident, start, symbol.index());
+}
 
-  while (!isAtEnd() && isIdentifierContinue(currentChar())) {
-    advance();
+namespace {
+
+// Largest value that can take eight more decimal digits without overflowing
+constexpr __uint128_t MAX_BEFORE_EIGHT_DIGITS =
+    (~__uint128_t{0} - 99999999) / 100000000;
+
+// Exponent digits stop accumulating past this, well outside double range
+constexpr int MAX_EXPONENT_DIGITS_VALUE = 100000;
+
+// Significant digits of a decimal float literal. The first 19 fit the
+// mantissa exactly; later ones only scale the exponent and mark the mantissa
+// as truncated.
+struct DecimalDigits {
+  static constexpr int MAX_DIGITS = 19;
+
+  uint64_t mantissa = 0;
+  int64_t exponent = 0;
+  int count = 0;
+  bool truncated = false;
+
+  void add(int digit, bool fractional) {
+    if (count == 0 && digit == 0) {
+      exponent -= fractional;
+      return;
+    }
+    if (count < MAX_DIGITS) {
+      mantissa = mantissa * 10 + digit;
+      ++count;
+      exponent -= fractional;
+    } else {
+      truncated |= digit != 0;
+      exponent += !fractional;
+    }
   }
 
-  size_t endPos = currentBuffer().position;
-  std::string_view text(currentBuffer().content.data() + startPos,
-                        endPos - startPos);
+  // Eight digits at once, once past the leading zeros and while they fit
+  bool addEight(uint64_t chunk, bool fractional) {
+    if (count == 0 || count + 8 > MAX_DIGITS ||
+        !numbers::isEightDigits(chunk)) {
+      return false;
+    }
+    mantissa = mantissa * 100000000 + numbers::parseEightDigits(chunk);
+    count += 8;
+    exponent -= fractional ? 8 : 0;
+    return true;
+  }
 
-  // Check if the text is a keyword
-  auto it = keywordMap.find(text);
-  if (it != keywordMap.end()) {
-    return Token(it->second, makeLocation(start));
+  // Add the run of digits and separators at the start of [data, data +
+  // size), returning its length
+  size_t scan(const char *data, size_t size, bool fractional) {
+    size_t i = 0;
+    while (i < size) {
+      if (i + 8 <= size && addEight(numbers::loadEight(data + i), fractional)) {
+        i += 8;
+      } else if (data[i] >= '0' && data[i] <= '9') {
+        add(data[i++] - '0', fractional);
+      } else if (data[i] == '_') {
+        ++i;
+      } else {
+        break;
+      }
+    }
+    return i;
   }
+};
 
-  // Intern the identifier text
-  InternedString internedIdent = interner.intern(text);
-  return Token(TokenKind::Ident, makeLocation(start), internedIdent);
+// Slow path for literals with more digits than the mantissa holds
+double parseDecimalExactly(std::string_view text, double fallback) {
+  std::string digits;
+  digits.reserve(text.size());
+  for (char c : text) {
+    if (c != '_') {
+      digits.push_back(c);
+    }
+  }
+  double value = fallback;
+  const auto result =
+      std::from_chars(digits.data(), digits.data() + digits.size(), value);
+  if (result.ec == std::errc::result_out_of_range) {
+    // The estimate already sits at the edge of the range
+    return fallback >= 1.0 ? std::numeric_limits<double>::infinity() : 0.0;
+  }
+  return result.ec == std::errc() ? value : fallback;
 }
 
+} // namespace
+
 // Enhanced number lexing with multiple bases, underscores, and type suffixes
 // (Phase 2)
-Token Lexer::lexNumber() {
+CompactToken Lexer::lexNumber() {
   const auto &buffer = currentBuffer();
-  Position start(buffer.line, buffer.column, buffer.byteOffset);
+  Position start = currentPosition();
   size_t startPos = buffer.position;
 
   // Determine the base
@@ -470,6 +886,28 @@ Token Lexer::lexNumber() {
   bool hasDigits = false;
 
   while (!isAtBufferEnd()) {
+    // Eight plain digits at a time while the result cannot overflow;
+    // separators, markers and the tail take the byte loop below
+    if ((base == 10 || base == 16) &&
+        buffer.position + 8 <= buffer.content.size()) {
+      const uint64_t chunk =
+          numbers::loadEight(buffer.content.data() + buffer.position);
+      if (base == 10 && value <= MAX_BEFORE_EIGHT_DIGITS &&
+          numbers::isEightDigits(chunk)) {
+        value = value * 100000000 + numbers::parseEightDigits(chunk);
+        hasDigits = true;
+        skipScanned(scan::Skip{.length = 8});
+        continue;
+      }
+      if (base == 16 && (value >> 96) == 0 &&
+          numbers::isEightHexDigits(chunk)) {
+        value = (value << 32) | numbers::parseEightHexDigits(chunk);
+        hasDigits = true;
+        skipScanned(scan::Skip{.length = 8});
+        continue;
+      }
+    }
+
     char c = currentChar();
 
     if (c == '_') {
@@ -488,16 +926,16 @@ Token Lexer::lexNumber() {
         break;
       }
       // This is a floating point number
-      return lexFloat(start, base, value, hasDigits);
+      return lexFloat(start, startPos, base, value, hasDigits);
     } else if ((base == 10 && (c == 'e' || c == 'E')) || (base == 16 && (c == 'p' || c == 'P'))) {
       // This is a floating point number
-      return lexFloat(start, base, value, hasDigits);
+      return lexFloat(start, startPos, base, value, hasDigits);
     }
 
     // Check for float suffix (only for decimal base)
     if (base == 10 && (c == 'f' || c == 'F' || c == 'd' || c == 'D')) {
       // This is a floating point number with suffix
-      return lexFloat(start, base, value, hasDigits);
+      return lexFloat(start, startPos, base, value, hasDigits);
     }
 
     int digit = -1;
@@ -545,7 +983,7 @@ Token Lexer::lexNumber() {
   // Check if we have at least one digit
   if (!hasDigits || (hasPrefix && !hasDigits)) {
     reportError(LexError::InvalidNumber, "Invalid integer literal: no digits");
-    return Token(TokenKind::Error, makeLocation(start));
+    return makeToken(TokenKind::Error, start);
   }
 
   // Parse type suffix
@@ -560,16 +998,26 @@ Token Lexer::lexNumber() {
     }
   }
 
-  return Token(TokenKind::IntLiteral, makeLocation(start), value, type);
+  return makeToken(TokenKind::IntLiteral, start,
+                   literals.add(Token::Value(value, type)));
 }
 
 // Enhanced floating-point lexing (Phase 3)
-Token Lexer::lexFloat(const Position &start, int base, __uint128_t integerPart,
-                      bool hasIntegerPart) {
+CompactToken Lexer::lexFloat(const Position &start, size_t startPos, int base,
+                             __uint128_t integerPart, bool hasIntegerPart) {
+  const auto &buffer = currentBuffer();
   double value = static_cast<double>(integerPart);
   bool hasDecimalPart = false;
   bool hasExponent = false;
 
+  // Decimal literals are rounded once, from their digits, at the end. The
+  // integer digits were consumed by lexNumber, so read them back.
+  DecimalDigits decimal;
+  if (base == 10) {
+    decimal.scan(buffer.content.data() + startPos, buffer.position - startPos,
+                 false);
+  }
+
   // Handle decimal point and fractional part
   if (!isAtBufferEnd() && currentChar() == '.') {
     advance(); // consume '.'
@@ -578,7 +1026,14 @@ Token Lexer::lexFloat(const Position &start, int base, __uint128_t integerPart,
     double fractionalValue = 0.0;
     double fractionalDivisor = base;
 
-    while (!isAtBufferEnd()) {
+    if (base == 10) {
+      skipScanned(scan::Skip{
+          .length = decimal.scan(buffer.content.data() + buffer.position,
+                                 buffer.content.size() - buffer.position,
+                                 true)});
+    }
+
+    while (base != 10 && !isAtBufferEnd()) {
       char c = currentChar();
 
       if (c == '_') {
@@ -644,40 +1099,60 @@ Token Lexer::lexFloat(const Position &start, int base, __uint128_t integerPart,
         break;
       }
 
-      exponentValue = exponentValue * 10 + (expChar - '0');
+      // Saturate; anything this large is zero or infinity anyway
+      if (exponentValue < MAX_EXPONENT_DIGITS_VALUE) {
+        exponentValue = exponentValue * 10 + (expChar - '0');
+      }
       hasExpDigits = true;
       advance();
     }
 
     if (!hasExpDigits) {
       reportError(LexError::InvalidNumber, "Invalid exponent: no digits");
-      return Token(TokenKind::Error, makeLocation(start));
+      return makeToken(TokenKind::Error, start);
     }
 
     if (expNegative) {
       exponentValue = -exponentValue;
     }
 
-    // Apply exponent
-    double expBase = (base == 16) ? 2.0 : 10.0;
-    double expMultiplier = 1.0;
-    if (exponentValue >= 0) {
-      for (int i = 0; i < exponentValue; i++) {
-        expMultiplier *= expBase;
-      }
+    if (base == 10) {
+      decimal.exponent += exponentValue;
     } else {
-      for (int i = 0; i < -exponentValue; i++) {
-        expMultiplier /= expBase;
+      // Apply exponent
+      double expBase = (base == 16) ? 2.0 : 10.0;
+      double expMultiplier = 1.0;
+      if (exponentValue >= 0) {
+        for (int i = 0; i < exponentValue; i++) {
+          expMultiplier *= expBase;
+        }
+      } else {
+        for (int i = 0; i < -exponentValue; i++) {
+          expMultiplier /= expBase;
+        }
       }
+      value *= expMultiplier;
+    }
+  }
+
+  if (base == 10) {
+    value = numbers::decimalToDouble(decimal.mantissa, decimal.exponent);
+    if (decimal.truncated &&
+        value != numbers::decimalToDouble(decimal.mantissa + 1,
+                                          decimal.exponent)) {
+      // The dropped digits decide the rounding, so read all of them
+      value = parseDecimalExactly(std::string_view(buffer.content)
+                                      .substr(startPos,
+                                              buffer.position - startPos),
+                                  value);
     }
-    value *= expMultiplier;
   }
 
   // Check that we have at least some part of the number
   if (!hasIntegerPart && !hasDecimalPart) {
     reportError(LexError::InvalidNumber,
                 "Invalid floating-point literal: no digits");
-    return Token(TokenKind::Error, makeLocation(start));
+    return makeToken(TokenKind::Error, start);
   }
 
   // Parse float type suffix
@@ -692,14 +1167,14 @@ Token Lexer::lexFloat(const Position &start, int base, __uint128_t integerPart,
     }
   }
 
-  return Token(TokenKind::FloatLiteral, makeLocation(start), value, type);
+  return makeToken(TokenKind::FloatLiteral, start,
+                   literals.add(Token::Value(value, type)));
 }
 
 // Basic string lexing (Phase 4) - supports multiline and interpolation
 // detection (Phase 6)
-Token Lexer::lexString() {
-  const auto &buffer = currentBuffer();
-  Position start(buffer.line, buffer.column, buffer.byteOffset);
+CompactToken Lexer::lexString() {
+  Position start = currentPosition();
 
   advance(); // consume opening quote
 
@@ -707,63 +1182,42 @@ Token Lexer::lexString() {
   if (hasInterpolation()) {
     // Start interpolated string parsing
     pushInterpolationContext();
-    Token result = lexInterpolatedString();
+    CompactToken result = lexInterpolatedString();
     return result;
   } else {
     // Parse as regular string
-    Token result = lexRegularString(start);
+    CompactToken result = lexRegularString(start);
     return result;
   }
 }
 
-Token Lexer::lexRegularString(const Position &start) {
+CompactToken Lexer::lexRegularString(const Position &start) {
   // Scan string content and detect escapes
-  const char *contentStart = &currentBuffer().content[currentBuffer().position];
-  size_t sourceLength = 0;
-  bool hasEscapes = false;
-  size_t estimatedLength = 0;
-
-  // Scan to find end and detect escapes
-  while (!isAtBufferEnd() && currentChar() != '"') {
-    if (currentChar() == '\\') {
-      hasEscapes = true;
-      advance(); // skip backslash
-      if (!isAtBufferEnd()) {
-        advance();            // skip escaped char
-        estimatedLength += 1; // most escapes become 1 char
-      }
-      sourceLength += 2; // backslash + escaped char
-    } else {
-      advance();
-      estimatedLength += 1;
-      sourceLength += 1;
-    }
-  }
+  InterpolatedScanResult result = scanStringContent(false);
 
   if (isAtBufferEnd()) {
     reportError(LexError::UnterminatedString, "Unterminated string literal");
-    return Token(TokenKind::Error, makeLocation(start));
+    return makeToken(TokenKind::Error, start);
   }
 
   advance(); // consume closing quote
 
   // Create processed string token using Option 1
-  return createProcessedStringToken(contentStart, sourceLength, hasEscapes,
-                                    estimatedLength, start,
-                                    TokenKind::StringLiteral);
+  return createProcessedStringToken(result.contentStart, result.sourceLength,
+                                    result.hasEscapes, result.estimatedLength,
+                                    start, TokenKind::StringLiteral);
 }
 
 // Basic character lexing (Phase 4)
-Token Lexer::lexCharacter() {
-  const auto &buffer = currentBuffer();
-  Position start(buffer.line, buffer.column, buffer.byteOffset);
+CompactToken Lexer::lexCharacter() {
+  Position start = currentPosition();
 
   advance(); // consume opening quote
 
   if (isAtBufferEnd()) {
     reportError(LexError::UnterminatedString,
                 "Unterminated character literal: EOF reached");
-    return Token(TokenKind::Error, makeLocation(start));
+    return makeToken(TokenKind::Error, start);
   }
 
   uint32_t codepoint = 0;
@@ -772,7 +1226,7 @@ Token Lexer::lexCharacter() {
   if (c == '\n') {
     reportError(LexError::UnterminatedString,
                 "Unterminated character literal: newline in character");
-    return Token(TokenKind::Error, makeLocation(start));
+    return makeToken(TokenKind::Error, start);
   }
 
   if (c == '\\') {
@@ -781,19 +1235,19 @@ Token Lexer::lexCharacter() {
     if (isAtBufferEnd()) {
       reportError(LexError::UnterminatedString,
                   "Unterminated character literal: escape at end");
-      return Token(TokenKind::Error, makeLocation(start));
+      return makeToken(TokenKind::Error, start);
     }
 
     // Track error count before parsing escape sequence
-    size_t errorCountBefore = logger.getErrorCount();
+    size_t errorCountBefore = errorCount();
     codepoint = parseEscapeSequenceForChar();
     // If errors were reported during escape parsing, return error token
-    if (logger.getErrorCount() > errorCountBefore) {
+    if (errorCount() > errorCountBefore) {
       // Still need to consume the closing quote if present
       if (!isAtBufferEnd() && currentChar() == '\'') {
         advance();
       }
-      return Token(TokenKind::Error, makeLocation(start));
+      return makeToken(TokenKind::Error, start);
     }
   } else {
     // Regular character or UTF-8 sequence
@@ -801,57 +1255,69 @@ Token Lexer::lexCharacter() {
     if (codepoint == 0xFFFD) { // Replacement character indicates error
       reportError(LexError::InvalidUtf8,
                   "Invalid UTF-8 sequence in character literal");
-      return Token(TokenKind::Error, makeLocation(start));
+      return makeToken(TokenKind::Error, start);
     }
   }
 
   if (isAtBufferEnd() || currentChar() != '\'') {
     reportError(LexError::UnterminatedString,
                 "Unterminated character literal: missing closing quote");
-    return Token(TokenKind::Error, makeLocation(start));
+    return makeToken(TokenKind::Error, start);
   }
 
   advance(); // consume closing quote
 
-  return Token(TokenKind::CharLiteral, makeLocation(start), codepoint);
+  return makeToken(TokenKind::CharLiteral, start, codepoint);
 }
 
 // Raw string lexing (Phase 4) - no escape processing, multiline allowed
-Token Lexer::lexRawString() {
-  const auto &buffer = currentBuffer();
-  Position start(buffer.line, buffer.column, buffer.byteOffset);
+CompactToken Lexer::lexRawString() {
+  Position start = currentPosition();
 
   advance(); // consume 'r'
   advance(); // consume opening quote
 
-  const char *contentStart = &currentBuffer().content[currentBuffer().position];
-  size_t contentLength = 0;
-
-  while (!isAtBufferEnd() && currentChar() != '"') {
-    char c = currentChar();
-
-    // In raw strings, no escape processing - everything is literal
-    // Including newlines, backslashes, etc.
-    if (!isValidUTF8Start(c)) {
+  // In raw strings, no escape processing - everything up to the next quote
+  // is literal, including newlines and backslashes
+  auto &buffer = currentBuffer();
+  const char *contentStart = buffer.content.data() + buffer.position;
+  const scan::Skip body = scan::skipUntil(
+      contentStart, buffer.content.size() - buffer.position, '"', '"');
+  const size_t contentLength = body.length;
+  const size_t contentEnd = buffer.position + contentLength;
+  if (contentEnd <= buffer.validUtf8) {
+    skipScanned(body);
+  }
+
+  // Only a body that runs past the validated prefix needs a closer look,
+  // reporting each ill-formed sequence where it starts
+  while (buffer.position < contentEnd) {
+    size_t validEnd =
+        std::max(buffer.position, std::min(buffer.validUtf8, contentEnd));
+    validEnd += scan::validUtf8Prefix(buffer.content.data() + validEnd,
+                                      contentEnd - validEnd);
+    // No quote before contentEnd, so this skips the whole well-formed run
+    skipScanned(scan::skipUntil(buffer.content.data() + buffer.position,
+                                validEnd - buffer.position, '"', '"'));
+    if (buffer.position < contentEnd) {
       reportError(LexError::InvalidUtf8,
                   "Invalid UTF-8 sequence in raw string");
+      advance();
     }
-    advance();
-    contentLength++;
   }
 
   if (isAtBufferEnd()) {
     reportError(LexError::UnterminatedString,
                 "Unterminated raw string literal: EOF reached");
-    return Token(TokenKind::Error, makeLocation(start));
+    return makeToken(TokenKind::Error, start);
   }
 
   advance(); // consume closing quote
 
   // Raw strings: no escapes, just intern directly
   std::string_view rawContent(contentStart, contentLength);
-  InternedString internedContent = interner.intern(rawContent);
-  return Token(TokenKind::StringLiteral, makeLocation(start), internedContent);
+  const SymbolId symbol = interner.internSymbol(rawContent);
+  return makeToken(TokenKind::StringLiteral, start, symbol.index());
 }
 
 // Phase 5: Comment handling
@@ -859,9 +1325,7 @@ void Lexer::skipLineComment() {
   advance(); // consume second '/'
 
   // Skip until end of line or end of file
-  while (!isAtBufferEnd() && currentChar() != '\n') {
-    advance();
-  }
+  skipUntilAny('\n', '\n', '\n');
   // Note: Don't advance past '\n' - let normal tokenization handle it
 }
 
@@ -871,6 +1335,12 @@ void Lexer::skipBlockComment() {
   size_t depth = 1; // Track nesting depth
 
   while (!isAtBufferEnd() && depth > 0) {
+    // Jump to the next byte that can open or close a comment
+    skipUntilAny('*', '/', '/');
+    if (isAtBufferEnd()) {
+      break;
+    }
+
     char c = currentChar();
 
     if (c == '/' && peekChar(1) == '*') {
@@ -895,7 +1365,7 @@ void Lexer::skipBlockComment() {
   }
 }
 
-Token Lexer::lexSymbol() {
+CompactToken Lexer::lexSymbol() {
   // Additional symbol handling if needed
   reportError(LexError::InvalidCharacter, "Unknown symbol");
   return createErrorToken();
@@ -909,6 +1379,53 @@ bool Lexer::isAtBufferEnd() const {
   return buffer.position >= buffer.content.size();
 }
 
+Position Lexer::currentPosition() const {
+  const auto &buffer = currentBuffer();
+  if (positionMode == PositionMode::OffsetsOnly) {
+    return Position::fromOffset(buffer.byteOffset);
+  }
+  return Position(buffer.line, buffer.column, buffer.byteOffset);
+}
+
+Position Lexer::resolvePosition(const SourceFile &file, size_t offset) const {
+  auto &lineStarts = file.lineStarts;
+  if (lineStarts.empty()) {
+    lineStarts.push_back(0);
+    const char *data = file.content.data();
+    for (size_t i = 0; i < file.content.size(); ++i) {
+      if (data[i] == '\n') {
+        lineStarts.push_back(static_cast<uint32_t>(i + 1));
+      }
+    }
+  }
+
+  // Last line starting at or before the offset
+  const auto line =
+      std::upper_bound(lineStarts.begin(), lineStarts.end(), offset) - 1;
+  return Position(static_cast<size_t>(line - lineStarts.begin()) + 1,
+                  offset - *line + 1, offset);
+}
+
+CompactToken Lexer::makeToken(TokenKind kind, const Position &start) {
+  const auto &buffer = currentBuffer();
+  tokenStart = start;
+
+  CompactToken token;
+  token.kind = kind;
+  token.file = buffer.file;
+  token.offset = static_cast<uint32_t>(start.byteOffset);
+  token.length = static_cast<uint32_t>(buffer.byteOffset - start.byteOffset);
+  return token;
+}
+
+CompactToken Lexer::makeToken(TokenKind kind, const Position &start,
+                              uint32_t valueIndex) {
+  CompactToken token = makeToken(kind, start);
+  token.flags |= CompactToken::HAS_VALUE;
+  token.valueIndex = valueIndex;
+  return token;
+}
+
 void Lexer::advancePosition() {
   // This is already handled in advance()
 }
@@ -920,11 +1437,19 @@ void Lexer::reportError(LexError error, const std::string &message) {
 
 void Lexer::reportError(LexError error, const Location &location,
                         const std::string &message) {
+  if (stream && stream->deferErrors) {
+    stream->deferred.emplace_back(location, message);
+    return;
+  }
   logger.error(location, "Lexical error: {}", message);
 }
 
-Token Lexer::createErrorToken() {
-  return Token(TokenKind::Error, getCurrentLocation());
+size_t Lexer::errorCount() const {
+  return logger.getErrorCount() + (stream ? stream->deferred.size() : 0);
+}
+
+CompactToken Lexer::createErrorToken() {
+  return makeToken(TokenKind::Error, currentPosition());
 }
 
 // Phase 2: Number parsing helper implementations
@@ -1198,7 +1723,24 @@ uint32_t Lexer::parseUTF8Codepoint() {
     return 0xFFFD;
   }
 
+  auto &buffer = currentBuffer();
   unsigned char first = static_cast<unsigned char>(currentChar());
+  if (buffer.position < buffer.validUtf8 && first >= 0xC0) {
+    // A lead byte in the validated prefix starts a complete, well-formed
+    // sequence, which cannot contain a newline
+    const auto *bytes =
+        reinterpret_cast<const unsigned char *>(buffer.content.data()) +
+        buffer.position;
+    const size_t length = first >= 0xF0 ? 4 : first >= 0xE0 ? 3 : 2;
+    uint32_t codepoint = first & (0x7F >> length);
+    for (size_t i = 1; i < length; ++i) {
+      codepoint = (codepoint << 6) | (bytes[i] & 0x3F);
+    }
+    buffer.position += length;
+    buffer.byteOffset += length;
+    buffer.column += length;
+    return codepoint;
+  }
   advance();
 
   // ASCII character
@@ -1251,13 +1793,6 @@ uint32_t Lexer::parseUTF8Codepoint() {
   return codepoint;
 }
 
-bool Lexer::isValidUTF8Start(char c) const {
-  unsigned char byte = static_cast<unsigned char>(c);
-  // Valid UTF-8 start bytes: 0xxxxxxx (ASCII) or 110xxxxx, 1110xxxx, 11110xxx
-  return (byte <= 0x7F) || ((byte & 0xE0) == 0xC0) || ((byte & 0xF0) == 0xE0) ||
-         ((byte & 0xF8) == 0xF0);
-}
-
 // Character classification helpers
 bool Lexer::isIdentifierStart(char c) {
   return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
@@ -1279,9 +1814,8 @@ bool Lexer::isWhitespace(char c) {
 }
 
 // Phase 6: String Interpolation Implementation
-Token Lexer::lexInterpolatedString() {
-  const auto &buffer = currentBuffer();
-  Position start(buffer.line, buffer.column, buffer.byteOffset);
+CompactToken Lexer::lexInterpolatedString() {
+  Position start = currentPosition();
 
   // Scan string content until '{' or '"'
   InterpolatedScanResult result = scanInterpolatedStringContent(start);
@@ -1296,7 +1830,7 @@ Token Lexer::lexInterpolatedString() {
     if (currentChar() == '}') {
       reportError(LexError::InvalidInterpolation,
                   "Empty interpolation '{}' is not allowed");
-      return Token(TokenKind::Error, makeLocation(start));
+      return makeToken(TokenKind::Error, start);
     }
 
     return createProcessedStringToken(result.contentStart, result.sourceLength,
@@ -1307,7 +1841,7 @@ Token Lexer::lexInterpolatedString() {
     if (isAtBufferEnd()) {
       reportError(LexError::UnterminatedString,
                   "Unterminated string literal: EOF reached");
-      return Token(TokenKind::Error, makeLocation(start));
+      return makeToken(TokenKind::Error, start);
     }
 
     advance(); // consume closing quote
@@ -1319,11 +1853,10 @@ Token Lexer::lexInterpolatedString() {
   }
 }
 
-Token Lexer::continueStringAfterExpression() {
+CompactToken Lexer::continueStringAfterExpression() {
   // We've just finished parsing an expression and need to continue the string
   // The lexer should be positioned right after the '}'
-  const auto &buffer = currentBuffer();
-  Position start(buffer.line, buffer.column, buffer.byteOffset);
+  Position start = currentPosition();
 
   // Scan string content until '{' or '"'
   InterpolatedScanResult result = scanInterpolatedStringContent(start);
@@ -1338,7 +1871,7 @@ Token Lexer::continueStringAfterExpression() {
     if (currentChar() == '}') {
       reportError(LexError::InvalidInterpolation,
                   "Empty interpolation '{}' is not allowed");
-      return Token(TokenKind::Error, makeLocation(start));
+      return makeToken(TokenKind::Error, start);
     }
 
     return createProcessedStringToken(result.contentStart, result.sourceLength,
@@ -1349,7 +1882,7 @@ Token Lexer::continueStringAfterExpression() {
     if (isAtBufferEnd()) {
       reportError(LexError::UnterminatedString,
                   "Unterminated string literal: EOF reached");
-      return Token(TokenKind::Error, makeLocation(start));
+      return makeToken(TokenKind::Error, start);
     }
 
     advance(); // consume closing quote
@@ -1362,53 +1895,38 @@ Token Lexer::continueStringAfterExpression() {
 }
 
 bool Lexer::hasInterpolation() {
-  // Scan ahead to detect if string contains unescaped '{'
+  // Scan ahead for an unescaped '{' without moving the cursor
   const auto &buffer = currentBuffer();
-  size_t savedPos = buffer.position;
-  size_t savedLine = buffer.line;
-  size_t savedCol = buffer.column;
-  size_t savedOffset = buffer.byteOffset;
-
-  bool foundInterpolation = false;
-
-  while (!isAtBufferEnd() && currentChar() != '"') {
-    char c = currentChar();
+  const char *data = buffer.content.data();
+  const size_t size = buffer.content.size();
+  size_t i = buffer.position;
+
+  while (i < size) {
+    i += scan::skipUntil(data + i, size - i, '"', '{', '\\').length;
+    if (i >= size || data[i] == '"') {
+      return false;
+    }
+    if (data[i] == '{') {
+      return true;
+    }
 
-    if (c == '\\') {
-      // Handle escape sequences properly
-      advance(); // consume backslash
-      if (!isAtBufferEnd()) {
-        char escapeChar = currentChar();
-        advance(); // consume escape character
-
-        // Handle Unicode escapes with braces: \u{...}
-        if (escapeChar == 'u' && !isAtBufferEnd() && currentChar() == '{') {
-          advance(); // consume '{'
-          // Skip until closing '}'
-          while (!isAtBufferEnd() && currentChar() != '}') {
-            advance();
-          }
-          if (!isAtBufferEnd() && currentChar() == '}') {
-            advance(); // consume '}'
-          }
+    // Handle escape sequences properly
+    ++i; // skip backslash
+    if (i < size) {
+      const char escapeChar = data[i++];
+      // Handle Unicode escapes with braces: \u{...}
+      if (escapeChar == 'u' && i < size && data[i] == '{') {
+        while (i < size && data[i] != '}') {
+          ++i;
+        }
+        if (i < size) {
+          ++i; // skip '}'
         }
       }
-    } else if (c == '{') {
-      foundInterpolation = true;
-      break;
-    } else {
-      advance();
     }
   }
 
-  // Restore position
-  auto &mutableBuffer = currentBuffer();
-  mutableBuffer.position = savedPos;
-  mutableBuffer.line = savedLine;
-  mutableBuffer.column = savedCol;
-  mutableBuffer.byteOffset = savedOffset;
-
-  return foundInterpolation;
+  return false;
 }
 
 void Lexer::pushInterpolationContext() {
@@ -1469,16 +1987,17 @@ const Lexer::LexerBuffer &Lexer::currentBuffer() const {
 }
 
 // String processing implementation using Option 1 (stack+heap strategy)
-Token Lexer::createProcessedStringToken(const char *contentStart,
-                                        size_t sourceLength, bool hasEscapes,
-                                        size_t estimatedLength,
-                                        const Position &start,
-                                        TokenKind tokenKind) {
+CompactToken Lexer::createProcessedStringToken(const char *contentStart,
+                                               size_t sourceLength,
+                                               bool hasEscapes,
+                                               size_t estimatedLength,
+                                               const Position &start,
+                                               TokenKind tokenKind) {
   if (!hasEscapes) {
     // No escapes: intern directly
     std::string_view content(contentStart, sourceLength);
-    InternedString internedContent = interner.intern(content);
-    return Token(tokenKind, makeLocation(start), internedContent);
+    const SymbolId symbol = interner.internSymbol(content);
+    return makeToken(tokenKind, start, symbol.index());
   }
 
   // Has escapes: use temporary buffer
@@ -1491,8 +2010,8 @@ Token Lexer::createProcessedStringToken(const char *contentStart,
         processEscapeSequences(contentStart, sourceLength, stackBuffer);
 
     std::string_view processedView(stackBuffer, actualLength);
-    InternedString internedContent = interner.intern(processedView);
-    return Token(tokenKind, makeLocation(start), internedContent);
+    const SymbolId symbol = interner.internSymbol(processedView);
+    return makeToken(tokenKind, start, symbol.index());
     // stackBuffer automatically freed when function exits
   } else {
     // Large strings: use heap allocation
@@ -1502,8 +2021,8 @@ Token Lexer::createProcessedStringToken(const char *contentStart,
         processEscapeSequences(contentStart, sourceLength, heapBuffer.get());
 
     std::string_view processedView(heapBuffer.get(), actualLength);
-    InternedString internedContent = interner.intern(processedView);
-    return Token(tokenKind, makeLocation(start), internedContent);
+    const SymbolId symbol = interner.internSymbol(processedView);
+    return makeToken(tokenKind, start, symbol.index());
     // heapBuffer automatically freed when unique_ptr goes out of scope
   }
 }
@@ -1519,36 +2038,37 @@ struct InterpolatedScanResult {
 
 Lexer::InterpolatedScanResult
 Lexer::scanInterpolatedStringContent(const Position &start) {
+  return scanStringContent(true);
+}
+
+Lexer::InterpolatedScanResult
+Lexer::scanStringContent(bool stopAtInterpolation) {
   const auto &buffer = currentBuffer();
   const char *contentStart = &buffer.content[buffer.position];
-  size_t sourceLength = 0;
-  bool hasEscapes = false;
-  size_t estimatedLength = 0;
-  bool foundInterpolation = false;
-
-  // Scan until we hit { or "
-  while (!isAtBufferEnd() && currentChar() != '"' && currentChar() != '{') {
-    if (currentChar() == '\\') {
-      hasEscapes = true;
-      advance(); // skip backslash
-      if (!isAtBufferEnd()) {
-        advance();            // skip escaped char
-        estimatedLength += 1; // most escapes become 1 char
-      }
-      sourceLength += 2; // backslash + escaped char
-    } else {
-      advance();
-      estimatedLength += 1;
-      sourceLength += 1;
+  const size_t contentOffset = buffer.position;
+  const char brace = stopAtInterpolation ? '{' : '\\';
+  size_t escapes = 0;
+
+  // Jump from one quote, backslash or brace to the next; the bytes in
+  // between are taken as they are
+  while (true) {
+    skipUntilAny('"', '\\', brace);
+    if (isAtBufferEnd() || currentChar() != '\\') {
+      break;
+    }
+    ++escapes;
+    advance(); // skip backslash
+    if (!isAtBufferEnd()) {
+      advance(); // skip escaped char
     }
   }
 
-  // Check what stopped us
-  if (!isAtBufferEnd() && currentChar() == '{') {
-    foundInterpolation = true;
-  }
+  const size_t sourceLength = currentBuffer().position - contentOffset;
+  const bool foundInterpolation =
+      stopAtInterpolation && !isAtBufferEnd() && currentChar() == '{';
 
-  return {contentStart, sourceLength, hasEscapes, estimatedLength,
+  // Most escapes become 1 char
+  return {contentStart, sourceLength, escapes > 0, sourceLength - escapes,
           foundInterpolation};
 }
 
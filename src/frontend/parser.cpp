@@ -7,14 +7,37 @@
 #include "cxy/ast/literals.hpp"
 #include "cxy/ast/statements.hpp"
 #include "cxy/ast/types.hpp"
+#include "cxy/memory/arena_stl.hpp"
 #include "cxy/types/primitive.hpp"
 
+#include <array>
 #include <cmath>
 #include <format>
 #include <functional>
 
 namespace cxy {
 
+namespace {
+
+bool isTemplateClose(TokenKind kind) {
+  return kind == TokenKind::Shr || kind == TokenKind::ShrEqual;
+}
+
+// Shortens a '>>' or '>>=' to its leading '>' and returns the '>' or '>='
+// that follows it
+CompactToken splitGreater(CompactToken &token) {
+  CompactToken rest = token;
+  rest.kind = token.kind == TokenKind::Shr ? TokenKind::Greater
+                                           : TokenKind::GreaterEqual;
+  rest.offset += 1;
+  rest.length -= 1;
+  token.kind = TokenKind::Greater;
+  token.length = 1;
+  return rest;
+}
+
+} // namespace
+
 Parser::Parser(Lexer &lexer, ArenaAllocator &arena,
                SourceManager &sourceManager, StringInterner &interner,
                DiagnosticLogger &diagnostics, TypeRegistry &typeRegistry)
@@ -22,35 +45,83 @@ Parser::Parser(Lexer &lexer, ArenaAllocator &arena,
       interner_(interner), diagnostics_(diagnostics), typeRegistry_(typeRegistry) {
   // Initialize token buffer to empty state
   for (int i = 0; i < 4; ++i) {
-    tokens_[i] = Token{};
+    tokens_[i] = CompactToken{};
   }
 }
 
 void Parser::initialize() {
   // Preload the lookahead buffer for LL(3) parsing
-  tokens_[0] =
-      Token(TokenKind::Error, Location{}); // No previous token initially
-  tokens_[1] = lexer_.nextToken();         // Current token
-  tokens_[2] = lexer_.nextToken();         // Lookahead 1
-  tokens_[3] = lexer_.nextToken();         // Lookahead 2
+  tokenBuffer_ = nullptr;
+  tokens_[0] = CompactToken{};            // No previous token initially
+  tokens_[1] = lexer_.nextCompactToken(); // Current token
+  tokens_[2] = lexer_.nextCompactToken(); // Lookahead 1
+  tokens_[3] = lexer_.nextCompactToken(); // Lookahead 2
+}
+
+void Parser::initialize(const TokenBuffer &tokens) {
+  tokenBuffer_ = &tokens;
+  nextIndex_ = 0;
+  tokens_[0] = CompactToken{}; // No previous token initially
+  tokens_[1] = nextToken();
+  tokens_[2] = nextToken();
+  tokens_[3] = nextToken();
 }
 
 void Parser::advance() {
   // Shift buffer: drop previous, advance current, read new lookahead
-  tokens_[0] = tokens_[1];         // previous = current
-  tokens_[1] = tokens_[2];         // current = lookahead1
-  tokens_[2] = tokens_[3];         // lookahead1 = lookahead2
-  tokens_[3] = lexer_.nextToken(); // lookahead2 = next from lexer
+  tokens_[0] = tokens_[1];  // previous = current
+  tokens_[1] = tokens_[2];  // current = lookahead1
+  tokens_[2] = tokens_[3];  // lookahead1 = lookahead2
+  tokens_[3] = nextToken(); // lookahead2 = next from lexer or stream
+
+  if (tokenBuffer_ && lexer_.inTemplateContext()) {
+    splitTemplateClose();
+  }
 }
 
-bool Parser::checkAny(const std::vector<TokenKind> &kinds) const {
-  TokenKind currentKind = current().kind;
-  for (TokenKind kind : kinds) {
-    if (currentKind == kind) {
-      return true;
+CompactToken Parser::nextToken() {
+  return tokenBuffer_ ? (*tokenBuffer_)[nextIndex_++]
+                      : lexer_.nextCompactToken();
+}
+
+CompactToken Parser::peekToken(int offset) const {
+  if (!tokenBuffer_ || !lexer_.inTemplateContext()) {
+    return offset <= 2
+               ? tokens_[1 + offset]
+               : (*tokenBuffer_)[nextIndex_ + static_cast<size_t>(offset - 3)];
+  }
+
+  // Inside generic arguments every '>>' ahead will reach the parser as two
+  // tokens, so count them the way advance() is going to deliver them
+  for (size_t index = 0;; ++index) {
+    CompactToken token = index < 2 ? tokens_[2 + index]
+                                   : (*tokenBuffer_)[nextIndex_ + index - 2];
+    if (isTemplateClose(token.kind)) {
+      const CompactToken rest = splitGreater(token);
+      if (--offset == 0) {
+        return token;
+      }
+      token = rest;
+    }
+    if (--offset == 0) {
+      return token;
     }
   }
-  return false;
+}
+
+void Parser::splitTemplateClose() {
+  // A pre-lexed stream was lexed outside any template context, so '>>' and
+  // '>>=' arrive whole. Split off the leading '>' the way the lexer does
+  // when it knows generic arguments are open.
+  CompactToken &token = tokens_[1];
+  if (!isTemplateClose(token.kind)) {
+    return;
+  }
+
+  // Make room for the remainder; the token pushed out is read again
+  tokens_[3] = tokens_[2];
+  tokens_[2] = splitGreater(token);
+  --nextIndex_;
 }
 
 bool Parser::match(TokenKind kind) {
@@ -71,7 +142,7 @@ bool Parser::expect(TokenKind kind, const std::string &errorMessage) {
   std::string msg =
       errorMessage.empty()
           ? std::format("Expected '{}', got '{}'", tokenKindToString(kind),
-                        tokenKindToString(current().kind))
+                        tokenKindToString(currentKind()))
           : errorMessage;
 
   ParseError error(ParseErrorType::MissingToken, current().location, msg,
@@ -92,7 +163,7 @@ ParseError Parser::createUnexpectedTokenError(TokenKind expected,
   std::string msg =
       message.empty()
           ? std::format("Expected '{}', got '{}'", tokenKindToString(expected),
-                        tokenKindToString(current().kind))
+                        tokenKindToString(currentKind()))
           : message;
   return ParseError(ParseErrorType::UnexpectedToken, current().location, msg,
                     {expected}, current());
@@ -160,17 +231,19 @@ std::string Parser::getSpecialOverloadOperatorName(TokenKind firstToken, TokenKi
 }
 
 ParseError
-Parser::createUnexpectedTokenError(const std::vector<TokenKind> &expected,
+Parser::createUnexpectedTokenError(const TokenSet &expected,
                                    const std::string &message) {
   std::string msg = message;
   if (msg.empty()) {
     msg = "Expected one of: ";
-    for (size_t i = 0; i < expected.size(); ++i) {
-      if (i > 0)
+    bool first = true;
+    for (TokenKind kind : expected) {
+      if (!first)
         msg += ", ";
-      msg += std::format("'{}'", tokenKindToString(expected[i]));
+      first = false;
+      msg += std::format("'{}'", tokenKindToString(kind));
     }
-    msg += std::format(", got '{}'", tokenKindToString(current().kind));
+    msg += std::format(", got '{}'", tokenKindToString(currentKind()));
   }
   return ParseError(ParseErrorType::UnexpectedToken, current().location, msg,
                     expected, current());
@@ -178,442 +251,268 @@ Parser::createUnexpectedTokenError(const std::vector<TokenKind> &expected,
 
 // Phase 2: Expression parsing with operator precedence
 
-ast::ASTNode *Parser::parseExpression(bool withoutStructLiterals) {
-  // Start at the top of the precedence hierarchy
-  // Now includes assignment expressions
-  return parseAssignmentExpression(withoutStructLiterals);
+namespace {
+
+using Precedence = Parser::Precedence;
+
+// Level of each token as an infix or postfix operator; Precedence::None for
+// tokens that end an expression
+constexpr auto BINDING_POWER = [] {
+  std::array<Precedence, size_t(TokenKind::LastSpecial) + 1> power{};
+  for (size_t kind = 0; kind < power.size(); ++kind) {
+    if (isAssignmentOperator(TokenKind(kind))) {
+      power[kind] = Precedence::Assignment;
+    }
+  }
+  power[size_t(TokenKind::Question)] = Precedence::Conditional;
+  power[size_t(TokenKind::LOr)] = Precedence::LogicalOr;
+  power[size_t(TokenKind::LAnd)] = Precedence::LogicalAnd;
+  power[size_t(TokenKind::BOr)] = Precedence::BitwiseOr;
+  power[size_t(TokenKind::BXor)] = Precedence::BitwiseXor;
+  power[size_t(TokenKind::BAnd)] = Precedence::BitwiseAnd;
+  power[size_t(TokenKind::Equal)] = Precedence::Equality;
+  power[size_t(TokenKind::NotEqual)] = Precedence::Equality;
+  power[size_t(TokenKind::Less)] = Precedence::Relational;
+  power[size_t(TokenKind::LessEqual)] = Precedence::Relational;
+  power[size_t(TokenKind::Greater)] = Precedence::Relational;
+  power[size_t(TokenKind::GreaterEqual)] = Precedence::Relational;
+  power[size_t(TokenKind::DotDot)] = Precedence::Range;
+  power[size_t(TokenKind::DotDotLess)] = Precedence::Range;
+  power[size_t(TokenKind::Shl)] = Precedence::Shift;
+  power[size_t(TokenKind::Shr)] = Precedence::Shift;
+  power[size_t(TokenKind::Plus)] = Precedence::Additive;
+  power[size_t(TokenKind::Minus)] = Precedence::Additive;
+  power[size_t(TokenKind::Mult)] = Precedence::Multiplicative;
+  power[size_t(TokenKind::Div)] = Precedence::Multiplicative;
+  power[size_t(TokenKind::Mod)] = Precedence::Multiplicative;
+  power[size_t(TokenKind::As)] = Precedence::Cast;
+  power[size_t(TokenKind::BangColon)] = Precedence::Cast;
+  return power;
+}();
+
+// Levels whose operator takes a left operand of its own level. Assignment
+// and ?: nest to the right instead, and ranges do not nest.
+constexpr bool isLeftAssociative(Precedence level) {
+  return level != Precedence::Assignment &&
+         level != Precedence::Conditional && level != Precedence::Range;
 }
 
-ast::ASTNode *Parser::parseAssignmentExpression(bool withoutStructLiterals) {
-  // assignment_expression ::=
-  //   | conditional_expression
-  //   | conditional_expression assignment_operator assignment_expression
+constexpr Precedence tighter(Precedence level) {
+  return Precedence(uint8_t(level) + 1);
+}
 
-  ast::ASTNode *left = parseConditionalExpression(withoutStructLiterals);
-  if (!left) {
-    return nullptr;
-  }
+constexpr TokenSet PREFIX_OPERATORS = {
+    TokenKind::PlusPlus, TokenKind::MinusMinus, TokenKind::Plus,
+    TokenKind::Minus,    TokenKind::LNot,       TokenKind::BNot,
+    TokenKind::BAnd,     TokenKind::LAnd,       TokenKind::BXor};
 
-  // Check for assignment operators (right-associative)
-  if (isAssignmentOperator(current().kind)) {
-    Token opToken = current();
-    advance(); // consume operator
+constexpr TokenSet POSTFIX_OPERATORS = {
+    TokenKind::PlusPlus, TokenKind::MinusMinus, TokenKind::LParen,
+    TokenKind::LBracket, TokenKind::Dot,        TokenKind::BAndDot};
 
-    // Parse the right-hand side (right-associative)
-    ast::ASTNode *right = parseAssignmentExpression(withoutStructLiterals);
-    if (!right) {
-      return nullptr; // Error already reported
-    }
+// Tokens after `..` that leave the range without an end
+constexpr TokenSet OPEN_RANGE_ENDS = {
+    TokenKind::EoF,    TokenKind::RBracket, TokenKind::Comma,
+    TokenKind::RParen, TokenKind::RBrace,   TokenKind::Semicolon};
 
-    // Create assignment expression node
-    return ast::createAssignmentExpr(left, opToken.kind, right,
-                                     opToken.location, arena_);
-  }
+constexpr TokenSet PRIMARY_STARTS = {
+    TokenKind::IntLiteral,    TokenKind::FloatLiteral, TokenKind::CharLiteral,
+    TokenKind::StringLiteral, TokenKind::LString,      TokenKind::True,
+    TokenKind::False,         TokenKind::Null,         TokenKind::Ident,
+    TokenKind::LParen,        TokenKind::LBracket,     TokenKind::LBrace,
+    TokenKind::Elipsis,       TokenKind::ColonColon};
 
-  return left;
-}
+} // namespace
 
-ast::ASTNode *Parser::parseConditionalExpression(bool withoutStructLiterals) {
-  // conditional_expression ::=
-  //   | logical_or_expression
-  //   | logical_or_expression '?' expression ':' conditional_expression
-
-  ast::ASTNode *condition = parseLogicalOrExpression(withoutStructLiterals);
-  if (!condition) {
-    return nullptr;
-  }
+ast::ASTNode *Parser::parseExpression(bool withoutStructLiterals) {
+  // Start at the top of the precedence hierarchy
+  // Now includes assignment expressions
+  return parseBinaryExpression(Precedence::Assignment, withoutStructLiterals);
+}
 
-  // Check for ternary operator
-  if (check(TokenKind::Question)) {
-    Token questionToken = current();
-    advance(); // consume '?'
+ast::ASTNode *Parser::parseBinaryExpression(Precedence minimum,
+                                            bool withoutStructLiterals) {
+  // expression ::= operand (operator operand)*, where each operator binds
+  // its operands as in the grammar of its parse*Expression entry point.
+  // `level` is the level of the operator that built `left`; an operator may
+  // only take `left` as its left operand if that is looser than `level`
+  // (or equal, for left-associative levels), exactly as the grammar allows.
+  ast::ASTNode *left = nullptr;
+  Precedence level = Precedence::Unary;
+
+  if (minimum <= Precedence::Range && check(TokenKind::DotDot)) {
+    // Open start range: ..expr or just ..
+    Token opToken = current();
+    advance(); // consume '..'
 
-    // Parse the 'then' expression
-    ast::ASTNode *thenExpr = parseExpression(withoutStructLiterals);
-    if (!thenExpr) {
-      return nullptr; // Error already reported
+    ast::ASTNode *end = nullptr;
+    if (!isOpenRangeEnd()) {
+      end = parseBinaryExpression(Precedence::Shift, withoutStructLiterals);
+      if (!end) {
+        return nullptr;
+      }
     }
+    left = ast::createRangeExpr(nullptr, end, true, opToken.location, arena_);
+    level = Precedence::Range;
+  } else if (minimum <= Precedence::Range && check(TokenKind::DotDotLess)) {
+    // Open start exclusive range: ..<expr
+    Token opToken = current();
+    advance(); // consume '..<'
 
-    // Expect ':'
-    if (!expect(TokenKind::Colon,
-                "Expected ':' after then expression in ternary operator")) {
+    ast::ASTNode *end =
+        parseBinaryExpression(Precedence::Shift, withoutStructLiterals);
+    if (!end) {
       return nullptr;
     }
-
-    // Parse the 'else' expression (right-associative)
-    ast::ASTNode *elseExpr = parseConditionalExpression(withoutStructLiterals);
-    if (!elseExpr) {
-      return nullptr; // Error already reported
+    left = ast::createRangeExpr(nullptr, end, false, opToken.location, arena_);
+    level = Precedence::Range;
+  } else {
+    left = parseUnaryExpression(withoutStructLiterals);
+    if (!left) {
+      return nullptr;
     }
-
-    // Create ternary expression node
-    return ast::createTernaryExpr(condition, thenExpr, elseExpr,
-                                  questionToken.location, arena_);
   }
 
-  return condition;
-}
-
-ast::ASTNode *Parser::parseLogicalOrExpression(bool withoutStructLiterals) {
-  // logical_or_expression ::=
-  //   | logical_and_expression
-  //   | logical_or_expression '||' logical_and_expression
-
-  ast::ASTNode *left = parseLogicalAndExpression(withoutStructLiterals);
-  if (!left) {
-    return nullptr;
-  }
+  while (true) {
+    const Precedence power = BINDING_POWER[size_t(currentKind())];
+    if (power == Precedence::None || power < minimum || power > level ||
+        (power == level && !isLeftAssociative(power))) {
+      return left;
+    }
 
-  while (check(TokenKind::LOr)) {
     Token opToken = current();
     advance(); // consume operator
 
-    ast::ASTNode *right = parseLogicalAndExpression(withoutStructLiterals);
-    if (!right) {
-      return nullptr; // Error already reported
+    switch (power) {
+    case Precedence::Assignment: {
+      // Right-associative
+      ast::ASTNode *right =
+          parseBinaryExpression(Precedence::Assignment, withoutStructLiterals);
+      if (!right) {
+        return nullptr; // Error already reported
+      }
+      left = ast::createAssignmentExpr(left, opToken.kind, right,
+                                       opToken.location, arena_);
+      break;
     }
 
-    // Create binary expression node
-    left = ast::createBinaryExpr(left, opToken.kind, right, opToken.location,
-                                 arena_);
-  }
-
-  return left;
-}
+    case Precedence::Conditional: {
+      ast::ASTNode *thenExpr = parseExpression(withoutStructLiterals);
+      if (!thenExpr) {
+        return nullptr; // Error already reported
+      }
 
-ast::ASTNode *Parser::parseLogicalAndExpression(bool withoutStructLiterals) {
-  // logical_and_expression ::=
-  //   | bitwise_or_expression
-  //   | logical_and_expression '&&' bitwise_or_expression
+      if (!expect(TokenKind::Colon,
+                  "Expected ':' after then expression in ternary operator")) {
+        return nullptr;
+      }
 
-  ast::ASTNode *left = parseBitwiseOrExpression(withoutStructLiterals);
-  if (!left) {
-    return nullptr;
-  }
+      // Right-associative
+      ast::ASTNode *elseExpr =
+          parseBinaryExpression(Precedence::Conditional, withoutStructLiterals);
+      if (!elseExpr) {
+        return nullptr; // Error already reported
+      }
+      left = ast::createTernaryExpr(left, thenExpr, elseExpr, opToken.location,
+                                    arena_);
+      break;
+    }
 
-  while (check(TokenKind::LAnd)) {
-    Token opToken = current();
-    advance(); // consume operator
+    case Precedence::Range: {
+      // expr..expr and expr..<expr; an inclusive range may leave its end
+      // open
+      const bool inclusive = opToken.kind == TokenKind::DotDot;
+      ast::ASTNode *right = nullptr;
+      if (!inclusive || !isOpenRangeEnd()) {
+        right = parseBinaryExpression(Precedence::Shift, withoutStructLiterals);
+        if (!right) {
+          return nullptr;
+        }
+      }
+      left =
+          ast::createRangeExpr(left, right, inclusive, opToken.location, arena_);
+      break;
+    }
 
-    ast::ASTNode *right = parseBitwiseOrExpression(withoutStructLiterals);
-    if (!right) {
-      return nullptr; // Error already reported
+    case Precedence::Cast: {
+      ast::ASTNode *typeExpr = parseTypeExpression();
+      if (!typeExpr) {
+        return nullptr;
+      }
+      left = ast::createCastExpr(left, typeExpr,
+                                 opToken.kind == TokenKind::BangColon,
+                                 opToken.location, arena_);
+      break;
     }
 
-    // Create binary expression node
-    left = ast::createBinaryExpr(left, opToken.kind, right, opToken.location,
-                                 arena_);
+    default: {
+      ast::ASTNode *right =
+          parseBinaryExpression(tighter(power), withoutStructLiterals);
+      if (!right) {
+        return nullptr; // Error already reported
+      }
+      left = ast::createBinaryExpr(left, opToken.kind, right, opToken.location,
+                                   arena_);
+      break;
+    }
+    }
+    level = power;
   }
-
-  return left;
 }
 
-ast::ASTNode *Parser::parseBitwiseOrExpression(bool withoutStructLiterals) {
-  // bitwise_or_expression ::=
-  //   | bitwise_xor_expression
-  //   | bitwise_or_expression '|' bitwise_xor_expression
+bool Parser::isOpenRangeEnd() const { return checkAny(OPEN_RANGE_ENDS); }
 
-  ast::ASTNode *left = parseBitwiseXorExpression(withoutStructLiterals);
-  if (!left) {
-    return nullptr;
-  }
+ast::ASTNode *Parser::parseAssignmentExpression(bool withoutStructLiterals) {
+  return parseBinaryExpression(Precedence::Assignment, withoutStructLiterals);
+}
 
-  while (check(TokenKind::BOr)) {
-    Token opToken = current();
-    advance(); // consume operator
+ast::ASTNode *Parser::parseConditionalExpression(bool withoutStructLiterals) {
+  return parseBinaryExpression(Precedence::Conditional, withoutStructLiterals);
+}
 
-    ast::ASTNode *right = parseBitwiseXorExpression(withoutStructLiterals);
-    if (!right) {
-      return nullptr; // Error already reported
-    }
+ast::ASTNode *Parser::parseLogicalOrExpression(bool withoutStructLiterals) {
+  return parseBinaryExpression(Precedence::LogicalOr, withoutStructLiterals);
+}
 
-    // Create binary expression node
-    left = ast::createBinaryExpr(left, opToken.kind, right, opToken.location,
-                                 arena_);
-  }
+ast::ASTNode *Parser::parseLogicalAndExpression(bool withoutStructLiterals) {
+  return parseBinaryExpression(Precedence::LogicalAnd, withoutStructLiterals);
+}
 
-  return left;
+ast::ASTNode *Parser::parseBitwiseOrExpression(bool withoutStructLiterals) {
+  return parseBinaryExpression(Precedence::BitwiseOr, withoutStructLiterals);
 }
 
 ast::ASTNode *Parser::parseBitwiseXorExpression(bool withoutStructLiterals) {
-  // bitwise_xor_expression ::=
-  //   | bitwise_and_expression
-  //   | bitwise_xor_expression '^' bitwise_and_expression
-
-  ast::ASTNode *left = parseBitwiseAndExpression(withoutStructLiterals);
-  if (!left) {
-    return nullptr;
-  }
-
-  while (check(TokenKind::BXor)) {
-    Token opToken = current();
-    advance(); // consume operator
-
-    ast::ASTNode *right = parseBitwiseAndExpression(withoutStructLiterals);
-    if (!right) {
-      return nullptr; // Error already reported
-    }
-
-    // Create binary expression node
-    left = ast::createBinaryExpr(left, opToken.kind, right, opToken.location,
-                                 arena_);
-  }
-
-  return left;
+  return parseBinaryExpression(Precedence::BitwiseXor, withoutStructLiterals);
 }
 
 ast::ASTNode *Parser::parseBitwiseAndExpression(bool withoutStructLiterals) {
-  // bitwise_and_expression ::=
-  //   | equality_expression
-  //   | bitwise_and_expression '&' equality_expression
-
-  ast::ASTNode *left = parseEqualityExpression(withoutStructLiterals);
-  if (!left) {
-    return nullptr;
-  }
-
-  while (check(TokenKind::BAnd)) {
-    Token opToken = current();
-    advance(); // consume operator
-
-    ast::ASTNode *right = parseEqualityExpression(withoutStructLiterals);
-    if (!right) {
-      return nullptr; // Error already reported
-    }
-
-    // Create binary expression node
-    left = ast::createBinaryExpr(left, opToken.kind, right, opToken.location,
-                                 arena_);
-  }
-
-  return left;
+  return parseBinaryExpression(Precedence::BitwiseAnd, withoutStructLiterals);
 }
 
 ast::ASTNode *Parser::parseEqualityExpression(bool withoutStructLiterals) {
-  // equality_expression ::=
-  //   | relational_expression
-  //   | equality_expression '==' relational_expression
-  //   | equality_expression '!=' relational_expression
-
-  ast::ASTNode *left = parseRelationalExpression(withoutStructLiterals);
-  if (!left) {
-    return nullptr;
-  }
-
-  while (check(TokenKind::Equal) || check(TokenKind::NotEqual)) {
-    Token opToken = current();
-    advance(); // consume operator
-
-    ast::ASTNode *right = parseRelationalExpression(withoutStructLiterals);
-    if (!right) {
-      return nullptr; // Error already reported
-    }
-
-    // Create binary expression node
-    left = ast::createBinaryExpr(left, opToken.kind, right, opToken.location,
-                                 arena_);
-  }
-
-  return left;
+  return parseBinaryExpression(Precedence::Equality, withoutStructLiterals);
 }
 
 ast::ASTNode *Parser::parseRelationalExpression(bool withoutStructLiterals) {
-  // relational_expression ::=
-  //   | range_expression
-  //   | relational_expression '<' range_expression
-  //   | relational_expression '<=' range_expression
-  //   | relational_expression '>' range_expression
-  //   | relational_expression '>=' range_expression
-
-  ast::ASTNode *left = parseRangeExpression(withoutStructLiterals);
-  if (!left) {
-    return nullptr;
-  }
-
-  while (check(TokenKind::Less) || check(TokenKind::LessEqual) ||
-         check(TokenKind::Greater) || check(TokenKind::GreaterEqual)) {
-    Token opToken = current();
-    advance(); // consume operator
-
-    ast::ASTNode *right = parseRangeExpression(withoutStructLiterals);
-    if (!right) {
-      return nullptr;
-    }
-
-    left = ast::createBinaryExpr(left, opToken.kind, right, opToken.location,
-                                 arena_);
-  }
-
-  return left;
+  return parseBinaryExpression(Precedence::Relational, withoutStructLiterals);
 }
 
 ast::ASTNode *Parser::parseRangeExpression(bool withoutStructLiterals) {
-  // range_expression ::=
-  //   | shift_expression
-  //   | range_expression '..' shift_expression
-  //   | range_expression '..<' shift_expression
-  //   | '..' shift_expression
-  //   | shift_expression '..'
-  //   | '..'
-
-  // Handle open start ranges (..expr, ..<expr, ..)
-  if (check(TokenKind::DotDot)) {
-    Token opToken = current();
-    advance(); // consume '..'
-
-    // Check if there's a right side expression
-    if (!isAtEnd() && !check(TokenKind::RBracket) && !check(TokenKind::Comma) &&
-        !check(TokenKind::RParen) && !check(TokenKind::RBrace) &&
-        !check(TokenKind::Semicolon)) {
-      // ..expr (open start inclusive range)
-      ast::ASTNode *end = parseShiftExpression(withoutStructLiterals);
-      if (!end) {
-        return nullptr;
-      }
-      return ast::createRangeExpr(nullptr, end, true, opToken.location, arena_);
-    } else {
-      // Just .. (full open range)
-      return ast::createRangeExpr(nullptr, nullptr, true, opToken.location,
-                                  arena_);
-    }
-  }
-
-  if (check(TokenKind::DotDotLess)) {
-    Token opToken = current();
-    advance(); // consume '..<'
-
-    ast::ASTNode *end = parseShiftExpression(withoutStructLiterals);
-    if (!end) {
-      return nullptr;
-    }
-    return ast::createRangeExpr(nullptr, end, false, opToken.location, arena_);
-  }
-
-  // First, parse left side expression
-  ast::ASTNode *left = parseShiftExpression(withoutStructLiterals);
-  if (!left) {
-    return nullptr;
-  }
-
-  // Check for range operators after parsing left side
-  if (check(TokenKind::DotDot)) {
-    Token opToken = current();
-    advance(); // consume '..'
-
-    // Check if there's a right side expression
-    if (!isAtEnd() && !check(TokenKind::RBracket) && !check(TokenKind::Comma) &&
-        !check(TokenKind::RParen) && !check(TokenKind::RBrace) &&
-        !check(TokenKind::Semicolon)) {
-      // expr..expr (inclusive range)
-      ast::ASTNode *right = parseShiftExpression(withoutStructLiterals);
-      if (!right) {
-        return nullptr;
-      }
-      return ast::createRangeExpr(left, right, true, opToken.location, arena_);
-    } else {
-      // expr.. (open end range)
-      return ast::createRangeExpr(left, nullptr, true, opToken.location,
-                                  arena_);
-    }
-  }
-
-  if (check(TokenKind::DotDotLess)) {
-    Token opToken = current();
-    advance(); // consume '..<'
-
-    // Must have a right side for exclusive ranges
-    ast::ASTNode *right = parseShiftExpression(withoutStructLiterals);
-    if (!right) {
-      return nullptr;
-    }
-    return ast::createRangeExpr(left, right, false, opToken.location, arena_);
-  }
-
-  // No range operator found, just return the left side
-  return left;
+  return parseBinaryExpression(Precedence::Range, withoutStructLiterals);
 }
 
 ast::ASTNode *Parser::parseShiftExpression(bool withoutStructLiterals) {
-  // shift_expression ::=
-  //   | additive_expression
-  //   | shift_expression '<<' additive_expression
-  //   | shift_expression '>>' additive_expression
-
-  ast::ASTNode *left = parseAdditiveExpression(withoutStructLiterals);
-  if (!left) {
-    return nullptr;
-  }
-
-  while (check(TokenKind::Shl) || check(TokenKind::Shr)) {
-    Token opToken = current();
-    advance(); // consume operator
-
-    ast::ASTNode *right = parseAdditiveExpression(withoutStructLiterals);
-    if (!right) {
-      return nullptr;
-    }
-
-    left = ast::createBinaryExpr(left, opToken.kind, right, opToken.location,
-                                 arena_);
-  }
-
-  return left;
+  return parseBinaryExpression(Precedence::Shift, withoutStructLiterals);
 }
 
 ast::ASTNode *Parser::parseAdditiveExpression(bool withoutStructLiterals) {
-  // additive_expression ::=
-  //   | multiplicative_expression
-  //   | additive_expression '+' multiplicative_expression
-  //   | additive_expression '-' multiplicative_expression
-
-  ast::ASTNode *left = parseMultiplicativeExpression(withoutStructLiterals);
-  if (!left) {
-    return nullptr;
-  }
-
-  while (check(TokenKind::Plus) || check(TokenKind::Minus)) {
-    Token opToken = current();
-    advance(); // consume operator
-
-    ast::ASTNode *right = parseMultiplicativeExpression(withoutStructLiterals);
-    if (!right) {
-      return nullptr;
-    }
-
-    left = ast::createBinaryExpr(left, opToken.kind, right, opToken.location,
-                                 arena_);
-  }
-
-  return left;
+  return parseBinaryExpression(Precedence::Additive, withoutStructLiterals);
 }
 
 ast::ASTNode *Parser::parseMultiplicativeExpression(bool withoutStructLiterals) {
-  // multiplicative_expression ::=
-  //   | cast_expression
-  //   | multiplicative_expression '*' cast_expression
-  //   | multiplicative_expression '/' cast_expression
-  //   | multiplicative_expression '%' cast_expression
-
-  ast::ASTNode *left = parseCastExpression(withoutStructLiterals);
-  if (!left) {
-    return nullptr;
-  }
-
-  while (check(TokenKind::Mult) || check(TokenKind::Div) ||
-         check(TokenKind::Mod)) {
-    Token opToken = current();
-    advance(); // consume operator
-
-    ast::ASTNode *right = parseCastExpression(withoutStructLiterals);
-    if (!right) {
-      return nullptr;
-    }
-
-    left = ast::createBinaryExpr(left, opToken.kind, right, opToken.location,
-                                 arena_);
-  }
-
-  return left;
+  return parseBinaryExpression(Precedence::Multiplicative,
+                               withoutStructLiterals);
 }
 
 ast::ASTNode *Parser::parseUnaryExpression(bool withoutStructLiterals) {
@@ -630,11 +529,7 @@ ast::ASTNode *Parser::parseUnaryExpression(bool withoutStructLiterals) {
   //   | '^' unary_expression
 
   // Check for prefix operators
-  if (check(TokenKind::PlusPlus) || check(TokenKind::MinusMinus) ||
-      check(TokenKind::Plus) || check(TokenKind::Minus) ||
-      check(TokenKind::LNot) || check(TokenKind::BNot) ||
-      check(TokenKind::BAnd) || check(TokenKind::LAnd) ||
-      check(TokenKind::BXor)) {
+  if (checkAny(PREFIX_OPERATORS)) {
 
     Token opToken = current();
     advance(); // consume operator
@@ -653,32 +548,7 @@ ast::ASTNode *Parser::parseUnaryExpression(bool withoutStructLiterals) {
 }
 
 ast::ASTNode *Parser::parseCastExpression(bool withoutStructLiterals) {
-  // cast_expression ::=
-  //   | postfix_expression
-  //   | cast_expression 'as' type_expression
-  //   | cast_expression '!:' type_expression
-
-  ast::ASTNode *left = parseUnaryExpression(withoutStructLiterals);
-  if (!left) {
-    return nullptr;
-  }
-
-  // Handle cast operators (left-associative)
-  while (check(TokenKind::As) || check(TokenKind::BangColon)) {
-    bool isRetype = check(TokenKind::BangColon);
-    Token opToken = current();
-    advance(); // consume 'as' or '!:'
-
-    ast::ASTNode *typeExpr = parseTypeExpression();
-    if (!typeExpr) {
-      return nullptr;
-    }
-
-    left =
-        ast::createCastExpr(left, typeExpr, isRetype, opToken.location, arena_);
-  }
-
-  return left;
+  return parseBinaryExpression(Precedence::Cast, withoutStructLiterals);
 }
 
 ast::ASTNode *Parser::parseTypeExpression() {
@@ -770,7 +640,7 @@ ast::ASTNode *Parser::parsePrimaryType() {
   }
 
   // Handle primitive types
-  if (isPrimitiveType(current().kind)) {
+  if (isPrimitiveType(currentKind())) {
     Token typeToken = current();
     advance(); // consume type token
     return ast::createPrimitiveType(typeToken.kind, typeToken.location, arena_);
@@ -779,7 +649,7 @@ ast::ASTNode *Parser::parsePrimaryType() {
   // Handle identifiers and qualified paths
   if (check(TokenKind::Ident)) {
     // Check if it's actually a qualified path (has . or <)
-    if (lookahead(1).kind == TokenKind::Dot || lookahead(1).kind == TokenKind::Less) {
+    if (lookaheadKind(1) == TokenKind::Dot || lookaheadKind(1) == TokenKind::Less) {
       return parseQualifiedPath();  // True qualified path
     } else {
       // Simple identifier
@@ -1203,9 +1073,7 @@ ast::ASTNode *Parser::parsePostfixExpression(bool withoutStructLiterals) {
     return nullptr;
   }
 
-  while (check(TokenKind::PlusPlus) || check(TokenKind::MinusMinus) ||
-         check(TokenKind::LParen) || check(TokenKind::LBracket) ||
-         check(TokenKind::Dot) || check(TokenKind::BAndDot)) {
+  while (checkAny(POSTFIX_OPERATORS)) {
 
     if (check(TokenKind::LBracket)) {
       // Array indexing
@@ -1358,7 +1226,7 @@ ast::ASTNode *Parser::parsePrimaryExpression(bool withoutStructLiterals) {
   }
 
   // Try literal expression
-  if (isLiteral(current().kind)) {
+  if (isLiteral(currentKind())) {
     return parseLiteralExpression();
   }
 
@@ -1383,7 +1251,7 @@ ast::ASTNode *Parser::parsePrimaryExpression(bool withoutStructLiterals) {
   // Try identifier expression or macro call
   if (check(TokenKind::Ident)) {
     // Check for macro call (identifier followed by '!')
-    if (lookahead(1).kind == TokenKind::LNot) {
+    if (lookaheadKind(1) == TokenKind::LNot) {
       return parseMacroCall();
     } else {
       return parseIdentifierExpression(withoutStructLiterals);
@@ -1391,15 +1259,8 @@ ast::ASTNode *Parser::parsePrimaryExpression(bool withoutStructLiterals) {
   }
 
   // No valid primary expression found
-  std::vector<TokenKind> expected = {
-      TokenKind::IntLiteral,    TokenKind::FloatLiteral, TokenKind::CharLiteral,
-      TokenKind::StringLiteral, TokenKind::LString,      TokenKind::True,
-      TokenKind::False,         TokenKind::Null,         TokenKind::Ident,
-      TokenKind::LParen,        TokenKind::LBracket,     TokenKind::LBrace,
-      TokenKind::Elipsis,       TokenKind::ColonColon};
-
   ParseError error = createUnexpectedTokenError(
-      expected, "Expected literal, identifier, parenthesized expression, "
+      PRIMARY_STARTS, "Expected literal, identifier, parenthesized expression, "
       "array literal, struct literal, spread expression, "
       "interpolated string, or :: prefixed type");
   reportError(error);
@@ -1417,7 +1278,7 @@ ast::ASTNode *Parser::parseLiteralExpression() {
   //   | boolean_literal
   //   | null_literal
 
-  switch (current().kind) {
+  switch (currentKind()) {
   case TokenKind::IntLiteral:
     return parseIntegerLiteral();
   case TokenKind::FloatLiteral:
@@ -1435,7 +1296,7 @@ ast::ASTNode *Parser::parseLiteralExpression() {
     // This should not happen if called correctly
     ParseError error(ParseErrorType::InvalidExpression, current().location,
                      std::format("Expected literal, got '{}'",
-                                 tokenKindToString(current().kind)),
+                                 tokenKindToString(currentKind())),
                      current());
     reportError(error);
     return nullptr;
@@ -1681,9 +1542,8 @@ ast::ASTNode *Parser::parseBooleanLiteral() {
     value = false;
     advance();
   } else {
-    std::vector<TokenKind> expected = {TokenKind::True, TokenKind::False};
-    ParseError error =
-        createUnexpectedTokenError(expected, "Expected 'true' or 'false'");
+    ParseError error = createUnexpectedTokenError(
+        {TokenKind::True, TokenKind::False}, "Expected 'true' or 'false'");
     reportError(error);
     return nullptr;
   }
@@ -1980,6 +1840,37 @@ ast::ASTNode *Parser::parseInterpolatedString() {
   return stringExpr;
 }
 
+namespace {
+
+// Separators and terminators that don't start new constructs; recovery
+// skips over them
+constexpr TokenSet SEPARATORS = {TokenKind::Comma, TokenKind::Semicolon,
+                                 TokenKind::RBrace, TokenKind::RParen,
+                                 TokenKind::RBracket};
+
+// Keywords that start a variable declaration in a condition
+constexpr TokenSet VARIABLE_KEYWORDS = {TokenKind::Var, TokenKind::Const,
+                                        TokenKind::Auto};
+
+constexpr TokenSet DECLARATION_KEYWORDS = {
+    TokenKind::Func,   TokenKind::Var,  TokenKind::Const,
+    TokenKind::Struct, TokenKind::Enum, TokenKind::Type};
+
+// Synchronization points for error recovery:
+// - Statement boundaries: ';', '}'
+// - Expression boundaries: ',', ')', ']', '}'
+// - Declaration boundaries: keywords like 'func', 'var', 'struct'
+constexpr TokenSet SYNCHRONIZATION_POINTS = SEPARATORS | DECLARATION_KEYWORDS;
+
+constexpr TokenSet STATEMENT_STARTS =
+    TokenSet{TokenKind::Break, TokenKind::Continue, TokenKind::Defer,
+             TokenKind::Return, TokenKind::Yield, TokenKind::LBrace,
+             TokenKind::If,     TokenKind::While, TokenKind::For,
+             TokenKind::Match} |
+    DECLARATION_KEYWORDS;
+
+} // namespace
+
 void Parser::synchronize() {
   // Skip tokens until we reach a synchronization point
   while (!isAtEnd() && !isSynchronizationPoint()) {
@@ -1992,76 +1883,13 @@ void Parser::synchronize() {
   }
 }
 
-bool Parser::isSeparatorToken() const {
-  TokenKind kind = current().kind;
-  // These are tokens we want to skip over during synchronization
-  // Separators and terminators that don't start new constructs
-  return kind == TokenKind::Comma ||
-         kind == TokenKind::Semicolon ||
-         kind == TokenKind::RBrace ||
-         kind == TokenKind::RParen ||
-         kind == TokenKind::RBracket;
-}
+bool Parser::isSeparatorToken() const { return checkAny(SEPARATORS); }
 
 bool Parser::isSynchronizationPoint() const {
-  // Synchronization points for error recovery:
-  // - Statement boundaries: ';', '}', newlines
-  // - Expression boundaries: ',', ')', ']', '}'
-  // - Declaration boundaries: keywords like 'func', 'var', 'struct'
-  TokenKind kind = current().kind;
-
-  // Statement/block boundaries
-  if (kind == TokenKind::Semicolon || kind == TokenKind::RBrace) {
-    return true;
-  }
-
-  // Expression boundaries
-  if (kind == TokenKind::Comma || kind == TokenKind::RParen ||
-      kind == TokenKind::RBracket) {
-    return true;
-  }
-
-  // Declaration keywords (for future phases)
-  if (kind == TokenKind::Func || kind == TokenKind::Var ||
-      kind == TokenKind::Const || kind == TokenKind::Struct ||
-      kind == TokenKind::Enum || kind == TokenKind::Type) {
-    return true;
-  }
-
-  return false;
+  return checkAny(SYNCHRONIZATION_POINTS);
 }
 
-bool Parser::isStatementStart() const {
-  // Check if current token can start a statement
-  TokenKind kind = current().kind;
-
-  // Statement keywords
-  if (kind == TokenKind::Break || kind == TokenKind::Continue ||
-      kind == TokenKind::Defer || kind == TokenKind::Return ||
-      kind == TokenKind::Yield) {
-    return true;
-  }
-
-  // Block statement
-  if (kind == TokenKind::LBrace) {
-    return true;
-  }
-
-  // Control flow keywords (for future phases)
-  if (kind == TokenKind::If || kind == TokenKind::While ||
-      kind == TokenKind::For || kind == TokenKind::Match) {
-    return true;
-  }
-
-  // Declaration keywords (for future phases)
-  if (kind == TokenKind::Func || kind == TokenKind::Var ||
-      kind == TokenKind::Const || kind == TokenKind::Struct ||
-      kind == TokenKind::Enum || kind == TokenKind::Type) {
-    return true;
-  }
-
-  return false;
-}
+bool Parser::isStatementStart() const { return checkAny(STATEMENT_STARTS); }
 
 // Phase 4: Statement parsing implementation
 
@@ -2077,7 +1905,7 @@ ast::ASTNode *Parser::parseStatement() {
 
   // Dispatch based on current token
   ast::ASTNode *stmt = nullptr;
-  switch (current().kind) {
+  switch (currentKind()) {
   case TokenKind::Break:
     stmt = parseBreakStatement();
     break;
@@ -2439,7 +2267,7 @@ ast::ASTNode *Parser::parseDeclaration() {
 
   // Dispatch based on current token
   ast::ASTNode *decl = nullptr;
-  switch (current().kind) {
+  switch (currentKind()) {
   case TokenKind::Var:
   case TokenKind::Const:
   case TokenKind::Auto:
@@ -2584,7 +2412,7 @@ ast::ASTNode *Parser::parseFunctionDeclaration(bool isExtern) {
     TokenKind operatorToken = TokenKind::Error;
 
     // Try special operators first (multi-token)
-    if (check(TokenKind::LParen) && lookahead().kind == TokenKind::RParen) {
+    if (check(TokenKind::LParen) && lookaheadKind() == TokenKind::RParen) {
       // Handle () operator
       operatorName = getSpecialOverloadOperatorName(TokenKind::LParen, TokenKind::RParen);
       operatorToken = TokenKind::CallOverride;
@@ -2613,33 +2441,33 @@ ast::ASTNode *Parser::parseFunctionDeclaration(bool isExtern) {
     } else if (check(TokenKind::BAndDot)) {
       // Handle &. redirect operator
       operatorName = getSpecialOverloadOperatorName(TokenKind::BAndDot);
-      operatorToken = current().kind;
+      operatorToken = currentKind();
       advance(); // consume '&.'
     } else if (check(TokenKind::DotDot)) {
       // Handle .. range operator
       operatorName = getSpecialOverloadOperatorName(TokenKind::DotDot);
-      operatorToken = current().kind;
+      operatorToken = currentKind();
       advance(); // consume '..'
     } else if (check(TokenKind::Bool)) {
       // Handle bool truthy operator
       operatorName = getSpecialOverloadOperatorName(TokenKind::Bool);
-      operatorToken = current().kind;
+      operatorToken = currentKind();
       advance(); // consume 'bool'
     } else {
       // Check for increment/decrement operators first
-      if (current().kind == TokenKind::PlusPlus) {
+      if (currentKind() == TokenKind::PlusPlus) {
         operatorName = "inc";
         operatorToken = TokenKind::PlusPlus;
         advance(); // consume '++'
-      } else if (current().kind == TokenKind::MinusMinus) {
+      } else if (currentKind() == TokenKind::MinusMinus) {
         operatorName = "dec";
         operatorToken = TokenKind::MinusMinus;
         advance(); // consume '--'
       } else {
         // Try binary operators
-        operatorName = getBinaryOverloadOperatorName(current().kind);
+        operatorName = getBinaryOverloadOperatorName(currentKind());
         if (!operatorName.empty()) {
-          operatorToken = current().kind;
+          operatorToken = currentKind();
           advance(); // consume operator
         } else {
           reportError(ParseError(ParseErrorType::UnexpectedToken, current().location,
@@ -2830,8 +2658,7 @@ ast::ASTNode *Parser::parseFunctionDeclaration(bool isExtern) {
   if (hasGenericParams) {
     auto *genericDecl = ast::createGenericDeclaration(startLoc, arena_);
 
-    // Move generic parameters vector directly to avoid copying
-    genericDecl->parameters = std::move(genericParams);
+    genericDecl->parameters.assign(genericParams.begin(), genericParams.end());
 
     // Add children for proper AST parent-child relationships
     for (auto *param : genericDecl->parameters) {
@@ -2868,7 +2695,7 @@ ast::ASTNode *Parser::parseIfStatement() {
     advance(); // consume '('
 
     // Parse condition expression or variable declaration
-    if (check(TokenKind::Var) || check(TokenKind::Const) || check(TokenKind::Auto)) {
+    if (checkAny(VARIABLE_KEYWORDS)) {
       condition = parseVariableDeclaration(true, false); // single variable only
     } else {
       condition = parseExpression();
@@ -2883,7 +2710,7 @@ ast::ASTNode *Parser::parseIfStatement() {
     }
   } else {
     // Parse bare condition (expression or variable declaration)
-    if (check(TokenKind::Var) || check(TokenKind::Const) || check(TokenKind::Auto)) {
+    if (checkAny(VARIABLE_KEYWORDS)) {
       condition = parseVariableDeclaration(true, false); // single variable only
     } else {
       condition = parseExpression(true);
@@ -2975,7 +2802,7 @@ ast::ASTNode *Parser::parseWhileStatement() {
     advance(); // consume '('
 
     // Parse condition expression or variable declaration
-    if (check(TokenKind::Var) || check(TokenKind::Const) || check(TokenKind::Auto)) {
+    if (checkAny(VARIABLE_KEYWORDS)) {
       condition = parseVariableDeclaration(true, false); // single variable only
     } else {
       condition = parseExpression();
@@ -2990,7 +2817,7 @@ ast::ASTNode *Parser::parseWhileStatement() {
     }
   } else {
     // Parse bare condition (expression or variable declaration)
-    if (check(TokenKind::Var) || check(TokenKind::Const) || check(TokenKind::Auto)) {
+    if (checkAny(VARIABLE_KEYWORDS)) {
       condition = parseVariableDeclaration(true, false); // single variable only
     } else {
       condition = parseExpression(true); // withoutStructLiterals = true
@@ -3044,8 +2871,10 @@ ast::ASTNode *Parser::parseForStatement() {
     advance(); // consume '('
   }
 
-  // Parse iterator variable list
-  std::vector<ast::ASTNode *> variables;
+  // Parse iterator variable list; the list itself only lives until the
+  // variables are moved onto the node
+  ScratchArena scratch;
+  ArenaVector<ast::ASTNode *> variables{ArenaSTLAllocator<ast::ASTNode *>(scratch)};
 
   do {
     if (!check(TokenKind::Ident)) {
@@ -3156,7 +2985,7 @@ ast::ASTNode *Parser::parseSwitchStatement() {
   }
 
   // Parse discriminant expression or variable declaration
-  if (check(TokenKind::Var) || check(TokenKind::Const) || check(TokenKind::Auto)) {
+  if (checkAny(VARIABLE_KEYWORDS)) {
     discriminant = parseVariableDeclaration(true, false); // single variable only
   } else {
     discriminant = parseExpression(hasParentheses? false : true); // withoutStructLiterals = true
@@ -3491,7 +3320,7 @@ bool Parser::parseAttributeArguments(ast::AttributeNode *attr) {
   // Parse arguments
   do {
     // Check for named argument syntax (identifier ':' literal)
-    if (check(TokenKind::Ident) && lookahead(1).kind == TokenKind::Colon) {
+    if (check(TokenKind::Ident) && lookaheadKind(1) == TokenKind::Colon) {
       isNamedArgs = true;
 
       // Parse named argument: name : value
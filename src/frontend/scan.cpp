@@ -0,0 +1,497 @@
+#include "cxy/frontend/scan.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define CXY_SCAN_HAVE_SSE2 1
+#if defined(__GNUC__) || defined(__clang__)
+// AVX2 kernels are compiled for that target alone and only called after
+// the CPU reported support
+#define CXY_SCAN_HAVE_AVX2 1
+#define CXY_SCAN_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace cxy::scan {
+
+namespace {
+
+bool isWhitespaceByte(char c) noexcept {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Account for the bytes in mask `newlineMask` below bit `limit` of a block
+// starting at `offset`
+void countNewlines(Skip &skip, size_t offset, uint64_t newlineMask,
+                   size_t limit) noexcept {
+  if (limit < 64) {
+    newlineMask &= (uint64_t{1} << limit) - 1;
+  }
+  if (newlineMask) {
+    skip.newlines += static_cast<size_t>(std::popcount(newlineMask));
+    skip.lineStart = offset + 64 - std::countl_zero(newlineMask);
+  }
+}
+
+// Scalar tails, also the whole scan at SimdLevel::Scalar
+Skip finishWhitespace(const char *data, size_t size, Skip skip) noexcept {
+  size_t i = skip.length;
+  for (; i < size && isWhitespaceByte(data[i]); ++i) {
+    if (data[i] == '\n') {
+      ++skip.newlines;
+      skip.lineStart = i + 1;
+    }
+  }
+  skip.length = i;
+  return skip;
+}
+
+Skip finishUntil(const char *data, size_t size, char first, char second,
+                 char third, Skip skip) noexcept {
+  size_t i = skip.length;
+  for (; i < size && data[i] != first && data[i] != second && data[i] != third;
+       ++i) {
+    if (data[i] == '\n') {
+      ++skip.newlines;
+      skip.lineStart = i + 1;
+    }
+  }
+  skip.length = i;
+  return skip;
+}
+
+Skip skipWhitespaceScalar(const char *data, size_t size) noexcept {
+  return finishWhitespace(data, size, Skip{});
+}
+
+Skip skipUntilScalar(const char *data, size_t size, char first, char second,
+                     char third) noexcept {
+  return finishUntil(data, size, first, second, third, Skip{});
+}
+
+// Validate whole characters from `i`, which starts one, until one starts at
+// or past `limit`. On failure `i` is left at the start of the bad sequence.
+bool validateCharacters(const unsigned char *bytes, size_t size, size_t &i,
+                        size_t limit) noexcept {
+  while (i < limit) {
+    const unsigned char lead = bytes[i];
+    if (lead < 0x80) {
+      ++i;
+      continue;
+    }
+
+    // Well-formed sequences per table 3-7 of the Unicode standard: the
+    // second byte's range depends on the lead, later bytes are 80..BF
+    size_t length;
+    unsigned char low = 0x80;
+    unsigned char high = 0xBF;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+      length = 2;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+      length = 3;
+      low = lead == 0xE0 ? 0xA0 : 0x80; // Overlong
+      high = lead == 0xED ? 0x9F : 0xBF; // Surrogates
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+      length = 4;
+      low = lead == 0xF0 ? 0x90 : 0x80;  // Overlong
+      high = lead == 0xF4 ? 0x8F : 0xBF; // Above U+10FFFF
+    } else {
+      return false;
+    }
+
+    if (size - i < length || bytes[i + 1] < low || bytes[i + 1] > high) {
+      return false;
+    }
+    for (size_t k = 2; k < length; ++k) {
+      if ((bytes[i + k] & 0xC0) != 0x80) {
+        return false;
+      }
+    }
+    i += length;
+  }
+  return true;
+}
+
+// Scalar tail, also the whole check at SimdLevel::Scalar
+size_t finishUtf8(const char *data, size_t size, size_t i) noexcept {
+  const auto *bytes = reinterpret_cast<const unsigned char *>(data);
+  while (i < size) {
+    // Eight bytes at a time while they are ASCII
+    if (size - i >= 8) {
+      uint64_t word;
+      std::memcpy(&word, bytes + i, sizeof(word));
+      if ((word & 0x8080808080808080) == 0) {
+        i += 8;
+        continue;
+      }
+    }
+    if (!validateCharacters(bytes, size, i, std::min(i + 8, size))) {
+      return i;
+    }
+  }
+  return size;
+}
+
+// Start of the character that straddles `offset`, or `offset` itself if none
+// does. Everything before `offset` must already be known to be well formed,
+// apart from a truncated sequence at its very end.
+size_t characterStart(const char *data, size_t offset) noexcept {
+  const auto *bytes = reinterpret_cast<const unsigned char *>(data);
+  for (size_t back = 1; back <= 3 && back <= offset; ++back) {
+    const unsigned char byte = bytes[offset - back];
+    if ((byte & 0xC0) == 0x80) {
+      continue;
+    }
+    const size_t length = byte >= 0xF0   ? 4
+                          : byte >= 0xE0 ? 3
+                          : byte >= 0xC0 ? 2
+                                         : 1;
+    return length > back ? offset - back : offset;
+  }
+  return offset;
+}
+
+size_t validUtf8PrefixScalar(const char *data, size_t size) noexcept {
+  return finishUtf8(data, size, 0);
+}
+
+#ifdef CXY_SCAN_HAVE_SSE2
+// ASCII blocks are skipped with one compare; any other block is checked
+// character by character
+size_t validUtf8PrefixSSE2(const char *data, size_t size) noexcept {
+  const auto *bytes = reinterpret_cast<const unsigned char *>(data);
+  size_t i = 0;
+  while (size - i >= 16) {
+    const __m128i block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+    if (_mm_movemask_epi8(block) == 0) {
+      i += 16;
+    } else if (!validateCharacters(bytes, size, i, i + 16)) {
+      return i;
+    }
+  }
+  return finishUtf8(data, size, i);
+}
+
+Skip skipWhitespaceSSE2(const char *data, size_t size) noexcept {
+  Skip skip;
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i tab = _mm_set1_epi8('\t');
+  const __m128i cr = _mm_set1_epi8('\r');
+  const __m128i lf = _mm_set1_epi8('\n');
+  for (; skip.length + 16 <= size; skip.length += 16) {
+    const __m128i bytes = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(data + skip.length));
+    const __m128i newline = _mm_cmpeq_epi8(bytes, lf);
+    const __m128i blank = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(bytes, space), _mm_cmpeq_epi8(bytes, tab)),
+        _mm_or_si128(_mm_cmpeq_epi8(bytes, cr), newline));
+    const auto other =
+        static_cast<uint32_t>(~_mm_movemask_epi8(blank)) & 0xffffu;
+    const auto newlines = static_cast<uint32_t>(_mm_movemask_epi8(newline));
+    const size_t stop = other ? std::countr_zero(other) : 16;
+    countNewlines(skip, skip.length, newlines, stop);
+    if (other) {
+      skip.length += stop;
+      return skip;
+    }
+  }
+  return finishWhitespace(data, size, skip);
+}
+
+Skip skipUntilSSE2(const char *data, size_t size, char first, char second,
+                   char third) noexcept {
+  Skip skip;
+  const __m128i firstByte = _mm_set1_epi8(first);
+  const __m128i secondByte = _mm_set1_epi8(second);
+  const __m128i thirdByte = _mm_set1_epi8(third);
+  const __m128i lf = _mm_set1_epi8('\n');
+  for (; skip.length + 16 <= size; skip.length += 16) {
+    const __m128i bytes = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(data + skip.length));
+    const auto found = static_cast<uint32_t>(_mm_movemask_epi8(
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, firstByte),
+                                  _mm_cmpeq_epi8(bytes, secondByte)),
+                     _mm_cmpeq_epi8(bytes, thirdByte))));
+    const auto newlines =
+        static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, lf)));
+    const size_t stop = found ? std::countr_zero(found) : 16;
+    countNewlines(skip, skip.length, newlines, stop);
+    if (found) {
+      skip.length += stop;
+      return skip;
+    }
+  }
+  return finishUntil(data, size, first, second, third, skip);
+}
+#endif
+
+#ifdef CXY_SCAN_HAVE_AVX2
+CXY_SCAN_AVX2 Skip skipWhitespaceAVX2(const char *data, size_t size) noexcept {
+  Skip skip;
+  const __m256i space = _mm256_set1_epi8(' ');
+  const __m256i tab = _mm256_set1_epi8('\t');
+  const __m256i cr = _mm256_set1_epi8('\r');
+  const __m256i lf = _mm256_set1_epi8('\n');
+  for (; skip.length + 32 <= size; skip.length += 32) {
+    const __m256i bytes = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(data + skip.length));
+    const __m256i newline = _mm256_cmpeq_epi8(bytes, lf);
+    const __m256i blank =
+        _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(bytes, space),
+                                        _mm256_cmpeq_epi8(bytes, tab)),
+                        _mm256_or_si256(_mm256_cmpeq_epi8(bytes, cr), newline));
+    const auto other = ~static_cast<uint32_t>(_mm256_movemask_epi8(blank));
+    const auto newlines = static_cast<uint32_t>(_mm256_movemask_epi8(newline));
+    const size_t stop = other ? std::countr_zero(other) : 32;
+    countNewlines(skip, skip.length, newlines, stop);
+    if (other) {
+      skip.length += stop;
+      return skip;
+    }
+  }
+  return finishWhitespace(data, size, skip);
+}
+
+CXY_SCAN_AVX2 Skip skipUntilAVX2(const char *data, size_t size, char first,
+                                 char second, char third) noexcept {
+  Skip skip;
+  const __m256i firstByte = _mm256_set1_epi8(first);
+  const __m256i secondByte = _mm256_set1_epi8(second);
+  const __m256i thirdByte = _mm256_set1_epi8(third);
+  const __m256i lf = _mm256_set1_epi8('\n');
+  for (; skip.length + 32 <= size; skip.length += 32) {
+    const __m256i bytes = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(data + skip.length));
+    const auto found = static_cast<uint32_t>(_mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(bytes, firstByte),
+                                        _mm256_cmpeq_epi8(bytes, secondByte)),
+                        _mm256_cmpeq_epi8(bytes, thirdByte))));
+    const auto newlines = static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, lf)));
+    const size_t stop = found ? std::countr_zero(found) : 32;
+    countNewlines(skip, skip.length, newlines, stop);
+    if (found) {
+      skip.length += stop;
+      return skip;
+    }
+  }
+  return finishUntil(data, size, first, second, third, skip);
+}
+#endif
+
+// Error classes for a pair of adjacent bytes, named after simdjson's. Each
+// table below maps a nibble to the classes it can take part in; a pair is
+// bad when the classes of its three nibbles intersect.
+constexpr uint8_t TOO_SHORT = 1 << 0;  // Lead followed by a non-continuation
+constexpr uint8_t TOO_LONG = 1 << 1;   // ASCII followed by a continuation
+constexpr uint8_t OVERLONG_3 = 1 << 2; // E0 80..9F
+constexpr uint8_t TOO_LARGE = 1 << 3;  // F4 90..BF, F5..FF
+constexpr uint8_t SURROGATE = 1 << 4;  // ED A0..BF
+constexpr uint8_t OVERLONG_2 = 1 << 5; // C0, C1
+constexpr uint8_t TOO_LARGE_1000 = 1 << 6;
+constexpr uint8_t OVERLONG_4 = 1 << 6; // F0 80..8F
+constexpr uint8_t TWO_CONTS = 1 << 7;  // Continuation after continuation,
+                                       // unless a 3 or 4 byte lead expects it
+constexpr uint8_t CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+#ifdef CXY_SCAN_HAVE_AVX2
+CXY_SCAN_AVX2 __m256i lookupNibbles(__m256i nibbles,
+                                    const uint8_t (&table)[16]) {
+  return _mm256_shuffle_epi8(
+      _mm256_broadcastsi128_si256(
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(table))),
+      nibbles);
+}
+
+// Bytes of `block` shifted up by `count` lanes, filled from the end of
+// `previous`
+template <int count>
+CXY_SCAN_AVX2 __m256i precedingBytes(__m256i block, __m256i previous) {
+  return _mm256_alignr_epi8(
+      block, _mm256_permute2x128_si256(previous, block, 0x21), 16 - count);
+}
+
+// Nonzero lanes where `block` is not valid UTF-8 given the block before it.
+// Sequences running past the end of `block` are not flagged.
+CXY_SCAN_AVX2 __m256i utf8Errors(__m256i block, __m256i previous) {
+  static constexpr uint8_t firstHigh[16] = {
+      TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+      TOO_LONG, TOO_LONG, TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+      TOO_SHORT | OVERLONG_2, TOO_SHORT,
+      TOO_SHORT | OVERLONG_3 | SURROGATE,
+      TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4};
+  static constexpr uint8_t firstLow[16] = {
+      CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+      CARRY | OVERLONG_2,
+      CARRY,
+      CARRY,
+      CARRY | TOO_LARGE,
+      CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+      CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000};
+  static constexpr uint8_t secondHigh[16] = {
+      TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+      TOO_SHORT, TOO_SHORT,
+      TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 |
+          OVERLONG_4,
+      TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+      TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+      TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+      TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT};
+
+  const __m256i low = _mm256_set1_epi8(0x0F);
+  const __m256i prev1 = precedingBytes<1>(block, previous);
+  const __m256i special = _mm256_and_si256(
+      _mm256_and_si256(
+          lookupNibbles(_mm256_and_si256(_mm256_srli_epi16(prev1, 4), low),
+                        firstHigh),
+          lookupNibbles(_mm256_and_si256(prev1, low), firstLow)),
+      lookupNibbles(_mm256_and_si256(_mm256_srli_epi16(block, 4), low),
+                    secondHigh));
+
+  // Third and fourth bytes of a sequence are the only places two
+  // continuations in a row are expected. Saturating subtraction leaves the
+  // high bit set only two bytes after an E0..FF lead or three after F0..FF.
+  const __m256i third = _mm256_subs_epu8(precedingBytes<2>(block, previous),
+                                         _mm256_set1_epi8(0xE0 - 0x80));
+  const __m256i fourth = _mm256_subs_epu8(precedingBytes<3>(block, previous),
+                                          _mm256_set1_epi8(0xF0 - 0x80));
+  const __m256i expected = _mm256_and_si256(_mm256_or_si256(third, fourth),
+                                            _mm256_set1_epi8(char(0x80)));
+  return _mm256_xor_si256(expected, special);
+}
+
+CXY_SCAN_AVX2 size_t validUtf8PrefixAVX2(const char *data,
+                                         size_t size) noexcept {
+  size_t i = 0;
+  __m256i previous = _mm256_setzero_si256();
+  bool previousAscii = true;
+  for (; size - i >= 32; i += 32) {
+    const __m256i block =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+    const bool ascii = _mm256_movemask_epi8(block) == 0;
+    // An ASCII block after another needs no check; after a non-ASCII one it
+    // still has to complete the sequence left open there
+    if (!ascii || !previousAscii) {
+      const __m256i errors = utf8Errors(block, previous);
+      if (!_mm256_testz_si256(errors, errors)) {
+        // Find the exact offset from the last character that began before
+        // this block
+        return finishUtf8(data, size, characterStart(data, i));
+      }
+    }
+    previous = block;
+    previousAscii = ascii;
+  }
+  return finishUtf8(data, size, characterStart(data, i));
+}
+#endif
+
+struct Kernels {
+  SimdLevel level;
+  Skip (*skipWhitespace)(const char *, size_t) noexcept;
+  Skip (*skipUntil)(const char *, size_t, char, char, char) noexcept;
+  size_t (*validUtf8Prefix)(const char *, size_t) noexcept;
+};
+
+constexpr Kernels SCALAR_KERNELS{SimdLevel::Scalar, skipWhitespaceScalar,
+                                 skipUntilScalar, validUtf8PrefixScalar};
+#ifdef CXY_SCAN_HAVE_SSE2
+constexpr Kernels SSE2_KERNELS{SimdLevel::SSE2, skipWhitespaceSSE2,
+                               skipUntilSSE2, validUtf8PrefixSSE2};
+#endif
+#ifdef CXY_SCAN_HAVE_AVX2
+constexpr Kernels AVX2_KERNELS{SimdLevel::AVX2, skipWhitespaceAVX2,
+                               skipUntilAVX2, validUtf8PrefixAVX2};
+#endif
+
+const Kernels &kernelsFor(SimdLevel level) noexcept {
+  switch (level) {
+#ifdef CXY_SCAN_HAVE_AVX2
+  case SimdLevel::AVX2:
+    return AVX2_KERNELS;
+#endif
+#ifdef CXY_SCAN_HAVE_SSE2
+  case SimdLevel::SSE2:
+    return SSE2_KERNELS;
+#endif
+  default:
+    return SCALAR_KERNELS;
+  }
+}
+
+// Null until the first scan or setSimdLevel()
+std::atomic<const Kernels *> activeKernels{nullptr};
+
+const Kernels &kernels() noexcept {
+  if (const auto *active = activeKernels.load(std::memory_order_relaxed)) {
+    return *active;
+  }
+  const Kernels &detected = kernelsFor(detectSimdLevel());
+  activeKernels.store(&detected, std::memory_order_relaxed);
+  return detected;
+}
+
+} // namespace
+
+SimdLevel detectSimdLevel() noexcept {
+#ifdef CXY_SCAN_HAVE_AVX2
+  if (__builtin_cpu_supports("avx2")) {
+    return SimdLevel::AVX2;
+  }
+#endif
+#ifdef CXY_SCAN_HAVE_SSE2
+  return SimdLevel::SSE2;
+#else
+  return SimdLevel::Scalar;
+#endif
+}
+
+SimdLevel getSimdLevel() noexcept { return kernels().level; }
+
+void setSimdLevel(SimdLevel level) noexcept {
+  const SimdLevel best = detectSimdLevel();
+  activeKernels.store(&kernelsFor(level > best ? best : level),
+                      std::memory_order_relaxed);
+}
+
+std::string_view toString(SimdLevel level) noexcept {
+  switch (level) {
+  case SimdLevel::Scalar:
+    return "scalar";
+  case SimdLevel::SSE2:
+    return "sse2";
+  case SimdLevel::AVX2:
+    return "avx2";
+  }
+  return "unknown";
+}
+
+Skip skipWhitespace(const char *data, size_t size) noexcept {
+  return kernels().skipWhitespace(data, size);
+}
+
+Skip skipUntil(const char *data, size_t size, char first, char second,
+               char third) noexcept {
+  return kernels().skipUntil(data, size, first, second, third);
+}
+
+size_t validUtf8Prefix(const char *data, size_t size) noexcept {
+  return kernels().validUtf8Prefix(data, size);
+}
+
+} // namespace cxy::scan
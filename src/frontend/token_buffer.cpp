@@ -0,0 +1,46 @@
+#include "cxy/frontend/token_buffer.hpp"
+
+namespace cxy {
+
+TokenBuffer::TokenBuffer(Lexer &lexer) : lexer_(lexer) {
+  CompactToken token;
+  do {
+    token = lexer.nextCompactToken();
+    kinds_.push_back(token.kind);
+    flags_.push_back(token.flags);
+    files_.push_back(token.file);
+    offsets_.push_back(token.offset);
+    lengths_.push_back(token.length);
+    values_.push_back(token.valueIndex);
+  } while (!token.isEof());
+
+  // The stream is complete, so drop the slack from geometric growth
+  kinds_.shrink_to_fit();
+  flags_.shrink_to_fit();
+  files_.shrink_to_fit();
+  offsets_.shrink_to_fit();
+  lengths_.shrink_to_fit();
+  values_.shrink_to_fit();
+}
+
+CompactToken TokenBuffer::operator[](size_t index) const {
+  index = clamp(index);
+  CompactToken token;
+  token.kind = kinds_[index];
+  token.flags = flags_[index];
+  token.file = files_[index];
+  token.offset = offsets_[index];
+  token.length = lengths_[index];
+  token.valueIndex = values_[index];
+  return token;
+}
+
+size_t TokenBuffer::memoryUsage() const {
+  return kinds_.capacity() * sizeof(TokenKind) +
+         flags_.capacity() * sizeof(uint8_t) +
+         files_.capacity() * sizeof(FileID) +
+         (offsets_.capacity() + lengths_.capacity() + values_.capacity()) *
+             sizeof(uint32_t);
+}
+
+} // namespace cxy
@@ -1,7 +1,6 @@
 #include <cxy/compiler.hpp>
 #include <cxy/diagnostics.hpp>
 #include <iostream>
-#include <sstream>
 
 using namespace cxy;
 using namespace cxy::compiler;
@@ -151,18 +150,9 @@ int main(int argc, char** argv) {
     if (inputFiles.empty()) {
         // We already checked stdin availability, so read from it
         if (useStdin) {
-            // Read from stdin
-            std::ostringstream buffer;
-            buffer << std::cin.rdbuf();
-            std::string source = buffer.str();
-
-            if (!source.empty()) {
-                diagnostics.info("Compiling from stdin...", Location{});
-                compileResult = compiler.compileSource(source, "<stdin>");
-            } else {
-                std::cerr << "No input files specified and stdin is empty." << std::endl;
-                return 1;
-            }
+            // Read from stdin, straight into the compiler's source manager
+            diagnostics.info("Compiling from stdin...", Location{});
+            compileResult = compiler.compileStdin();
         } else {
             std::cerr << "No input files specified and stdin is empty." << std::endl;
             return 1;
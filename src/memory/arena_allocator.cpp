@@ -1,58 +1,144 @@
 #include <algorithm>
+#include <bit>
 #include <cassert>
 #include <cstdlib>
+#include <cstring>
 #include <cxy/memory/arena.hpp>
 #include <stdexcept>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define CXY_ARENA_HAVE_MMAP 1
+#endif
+
 namespace cxy {
 
+namespace {
+
+// Index of the largest power-of-two class not exceeding `size`
+size_t sizeClassFloor(size_t size, size_t minShift) noexcept {
+  return static_cast<size_t>(std::bit_width(size)) - 1 - minShift;
+}
+
+// Index of the smallest power-of-two class holding `size`
+size_t sizeClassCeil(size_t size, size_t minShift) noexcept {
+  const auto shift = static_cast<size_t>(std::bit_width(size - 1));
+  return shift > minShift ? shift - minShift : 0;
+}
+
+} // namespace
+
 // MemoryBlock implementation
-MemoryBlock::MemoryBlock(size_t blockSize)
-    : data(nullptr), size(blockSize), used(0), next(nullptr) {
+MemoryBlock::MemoryBlock(size_t blockSize, bool map, bool hugePages,
+                         bool prefault)
+    : data(nullptr), size(blockSize), used(0), next(nullptr), mapped(false) {
   if (blockSize == 0) {
     throw std::invalid_argument("Block size cannot be zero");
   }
 
+#ifdef CXY_ARENA_HAVE_MMAP
+  if (map) {
+    const auto pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t mappedSize = (blockSize + pageSize - 1) & ~(pageSize - 1);
+
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_POPULATE
+    // Huge page blocks are touched after madvise() so they fault in as
+    // huge pages; everything else can be populated by the kernel directly
+    if (prefault && !hugePages) {
+      flags |= MAP_POPULATE;
+    }
+#endif
+
+    void *memory =
+        mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (memory != MAP_FAILED) {
+#ifdef MADV_HUGEPAGE
+      if (hugePages) {
+        (void)madvise(memory, mappedSize, MADV_HUGEPAGE);
+      }
+#endif
+#ifdef MAP_POPULATE
+      const bool touchPages = prefault && hugePages;
+#else
+      const bool touchPages = prefault;
+#endif
+      if (touchPages) {
+        auto *bytes = static_cast<volatile char *>(memory);
+        for (size_t offset = 0; offset < mappedSize; offset += pageSize) {
+          bytes[offset] = 0;
+        }
+      }
+
+      data = memory;
+      size = mappedSize;
+      mapped = true;
+      return;
+    }
+    // Mapping failed, fall back to the heap
+  }
+#else
+  (void)map;
+  (void)hugePages;
+  (void)prefault;
+#endif
+
   data = std::aligned_alloc(alignof(std::max_align_t), blockSize);
   if (!data) {
     throw std::bad_alloc();
   }
 }
 
-MemoryBlock::~MemoryBlock() {
-  if (data) {
-    std::free(data);
-    data = nullptr;
-  }
-}
+MemoryBlock::~MemoryBlock() { release(); }
 
 MemoryBlock::MemoryBlock(MemoryBlock &&other) noexcept
-    : data(other.data), size(other.size), used(other.used), next(other.next) {
+    : data(other.data), size(other.size), used(other.used), next(other.next),
+      mapped(other.mapped) {
   other.data = nullptr;
   other.size = 0;
   other.used = 0;
   other.next = nullptr;
+  other.mapped = false;
 }
 
 MemoryBlock &MemoryBlock::operator=(MemoryBlock &&other) noexcept {
   if (this != &other) {
-    if (data) {
-      std::free(data);
-    }
+    release();
 
     data = other.data;
     size = other.size;
     used = other.used;
     next = other.next;
+    mapped = other.mapped;
 
     other.data = nullptr;
     other.size = 0;
     other.used = 0;
     other.next = nullptr;
+    other.mapped = false;
   }
   return *this;
 }
 
+void MemoryBlock::release() noexcept {
+  if (!data) {
+    return;
+  }
+
+#ifdef CXY_ARENA_HAVE_MMAP
+  if (mapped) {
+    munmap(data, size);
+  } else {
+    std::free(data);
+  }
+#else
+  std::free(data);
+#endif
+  data = nullptr;
+  mapped = false;
+}
+
 bool MemoryBlock::hasSpace(size_t requestedSize,
                            size_t alignment) const noexcept {
   if (!data)
@@ -88,23 +174,41 @@ size_t MemoryBlock::alignAddress(size_t address, size_t alignment) noexcept {
 
 // ArenaAllocator implementation
 ArenaAllocator::ArenaAllocator(size_t blockSize)
-    : firstBlock(nullptr), currentBlock(nullptr), defaultBlockSize(blockSize),
-      totalAllocated(0), totalUsed(0) {
-  if (blockSize == 0) {
+    : ArenaAllocator(ArenaOptions{.initialBlockSize = blockSize}) {}
+
+ArenaAllocator::ArenaAllocator(const ArenaOptions &arenaOptions)
+    : firstBlock(nullptr), lastBlock(nullptr), currentBlock(nullptr),
+      options(arenaOptions), nextBlockSize(arenaOptions.initialBlockSize),
+      blockCount(0), totalAllocated(0), totalUsed(0), finalizers(nullptr),
+      finalizerCount(0), freeBuffers{}, recyclableBytes(0) {
+  if (options.initialBlockSize == 0) {
     throw std::invalid_argument("Block size cannot be zero");
   }
+  options.growthFactor = std::max<size_t>(options.growthFactor, 1);
+  options.maxBlockSize =
+      std::max(options.maxBlockSize, options.initialBlockSize);
 }
 
 ArenaAllocator::~ArenaAllocator() { clear(); }
 
 ArenaAllocator::ArenaAllocator(ArenaAllocator &&other) noexcept
-    : firstBlock(other.firstBlock), currentBlock(other.currentBlock),
-      defaultBlockSize(other.defaultBlockSize),
-      totalAllocated(other.totalAllocated), totalUsed(other.totalUsed) {
+    : firstBlock(other.firstBlock), lastBlock(other.lastBlock),
+      currentBlock(other.currentBlock), options(other.options),
+      nextBlockSize(other.nextBlockSize), blockCount(other.blockCount),
+      totalAllocated(other.totalAllocated), totalUsed(other.totalUsed),
+      finalizers(other.finalizers), finalizerCount(other.finalizerCount),
+      freeBuffers(other.freeBuffers), recyclableBytes(other.recyclableBytes) {
   other.firstBlock = nullptr;
+  other.lastBlock = nullptr;
   other.currentBlock = nullptr;
+  other.nextBlockSize = other.options.initialBlockSize;
+  other.blockCount = 0;
   other.totalAllocated = 0;
   other.totalUsed = 0;
+  other.finalizers = nullptr;
+  other.finalizerCount = 0;
+  other.freeBuffers.fill(nullptr);
+  other.recyclableBytes = 0;
 }
 
 ArenaAllocator &ArenaAllocator::operator=(ArenaAllocator &&other) noexcept {
@@ -112,15 +216,29 @@ ArenaAllocator &ArenaAllocator::operator=(ArenaAllocator &&other) noexcept {
     clear();
 
     firstBlock = other.firstBlock;
+    lastBlock = other.lastBlock;
     currentBlock = other.currentBlock;
-    defaultBlockSize = other.defaultBlockSize;
+    options = other.options;
+    nextBlockSize = other.nextBlockSize;
+    blockCount = other.blockCount;
     totalAllocated = other.totalAllocated;
     totalUsed = other.totalUsed;
+    finalizers = other.finalizers;
+    finalizerCount = other.finalizerCount;
+    freeBuffers = other.freeBuffers;
+    recyclableBytes = other.recyclableBytes;
 
     other.firstBlock = nullptr;
+    other.lastBlock = nullptr;
     other.currentBlock = nullptr;
+    other.nextBlockSize = other.options.initialBlockSize;
+    other.blockCount = 0;
     other.totalAllocated = 0;
     other.totalUsed = 0;
+    other.finalizers = nullptr;
+    other.finalizerCount = 0;
+    other.freeBuffers.fill(nullptr);
+    other.recyclableBytes = 0;
   }
   return *this;
 }
@@ -138,9 +256,19 @@ void *ArenaAllocator::allocate(size_t size, size_t alignment) {
     }
   }
 
+  // Blocks kept by reset() or a checkpoint restore come before new ones.
+  // Anything past currentBlock is dead, so each is reset on the way in.
+  while (currentBlock && currentBlock->next) {
+    currentBlock = currentBlock->next;
+    currentBlock->reset();
+    if (void *ptr = currentBlock->allocate(size, alignment)) {
+      totalUsed += size;
+      return ptr;
+    }
+  }
+
   // Need a new block
-  const size_t minBlockSize = std::max(size + alignment, defaultBlockSize);
-  currentBlock = allocateNewBlock(minBlockSize);
+  currentBlock = allocateNewBlock(size + alignment);
 
   void *ptr = currentBlock->allocate(size, alignment);
   assert(ptr != nullptr); // Should always succeed on new block
@@ -148,18 +276,124 @@ void *ArenaAllocator::allocate(size_t size, size_t alignment) {
   return ptr;
 }
 
+void *ArenaAllocator::allocateRecycled(size_t size, size_t alignment) {
+  if (size == 0) {
+    return nullptr;
+  }
+
+  const size_t sizeClass = sizeClassCeil(size, MIN_SIZE_CLASS_SHIFT);
+  if (sizeClass < SIZE_CLASS_COUNT) {
+    auto *buffer = freeBuffers[sizeClass];
+    if (buffer && reinterpret_cast<uintptr_t>(buffer) % alignment == 0) {
+      freeBuffers[sizeClass] = buffer->next;
+      recyclableBytes -= buffer->size;
+      totalUsed += size;
+      return buffer;
+    }
+  }
+
+  return allocate(size, alignment);
+}
+
+void ArenaAllocator::deallocate(void *ptr, size_t size) noexcept {
+  if (!ptr || size == 0) {
+    return;
+  }
+  // A buffer from before a reset or a restored checkpoint overlaps memory
+  // that may have been handed out again; linking or rewinding it corrupts
+  assert(isLive(ptr, size) && "buffer returned after its arena was rewound");
+
+  totalUsed -= std::min(size, totalUsed);
+
+  if (isTopAllocation(ptr, size)) {
+    currentBlock->used -= size;
+    return;
+  }
+
+  // Too small to hold the list link, or larger than any class: abandoned
+  if (size < (size_t{1} << MIN_SIZE_CLASS_SHIFT) ||
+      reinterpret_cast<uintptr_t>(ptr) % alignof(FreeBuffer) != 0) {
+    return;
+  }
+  const size_t sizeClass = sizeClassFloor(size, MIN_SIZE_CLASS_SHIFT);
+  if (sizeClass >= SIZE_CLASS_COUNT) {
+    return;
+  }
+
+  auto *buffer = static_cast<FreeBuffer *>(ptr);
+  buffer->next = freeBuffers[sizeClass];
+  buffer->size = size;
+  freeBuffers[sizeClass] = buffer;
+  recyclableBytes += size;
+}
+
+bool ArenaAllocator::tryExtend(void *ptr, size_t oldSize,
+                               size_t newSize) noexcept {
+  if (!ptr || newSize < oldSize || !isTopAllocation(ptr, oldSize)) {
+    return false;
+  }
+
+  const auto offset = static_cast<size_t>(static_cast<char *>(ptr) -
+                                          static_cast<char *>(
+                                              currentBlock->data));
+  if (offset + newSize > currentBlock->size) {
+    return false;
+  }
+
+  currentBlock->used = offset + newSize;
+  totalUsed += newSize - oldSize;
+  return true;
+}
+
+void *ArenaAllocator::reallocate(void *ptr, size_t oldSize, size_t newSize,
+                                 size_t alignment) {
+  if (!ptr || oldSize == 0) {
+    return allocateRecycled(newSize, alignment);
+  }
+  if (newSize == 0) {
+    deallocate(ptr, oldSize);
+    return nullptr;
+  }
+
+  if (newSize <= oldSize) {
+    // Shrinking the top allocation hands the tail back to the block
+    if (isTopAllocation(ptr, oldSize)) {
+      currentBlock->used -= oldSize - newSize;
+    }
+    totalUsed -= oldSize - newSize;
+    return ptr;
+  }
+
+  if (tryExtend(ptr, oldSize, newSize)) {
+    return ptr;
+  }
+
+  void *newPtr = allocateRecycled(newSize, alignment);
+  std::memcpy(newPtr, ptr, oldSize);
+  deallocate(ptr, oldSize);
+  return newPtr;
+}
+
 void ArenaAllocator::reset() noexcept {
-  for (auto *block = firstBlock; block; block = block->next) {
-    block->reset();
+  runFinalizers();
+  dropFreeBuffers();
+  // Later blocks are reset by allocate() as it moves into them
+  if (firstBlock) {
+    firstBlock->reset();
   }
   currentBlock = firstBlock;
   totalUsed = 0;
 }
 
 void ArenaAllocator::clear() noexcept {
+  runFinalizers();
+  dropFreeBuffers();
   freeAllBlocks();
   firstBlock = nullptr;
+  lastBlock = nullptr;
   currentBlock = nullptr;
+  nextBlockSize = options.initialBlockSize;
+  blockCount = 0;
   totalAllocated = 0;
   totalUsed = 0;
 }
@@ -170,30 +404,69 @@ size_t ArenaAllocator::getWastePercentage() const noexcept {
   return ((totalAllocated - totalUsed) * 100) / totalAllocated;
 }
 
-size_t ArenaAllocator::getBlockCount() const noexcept {
-  size_t count = 0;
-  for (auto *block = firstBlock; block; block = block->next) {
-    ++count;
+void ArenaAllocator::runFinalizers(Finalizer *until) noexcept {
+  // Records live in the arena, so read the link before running each one
+  while (finalizers && finalizers != until) {
+    auto *finalizer = finalizers;
+    finalizers = finalizer->next;
+    --finalizerCount;
+    finalizer->destroy(finalizer->object, finalizer->count);
+  }
+}
+
+void ArenaAllocator::dropFreeBuffers() noexcept {
+  freeBuffers.fill(nullptr);
+  recyclableBytes = 0;
+}
+
+bool ArenaAllocator::isTopAllocation(const void *ptr,
+                                     size_t size) const noexcept {
+  if (!currentBlock) {
+    return false;
   }
-  return count;
+  const auto *begin = static_cast<const char *>(currentBlock->data);
+  const auto *p = static_cast<const char *>(ptr);
+  return p >= begin && p + size == begin + currentBlock->used;
+}
+
+bool ArenaAllocator::isLive(const void *ptr, size_t size) const noexcept {
+  // Blocks up to currentBlock are in use, those after it are stale
+  const auto *p = static_cast<const char *>(ptr);
+  for (const MemoryBlock *block = firstBlock; block; block = block->next) {
+    const auto *begin = static_cast<const char *>(block->data);
+    if (p >= begin && p + size <= begin + block->used) {
+      return true;
+    }
+    if (block == currentBlock) {
+      break;
+    }
+  }
+  return false;
 }
 
 MemoryBlock *ArenaAllocator::allocateNewBlock(size_t minSize) {
-  auto newBlock = std::make_unique<MemoryBlock>(minSize);
-  totalAllocated += minSize;
+  // Oversized requests get a dedicated block and leave the growth curve alone
+  const bool regular = minSize <= nextBlockSize;
+  const size_t blockSize = regular ? nextBlockSize : minSize;
+
+  auto newBlock = std::make_unique<MemoryBlock>(
+      blockSize, blockSize >= options.mmapThreshold, options.hugePages,
+      options.prefault);
+  totalAllocated += newBlock->size;
+
+  if (regular) {
+    nextBlockSize = std::min(nextBlockSize * options.growthFactor,
+                             options.maxBlockSize);
+  }
 
   MemoryBlock *blockPtr = newBlock.release();
-
-  if (!firstBlock) {
-    firstBlock = blockPtr;
+  if (lastBlock) {
+    lastBlock->next = blockPtr;
   } else {
-    // Link to the end of the chain
-    auto *last = firstBlock;
-    while (last->next) {
-      last = last->next;
-    }
-    last->next = blockPtr;
+    firstBlock = blockPtr;
   }
+  lastBlock = blockPtr;
+  ++blockCount;
 
   return blockPtr;
 }
@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cxy/memory/concurrent_arena.hpp>
+#include <stdexcept>
+
+namespace cxy {
+
+namespace {
+
+std::atomic<uint64_t> nextArenaId{1};
+
+// Small per-thread history of arenas this thread allocated from, so a worker
+// alternating between a few arenas does not create a new cache on each switch
+constexpr size_t RECENT_SLOT_COUNT = 8;
+
+struct RecentSlots {
+  std::array<uint64_t, RECENT_SLOT_COUNT> ids{};
+  std::array<void *, RECENT_SLOT_COUNT> caches{};
+  size_t next = 0;
+};
+
+thread_local RecentSlots recentSlots;
+
+} // namespace
+
+ConcurrentArena::ConcurrentArena(size_t chunkSize, size_t blockSize)
+    : arenaId(nextArenaId.fetch_add(1, std::memory_order_relaxed)),
+      chunkSize(chunkSize), poolBlockSize(std::max(blockSize, chunkSize)),
+      firstPoolBlock(nullptr), lastPoolBlock(nullptr),
+      currentPoolBlock(nullptr), largeBlocks(nullptr), threadCaches(nullptr),
+      threadCacheCount(0), totalAllocated(0), largeUsed(0) {
+  if (chunkSize == 0) {
+    throw std::invalid_argument("Chunk size cannot be zero");
+  }
+}
+
+ConcurrentArena::~ConcurrentArena() {
+  freeBlocks(firstPoolBlock);
+  freeBlocks(largeBlocks);
+  freeThreadCaches();
+}
+
+ConcurrentArena::ThreadCache *ConcurrentArena::bindThreadCache() {
+  auto &recent = recentSlots;
+  for (size_t i = 0; i < RECENT_SLOT_COUNT; ++i) {
+    if (recent.ids[i] == arenaId) {
+      localSlot = {arenaId, static_cast<ThreadCache *>(recent.caches[i])};
+      return localSlot.cache;
+    }
+  }
+
+  // First allocation from this thread (or its slot was evicted)
+  auto *cache = new ThreadCache();
+  {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    cache->next = threadCaches;
+    threadCaches = cache;
+    ++threadCacheCount;
+  }
+
+  recent.ids[recent.next] = arenaId;
+  recent.caches[recent.next] = cache;
+  recent.next = (recent.next + 1) % RECENT_SLOT_COUNT;
+
+  localSlot = {arenaId, cache};
+  return cache;
+}
+
+void *ConcurrentArena::allocateSlow(ThreadCache &cache, size_t size,
+                                    size_t alignment) {
+  // Requests that would waste a large part of a chunk get their own block
+  if (size + alignment > chunkSize / 4) {
+    return allocateLarge(size, alignment);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    refillChunk(cache);
+  }
+
+  const auto cursor = reinterpret_cast<uintptr_t>(cache.cursor);
+  const auto aligned = (cursor + alignment - 1) & ~(alignment - 1);
+  assert(aligned + size <= reinterpret_cast<uintptr_t>(cache.limit));
+
+  cache.cursor = reinterpret_cast<char *>(aligned + size);
+  cache.used.store(cache.used.load(std::memory_order_relaxed) + size,
+                   std::memory_order_relaxed);
+  return reinterpret_cast<void *>(aligned);
+}
+
+void *ConcurrentArena::allocateLarge(size_t size, size_t alignment) {
+  auto *block = new MemoryBlock(size + alignment);
+
+  std::lock_guard<std::mutex> lock(poolMutex);
+  block->next = largeBlocks;
+  largeBlocks = block;
+  totalAllocated.fetch_add(block->size, std::memory_order_relaxed);
+  largeUsed.fetch_add(size, std::memory_order_relaxed);
+
+  void *ptr = block->allocate(size, alignment);
+  assert(ptr != nullptr); // Block was sized for this request
+  return ptr;
+}
+
+void ConcurrentArena::refillChunk(ThreadCache &cache) {
+  // Reuse blocks kept by reset() before growing the pool
+  while (currentPoolBlock && !currentPoolBlock->hasSpace(chunkSize)) {
+    currentPoolBlock = currentPoolBlock->next;
+  }
+
+  if (!currentPoolBlock) {
+    auto *block = new MemoryBlock(poolBlockSize);
+    totalAllocated.fetch_add(block->size, std::memory_order_relaxed);
+    if (lastPoolBlock) {
+      lastPoolBlock->next = block;
+    } else {
+      firstPoolBlock = block;
+    }
+    lastPoolBlock = block;
+    currentPoolBlock = block;
+  }
+
+  auto *chunk = static_cast<char *>(currentPoolBlock->allocate(chunkSize));
+  assert(chunk != nullptr); // Pool blocks are at least one chunk
+  cache.cursor = chunk;
+  cache.limit = chunk + chunkSize;
+}
+
+void ConcurrentArena::reset() noexcept {
+  std::lock_guard<std::mutex> lock(poolMutex);
+
+  for (auto *cache = threadCaches; cache; cache = cache->next) {
+    cache->cursor = nullptr;
+    cache->limit = nullptr;
+    cache->used.store(0, std::memory_order_relaxed);
+  }
+
+  for (auto *block = firstPoolBlock; block; block = block->next) {
+    block->reset();
+  }
+  currentPoolBlock = firstPoolBlock;
+
+  for (auto *block = largeBlocks; block; block = block->next) {
+    totalAllocated.fetch_sub(block->size, std::memory_order_relaxed);
+  }
+  freeBlocks(largeBlocks);
+  largeBlocks = nullptr;
+  largeUsed.store(0, std::memory_order_relaxed);
+}
+
+void ConcurrentArena::clear() noexcept {
+  std::lock_guard<std::mutex> lock(poolMutex);
+
+  freeBlocks(firstPoolBlock);
+  freeBlocks(largeBlocks);
+  freeThreadCaches();
+
+  // Threads still remember the old caches; a fresh id makes them rebind
+  arenaId = nextArenaId.fetch_add(1, std::memory_order_relaxed);
+  firstPoolBlock = nullptr;
+  lastPoolBlock = nullptr;
+  currentPoolBlock = nullptr;
+  largeBlocks = nullptr;
+  threadCaches = nullptr;
+  threadCacheCount = 0;
+  totalAllocated.store(0, std::memory_order_relaxed);
+  largeUsed.store(0, std::memory_order_relaxed);
+}
+
+size_t ConcurrentArena::getTotalUsed() const noexcept {
+  std::lock_guard<std::mutex> lock(poolMutex);
+
+  size_t total = largeUsed.load(std::memory_order_relaxed);
+  for (auto *cache = threadCaches; cache; cache = cache->next) {
+    total += cache->used.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+size_t ConcurrentArena::getWastePercentage() const noexcept {
+  const size_t allocated = getTotalAllocated();
+  if (allocated == 0)
+    return 0;
+  const size_t used = std::min(getTotalUsed(), allocated);
+  return ((allocated - used) * 100) / allocated;
+}
+
+size_t ConcurrentArena::getBlockCount() const noexcept {
+  std::lock_guard<std::mutex> lock(poolMutex);
+
+  size_t count = 0;
+  for (auto *block = firstPoolBlock; block; block = block->next) {
+    ++count;
+  }
+  for (auto *block = largeBlocks; block; block = block->next) {
+    ++count;
+  }
+  return count;
+}
+
+size_t ConcurrentArena::getThreadCacheCount() const noexcept {
+  std::lock_guard<std::mutex> lock(poolMutex);
+  return threadCacheCount;
+}
+
+void ConcurrentArena::freeBlocks(MemoryBlock *block) noexcept {
+  while (block) {
+    auto *next = block->next;
+    delete block;
+    block = next;
+  }
+}
+
+void ConcurrentArena::freeThreadCaches() noexcept {
+  auto *cache = threadCaches;
+  while (cache) {
+    auto *next = cache->next;
+    delete cache;
+    cache = next;
+  }
+}
+
+} // namespace cxy
@@ -1,52 +1,53 @@
-#include <algorithm>
+#include <cassert>
 #include <cxy/memory/arena.hpp>
 
 namespace cxy {
 
+namespace {
+
+constexpr size_t SCRATCH_BLOCK_SIZE = 64 * 1024;
+
+// Two stacks per thread so a scope can avoid the one its caller is using
+StackArena &threadScratchStack(size_t index) {
+  thread_local StackArena stacks[2]{StackArena(SCRATCH_BLOCK_SIZE),
+                                    StackArena(SCRATCH_BLOCK_SIZE)};
+  return stacks[index];
+}
+
+} // namespace
+
 StackArena::StackArena(size_t blockSize) : ArenaAllocator(blockSize) {
   // Reserve some space for checkpoints to avoid allocations
   checkpoints.reserve(32);
 }
 
 StackArena::Checkpoint StackArena::saveCheckpoint() noexcept {
-  Checkpoint cp{currentBlock, currentBlock ? currentBlock->used : 0};
+  Checkpoint cp{currentBlock, currentBlock ? currentBlock->used : 0,
+                totalUsed, finalizers, checkpoints.size()};
   checkpoints.push_back(cp);
   return cp;
 }
 
 void StackArena::restoreCheckpoint(const Checkpoint &checkpoint) noexcept {
-  // Restore memory state to the checkpoint
+  // Objects constructed since the checkpoint are about to be overwritten
+  runFinalizers(checkpoint.finalizers);
+  dropFreeBuffers();
+
   if (checkpoint.block) {
-    // Reset all blocks after the checkpoint block
-    auto *block = checkpoint.block->next;
-    while (block) {
-      block->reset();
-      block = block->next;
-    }
-
-    // Set current block and used amount
+    // Blocks past the current one are reset lazily when allocate() reaches
+    // them, so rewinding never walks the block list
     currentBlock = checkpoint.block;
     currentBlock->used = checkpoint.offset;
-
-    // Recalculate total used
-    totalUsed = 0;
-    for (auto *b = firstBlock; b; b = b->next) {
-      if (b == currentBlock) {
-        totalUsed += checkpoint.offset;
-        break;
-      } else {
-        totalUsed += b->used;
-      }
-    }
+    totalUsed = checkpoint.totalUsed;
   } else {
     // Checkpoint was at the beginning, reset everything
     reset();
   }
 
-  // Remove checkpoints that are after this one
-  auto it = std::find(checkpoints.begin(), checkpoints.end(), checkpoint);
-  if (it != checkpoints.end()) {
-    checkpoints.erase(it + 1, checkpoints.end());
+  // Drop checkpoints saved after this one
+  if (checkpoint.depth < checkpoints.size() &&
+      checkpoints[checkpoint.depth] == checkpoint) {
+    checkpoints.resize(checkpoint.depth + 1);
   }
 }
 
@@ -58,4 +59,17 @@ void StackArena::popCheckpoint() noexcept {
   }
 }
 
+ScratchArena::ScratchArena(const ArenaAllocator *conflict)
+    : stack(&threadScratchStack(0)) {
+  if (stack == conflict) {
+    stack = &threadScratchStack(1);
+  }
+  [[maybe_unused]] auto checkpoint = stack->saveCheckpoint();
+}
+
+ScratchArena::~ScratchArena() {
+  // Scopes close in reverse order, so ours is the newest checkpoint
+  stack->popCheckpoint();
+}
+
 } // namespace cxy
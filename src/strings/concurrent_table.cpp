@@ -0,0 +1,241 @@
+#include <bit>
+#include <cstring>
+#include <cxy/strings.hpp>
+#include <cxy/strings/concurrent_table.hpp>
+#include <stdexcept>
+
+namespace cxy {
+
+struct ConcurrentStringTable::Entry {
+  InternedString string;
+  uint32_t id;
+};
+
+namespace {
+
+// Segment and index of an id in the directory
+struct SegmentIndex {
+  size_t segment;
+  size_t index;
+};
+
+template <size_t FirstSegmentBits>
+constexpr SegmentIndex locateId(uint32_t id) noexcept {
+  const uint64_t position = uint64_t{id} + (uint64_t{1} << FirstSegmentBits);
+  const size_t segment = std::bit_width(position) - 1 - FirstSegmentBits;
+  return {segment, static_cast<size_t>(
+                       position - (uint64_t{1} << (segment + FirstSegmentBits)))};
+}
+
+} // namespace
+
+ConcurrentStringTable::Table::Table(size_t capacity)
+    : capacity(capacity),
+      slots(std::make_unique<std::atomic<const Entry *>[]>(capacity)) {}
+
+ConcurrentStringTable::ConcurrentStringTable() {
+  for (auto &shard : shards) {
+    auto table = std::make_unique<Table>(INITIAL_SHARD_CAPACITY);
+    shard.table.store(table.get(), std::memory_order_release);
+    shard.tables.push_back(std::move(table));
+  }
+}
+
+// Entries are trivially destructible and live in `strings`
+ConcurrentStringTable::~ConcurrentStringTable() = default;
+
+void ConcurrentStringTable::seed(std::span<const InternedString> prebuilt) {
+  for (const InternedString &string : prebuilt) {
+    Shard &shard = shardFor(string.getHash());
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    (void)insertLocked(shard, string.view(), string.getHash(), string.c_str());
+  }
+}
+
+InternedString ConcurrentStringTable::intern(std::string_view str,
+                                             size_t hash) {
+  return internEntry(str, hash).string;
+}
+
+uint32_t ConcurrentStringTable::internId(std::string_view str, size_t hash) {
+  return internEntry(str, hash).id;
+}
+
+uint32_t ConcurrentStringTable::findId(std::string_view str,
+                                       size_t hash) const noexcept {
+  const Table *table = shardFor(hash).table.load(std::memory_order_acquire);
+  const auto *entry = find(*table, str, hash);
+  return entry ? entry->id : 0;
+}
+
+InternedString ConcurrentStringTable::getString(uint32_t id) const noexcept {
+  const auto [segment, index] = locateId<FIRST_SEGMENT_BITS>(id);
+  // The caller got `id` from an entry, which was published after its
+  // directory slot, so both loads see it
+  const auto *slots = segments[segment].load(std::memory_order_acquire);
+  return slots[index].load(std::memory_order_acquire)->string;
+}
+
+const InternedString &
+ConcurrentStringTable::stringOf(const Entry &entry) noexcept {
+  return entry.string;
+}
+
+const ConcurrentStringTable::Entry &
+ConcurrentStringTable::internEntry(std::string_view str, size_t hash) {
+  Shard &shard = shardFor(hash);
+
+  // Wait-free path: the string is already there
+  const Table *table = shard.table.load(std::memory_order_acquire);
+  if (const auto *entry = find(*table, str, hash)) {
+    return *entry;
+  }
+
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  return *insertLocked(shard, str, hash);
+}
+
+const ConcurrentStringTable::Entry *
+ConcurrentStringTable::find(const Table &table, std::string_view str,
+                            size_t hash) noexcept {
+  const size_t mask = table.capacity - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    const auto *entry = table.slots[i].load(std::memory_order_acquire);
+    if (!entry) {
+      return nullptr;
+    }
+    const InternedString &string = entry->string;
+    if (string.getHash() == hash && string.size() == str.size() &&
+        std::memcmp(string.c_str(), str.data(), str.size()) == 0) {
+      return entry;
+    }
+  }
+}
+
+const ConcurrentStringTable::Entry *
+ConcurrentStringTable::insertLocked(Shard &shard, std::string_view str,
+                                    size_t hash, const char *stored) {
+  // Another thread may have inserted it, or grown the table, since we looked
+  if (const auto *entry =
+          find(*shard.table.load(std::memory_order_relaxed), str, hash)) {
+    return entry;
+  }
+
+  if ((shard.count.load(std::memory_order_relaxed) + 1) * 2 >
+      shard.table.load(std::memory_order_relaxed)->capacity) {
+    growLocked(shard);
+  }
+
+  // `stored` is null-terminated data that outlives the table
+  const char *data = stored;
+  if (!data) {
+    char *copy = strings.allocateArray<char>(str.size() + 1);
+    std::memcpy(copy, str.data(), str.size());
+    copy[str.size()] = '\0';
+    data = copy;
+  }
+  const uint32_t id = nextId.fetch_add(1, std::memory_order_relaxed);
+  if (id == 0) {
+    throw std::length_error("ConcurrentStringTable symbol ids exhausted");
+  }
+  auto *entry = new (strings.allocate<Entry>())
+      Entry{InternedString(data, str.size(), hash), id};
+  publishId(*entry);
+
+  Table *table = shard.table.load(std::memory_order_relaxed);
+  const size_t mask = table->capacity - 1;
+  size_t i = hash & mask;
+  while (table->slots[i].load(std::memory_order_relaxed)) {
+    i = (i + 1) & mask;
+  }
+  // Release publishes the entry's contents to lock-free readers
+  table->slots[i].store(entry, std::memory_order_release);
+  shard.count.fetch_add(1, std::memory_order_relaxed);
+  return entry;
+}
+
+void ConcurrentStringTable::growLocked(Shard &shard) {
+  const Table *old = shard.table.load(std::memory_order_relaxed);
+  auto grown = std::make_unique<Table>(old->capacity * 2);
+
+  const size_t mask = grown->capacity - 1;
+  for (size_t i = 0; i < old->capacity; ++i) {
+    const auto *entry = old->slots[i].load(std::memory_order_relaxed);
+    if (!entry) {
+      continue;
+    }
+    size_t slot = entry->string.getHash() & mask;
+    while (grown->slots[slot].load(std::memory_order_relaxed)) {
+      slot = (slot + 1) & mask;
+    }
+    grown->slots[slot].store(entry, std::memory_order_relaxed);
+  }
+
+  // Readers still probing the old table find everything that was in it, and
+  // anything newer is found again under the lock
+  shard.table.store(grown.get(), std::memory_order_release);
+  shard.tables.push_back(std::move(grown));
+}
+
+void ConcurrentStringTable::publishId(const Entry &entry) {
+  const auto [segment, index] = locateId<FIRST_SEGMENT_BITS>(entry.id);
+  auto *slots = segments[segment].load(std::memory_order_acquire);
+  if (!slots) {
+    // Inserts on other shards may race to create the segment; the loser's
+    // allocation is simply left in the arena
+    const size_t size = size_t{1} << (segment + FIRST_SEGMENT_BITS);
+    auto *fresh = strings.allocateArray<std::atomic<const Entry *>>(size);
+    for (size_t i = 0; i < size; ++i) {
+      new (fresh + i) std::atomic<const Entry *>(nullptr);
+    }
+    if (segments[segment].compare_exchange_strong(slots, fresh,
+                                                  std::memory_order_acq_rel)) {
+      slots = fresh;
+    }
+  }
+  slots[index].store(&entry, std::memory_order_release);
+}
+
+size_t ConcurrentStringTable::getStringCount() const noexcept {
+  size_t total = 0;
+  for (const auto &shard : shards) {
+    total += shard.count.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+size_t ConcurrentStringTable::getBucketCount() const noexcept {
+  size_t total = 0;
+  for (const auto &shard : shards) {
+    total += shard.table.load(std::memory_order_acquire)->capacity;
+  }
+  return total;
+}
+
+std::vector<size_t> ConcurrentStringTable::getProbeLengthHistogram() const {
+  std::vector<size_t> histogram;
+  for (const auto &shard : shards) {
+    const Table *table = shard.table.load(std::memory_order_acquire);
+    const size_t mask = table->capacity - 1;
+    for (size_t i = 0; i < table->capacity; ++i) {
+      const auto *entry = table->slots[i].load(std::memory_order_acquire);
+      if (!entry) {
+        continue;
+      }
+      const size_t length = ((i - entry->string.getHash()) & mask) + 1;
+      if (histogram.size() <= length) {
+        histogram.resize(length + 1);
+      }
+      ++histogram[length];
+    }
+  }
+  return histogram;
+}
+
+size_t ConcurrentStringTable::getTotalMemoryUsed() const noexcept {
+  size_t total = 0;
+  forEach([&](const InternedString &string) { total += string.size() + 1; });
+  return total;
+}
+
+} // namespace cxy
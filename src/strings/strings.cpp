@@ -1,6 +1,18 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
 #include <cxy/strings.hpp>
 #include <cxy/token.hpp>
 #include <iostream>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                   \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CXY_STRINGS_HAVE_SSE2 1
+#endif
 
 namespace cxy {
 
@@ -11,43 +23,181 @@ namespace cxy {
 } // namespace cxy
 
 namespace cxy {
-InternedString StringInterner::intern(std::string_view str) {
+
+namespace {
+
+// Bitmask of the control bytes in a group equal to `control`. Bit i is set
+// when byte i matches.
+#ifdef CXY_STRINGS_HAVE_SSE2
+uint32_t matchGroup(const int8_t *group, int8_t control) noexcept {
+  const __m128i bytes =
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(group));
+  return static_cast<uint32_t>(
+      _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(control))));
+}
+#else
+uint32_t matchGroup(const int8_t *group, int8_t control) noexcept {
+  uint32_t mask = 0;
+  for (uint32_t i = 0; i < 16; ++i) {
+    mask |= static_cast<uint32_t>(group[i] == control) << i;
+  }
+  return mask;
+}
+#endif
+
+} // namespace
+
+InternedString StringInterner::intern(std::string_view str, size_t hash) {
   if (str.empty()) {
     static const InternedString emptyString; // Default constructed empty string
     return emptyString;
   }
 
-  // Check if already exists
-  auto it = internedStrings.find(str);
-  if (it != internedStrings.end()) {
-    return it->second;
+  assert(hash == hashString(str) && "precomputed hash does not match");
+  // The hash is computed once and reused for the insert
+  if (concurrentTable) {
+    return concurrentTable->intern(str, hash);
+  }
+
+  const auto result = probe(str, hash);
+  if (result.found) {
+    return symbols[slots[result.slot]];
   }
 
-  // Need to intern new string
-  return internNewString(str);
+  return symbols[internNewString(str, hash)];
 }
 
-InternedString StringInterner::internNewString(std::string_view str) {
+SymbolId StringInterner::internSymbol(std::string_view str, size_t hash) {
+  if (str.empty()) {
+    return SymbolId();
+  }
+
+  assert(hash == hashString(str) && "precomputed hash does not match");
+  if (concurrentTable) {
+    return SymbolId(concurrentTable->internId(str, hash));
+  }
+
+  const auto result = probe(str, hash);
+  return SymbolId(result.found ? slots[result.slot]
+                               : internNewString(str, hash));
+}
+
+SymbolId StringInterner::getSymbolId(InternedString str) const noexcept {
+  if (str.empty()) {
+    return SymbolId();
+  }
+  if (concurrentTable) {
+    return SymbolId(concurrentTable->findId(str.view(), str.getHash()));
+  }
+
+  const auto result = probe(str.view(), str.getHash());
+  assert(result.found && "string was not interned by this interner");
+  return result.found ? SymbolId(slots[result.slot]) : SymbolId();
+}
+
+StringInterner::ProbeResult
+StringInterner::probe(std::string_view str, size_t hash) const noexcept {
+  const int8_t control = hashControl(hash);
+  const size_t groupMask = capacity / GROUP_SIZE - 1;
+  size_t group = (hash >> 7) & groupMask;
+
+  // Triangular steps visit every group of a power-of-two table
+  for (size_t step = 1;; ++step) {
+    const int8_t *groupControls = controls.get() + group * GROUP_SIZE;
+
+    for (uint32_t mask = matchGroup(groupControls, control); mask;
+         mask &= mask - 1) {
+      const size_t slot = group * GROUP_SIZE + std::countr_zero(mask);
+      const auto &entry = symbols[slots[slot]];
+      if (entry.getHash() == hash && entry.size() == str.size() &&
+          std::memcmp(entry.c_str(), str.data(), str.size()) == 0) {
+        return {slot, step, true};
+      }
+    }
+
+    // Nothing is ever erased, so an empty byte ends the probe sequence
+    if (const uint32_t empty = matchGroup(groupControls, EMPTY_CONTROL)) {
+      return {group * GROUP_SIZE + std::countr_zero(empty), step, false};
+    }
+
+    group = (group + step) & groupMask;
+  }
+}
+
+uint32_t StringInterner::internNewString(std::string_view str, size_t hash) {
+  if (symbols.size() > std::numeric_limits<uint32_t>::max()) {
+    throw std::length_error("StringInterner symbol ids exhausted");
+  }
+
   // Allocate string data in arena
   char *arenaStr = arena.allocateArray<char>(str.length() + 1);
   std::memcpy(arenaStr, str.data(), str.length());
   arenaStr[str.length()] = '\0';
 
-  // Create InternedString
-  const size_t hash = std::hash<std::string_view>{}(str);
-  InternedString result(arenaStr, str.length(), hash);
+  if (count + 1 > growthLimit) {
+    rehash(capacity * 2);
+  }
+
+  const auto id = static_cast<uint32_t>(symbols.size());
+  symbols.push_back(InternedString(arenaStr, str.length(), hash));
+
+  const auto target = probe(str, hash);
+  controls[target.slot] = hashControl(hash);
+  slots[target.slot] = id;
+  ++count;
+
+  return id;
+}
+
+void StringInterner::rehash(size_t newCapacity) {
+  auto oldControls = std::move(controls);
+  auto oldSlots = std::move(slots);
+  const size_t oldCapacity = capacity;
+
+  controls = std::make_unique_for_overwrite<int8_t[]>(newCapacity);
+  slots = std::make_unique_for_overwrite<uint32_t[]>(newCapacity);
+  std::memset(controls.get(), EMPTY_CONTROL, newCapacity);
+  capacity = newCapacity;
+  growthLimit = newCapacity / 8 * 7;
 
-  // Store in map using string_view of arena-allocated data
-  std::string_view arenaView(arenaStr, str.length());
-  internedStrings[arenaView] = result;
+  for (size_t i = 0; i < oldCapacity; ++i) {
+    if (oldControls[i] != EMPTY_CONTROL) {
+      const auto &entry = symbols[oldSlots[i]];
+      const auto target = probe(entry.view(), entry.getHash());
+      controls[target.slot] = oldControls[i];
+      slots[target.slot] = oldSlots[i];
+    }
+  }
+}
 
-  return result;
+std::vector<size_t> StringInterner::getProbeLengthHistogram() const {
+  if (concurrentTable) {
+    return concurrentTable->getProbeLengthHistogram();
+  }
+
+  std::vector<size_t> histogram;
+  for (size_t i = 0; i < capacity; ++i) {
+    if (controls[i] == EMPTY_CONTROL) {
+      continue;
+    }
+    const auto &entry = symbols[slots[i]];
+    const size_t length = probe(entry.view(), entry.getHash()).groupsProbed;
+    if (histogram.size() <= length) {
+      histogram.resize(length + 1);
+    }
+    ++histogram[length];
+  }
+  return histogram;
 }
 
 size_t StringInterner::getTotalMemoryUsed() const noexcept {
+  if (concurrentTable) {
+    return concurrentTable->getTotalMemoryUsed();
+  }
+
   size_t total = 0;
-  for (const auto &[key, value] : internedStrings) {
-    total += value.size() + 1; // +1 for null terminator
+  for (size_t id = 1; id < symbols.size(); ++id) {
+    total += symbols[id].size() + 1; // +1 for null terminator
   }
   return total;
 }
@@ -58,52 +208,177 @@ void StringInterner::printStatistics() const {
   std::cout << "  Bucket count: " << getBucketCount() << "\n";
   std::cout << "  Load factor: " << getLoadFactor() << "\n";
   std::cout << "  Total memory used: " << getTotalMemoryUsed() << " bytes\n";
+
+  const auto histogram = getProbeLengthHistogram();
+  if (concurrentTable) {
+    std::cout << "  Probe lengths (slots, " << getStringCount()
+              << " strings over sharded tables):\n";
+  } else {
+    std::cout << "  Probe lengths (groups of " << GROUP_SIZE << "):\n";
+  }
+  for (size_t length = 1; length < histogram.size(); ++length) {
+    if (histogram[length] == 0) {
+      continue;
+    }
+    std::cout << "    " << length << ": " << histogram[length] << " ("
+              << (histogram[length] * 100 / std::max<size_t>(getStringCount(), 1))
+              << "%)\n";
+  }
 }
 
 void StringInterner::printAllStrings() const {
   std::cout << "All interned strings:\n";
   size_t index = 0;
-  for (const auto &[key, value] : internedStrings) {
-    std::cout << "  [" << index << "] \"" << value.c_str()
+  if (concurrentTable) {
+    concurrentTable->forEach([&](const InternedString &value) {
+      std::cout << "  [" << index++ << "] \"" << value.c_str()
+                << "\" (hash: " << value.getHash() << ")\n";
+    });
+    return;
+  }
+
+  // Symbol ids are dense, so print in interning order
+  for (size_t id = 1; id < symbols.size(); ++id) {
+    const auto &value = symbols[id];
+    std::cout << "  [" << id << "] \"" << value.c_str()
               << "\" (hash: " << value.getHash() << ")\n";
-    ++index;
   }
 }
 
-void StringInterner::internCommonStrings() {
-  // Pre-intern all keywords from KEYWORD_LIST for performance
-  #define INTERN_KEYWORD(name, str) (void)intern(str);
-  KEYWORD_LIST(INTERN_KEYWORD)
-  #undef INTERN_KEYWORD
-  
-  // Pre-intern builtin names
-  #define INTERN_BUILTIN(name) (void)intern(#name);
-  #define INTERN_BUILTIN_STR(name, str) (void)intern(str);
-  CXY_BUILTIN_NAMES(INTERN_BUILTIN, INTERN_BUILTIN_STR)
-  #undef INTERN_BUILTIN
-  #undef INTERN_BUILTIN_STR
-  
-  // Pre-intern other common strings
-  (void)intern("");  // Empty string
+namespace {
+
+// Spellings of every builtin, keywords first. A few builtin names are also
+// keywords; only their first occurrence gets an entry.
+constexpr std::string_view BUILTIN_SPELLINGS[] = {
+#define KEYWORD_SPELLING(name, str) str,
+    KEYWORD_LIST(KEYWORD_SPELLING)
+#undef KEYWORD_SPELLING
+#define BUILTIN_SPELLING(name) #name,
+#define BUILTIN_SPELLING_STR(name, str) str,
+    CXY_BUILTIN_NAMES(BUILTIN_SPELLING, BUILTIN_SPELLING_STR)
+#undef BUILTIN_SPELLING
+#undef BUILTIN_SPELLING_STR
+};
+
+constexpr bool isFirstSpelling(size_t index) {
+  for (size_t i = 0; i < index; ++i) {
+    if (BUILTIN_SPELLINGS[i] == BUILTIN_SPELLINGS[index]) {
+      return false;
+    }
+  }
+  return true;
 }
 
-// Define static builtin name variables
+constexpr size_t BUILTIN_COUNT = [] {
+  size_t unique = 0;
+  for (size_t i = 0; i < std::size(BUILTIN_SPELLINGS); ++i) {
+    unique += isFirstSpelling(i);
+  }
+  return unique;
+}();
+
+} // namespace
+
+// Defined as a class so it can use InternedString's private constructor
+struct BuiltinTable {
+  static constexpr std::array<InternedString, BUILTIN_COUNT> build() {
+    std::array<InternedString, BUILTIN_COUNT> table{};
+    size_t next = 0;
+    for (size_t i = 0; i < std::size(BUILTIN_SPELLINGS); ++i) {
+      if (isFirstSpelling(i)) {
+        const std::string_view text = BUILTIN_SPELLINGS[i];
+        table[next++] =
+            InternedString(text.data(), text.size(), hashString(text));
+      }
+    }
+    return table;
+  }
+};
+
+namespace {
+
+constexpr std::array<InternedString, BUILTIN_COUNT> BUILTINS =
+    BuiltinTable::build();
+
+constexpr size_t builtinIndex(std::string_view text) {
+  for (size_t i = 0; i < BUILTINS.size(); ++i) {
+    if (BUILTINS[i].view() == text) {
+      return i;
+    }
+  }
+  return BUILTINS.size();
+}
+
+} // namespace
+
+std::span<const InternedString> BuiltinStrings::strings() noexcept {
+  return BUILTINS;
+}
+
+SymbolId BuiltinStrings::find(std::string_view str) noexcept {
+  const size_t index = builtinIndex(str);
+  return index < BUILTINS.size() ? SymbolId(static_cast<uint32_t>(index + 1))
+                                 : SymbolId();
+}
+
+// Image of the single-threaded index right after the builtins were inserted
+// into an empty INITIAL_CAPACITY table, built the same way probe() places
+// new strings
+struct StringInterner::SeedIndex {
+  std::array<int8_t, INITIAL_CAPACITY> controls;
+  std::array<uint32_t, INITIAL_CAPACITY> slots;
+};
+
+constinit const StringInterner::SeedIndex StringInterner::seedIndex = [] {
+  static_assert(BUILTIN_COUNT <= INITIAL_CAPACITY / 8 * 7,
+                "builtins must fit the initial interner table");
+  SeedIndex index{};
+  index.controls.fill(EMPTY_CONTROL);
+  const size_t groupMask = INITIAL_CAPACITY / GROUP_SIZE - 1;
+  for (size_t i = 0; i < BUILTINS.size(); ++i) {
+    const size_t hash = BUILTINS[i].getHash();
+    size_t group = (hash >> 7) & groupMask;
+    for (size_t step = 1;; ++step) {
+      size_t slot = group * GROUP_SIZE;
+      while (slot < (group + 1) * GROUP_SIZE &&
+             index.controls[slot] != EMPTY_CONTROL) {
+        ++slot;
+      }
+      if (slot < (group + 1) * GROUP_SIZE) {
+        index.controls[slot] = hashControl(hash);
+        index.slots[slot] = static_cast<uint32_t>(i + 1);
+        break;
+      }
+      group = (group + step) & groupMask;
+    }
+  }
+  return index;
+}();
+
+void StringInterner::seedBuiltins() {
+  if (concurrentTable) {
+    concurrentTable->seed(BUILTINS);
+    return;
+  }
+
+  // Only a freshly constructed interner is seeded
+  assert(count == 0 && capacity == INITIAL_CAPACITY);
+  std::memcpy(controls.get(), seedIndex.controls.data(), INITIAL_CAPACITY);
+  std::memcpy(slots.get(), seedIndex.slots.data(),
+              INITIAL_CAPACITY * sizeof(uint32_t));
+  symbols.insert(symbols.end(), BUILTINS.begin(), BUILTINS.end());
+  count = BUILTINS.size();
+}
+
+// Builtin names, constant initialized from the builtin table
 namespace S {
-  // Define all builtin names as static variables with S_ prefix
-  #define DEFINE_BUILTIN_NAME(name) const InternedString S_##name{};
-  #define DEFINE_BUILTIN_NAME_STR(name, str) const InternedString S_##name{};
+  #define DEFINE_BUILTIN_NAME(name)                                            \
+    constinit const InternedString S_##name = BUILTINS[builtinIndex(#name)];
+  #define DEFINE_BUILTIN_NAME_STR(name, str)                                   \
+    constinit const InternedString S_##name = BUILTINS[builtinIndex(str)];
   CXY_BUILTIN_NAMES(DEFINE_BUILTIN_NAME, DEFINE_BUILTIN_NAME_STR)
   #undef DEFINE_BUILTIN_NAME
   #undef DEFINE_BUILTIN_NAME_STR
-
-  void initializeBuiltinNames(StringInterner& interner) {
-    // Initialize all builtin names with interned values
-    #define INIT_BUILTIN_NAME(name) const_cast<InternedString&>(S_##name) = interner.intern(#name);
-    #define INIT_BUILTIN_NAME_STR(name, str) const_cast<InternedString&>(S_##name) = interner.intern(str);
-    CXY_BUILTIN_NAMES(INIT_BUILTIN_NAME, INIT_BUILTIN_NAME_STR)
-    #undef INIT_BUILTIN_NAME
-    #undef INIT_BUILTIN_NAME_STR
-  }
 }
 
 } // namespace cxy
@@ -199,8 +199,9 @@ const StructType* TypeRegistry::getStructType(const InternedString& name,
                                                ArenaVector<std::tuple<InternedString, const FunctionType*, const ast::ASTNode*>> methods,
                                                Flags flags, 
                                                const ast::ASTNode* sourceAST) {
-    // Use temporary arena for lookup to avoid polluting permanent arena
-    ArenaAllocator tempArena(1024);
+    // Use thread scratch memory for lookup to avoid polluting permanent arena
+    ScratchArena scratch;
+    ArenaAllocator &tempArena = scratch;
     
     // Convert pairs to FieldType vector using TEMPORARY arena
     ArenaVector<StructType::FieldType> lookupFields{ArenaSTLAllocator<StructType::FieldType>(tempArena)};
@@ -219,7 +220,7 @@ const StructType* TypeRegistry::getStructType(const InternedString& name,
     
     auto it = structTypes_.find(&lookup);
     if (it != structTypes_.end()) {
-        return *it;  // tempArena automatically freed when function exits
+        return *it;  // scratch memory is released when function exits
     }
     
     // Create permanent copy using PERMANENT arena
@@ -237,7 +238,7 @@ const StructType* TypeRegistry::getStructType(const InternedString& name,
     auto* type = new(arena_) StructType(name, std::move(permanentFields), std::move(permanentMethods), flags, sourceAST, arena_);
     structTypes_.insert(type);
     return type;
-    // tempArena destructor frees all temporary allocations
+    // scratch destructor rewinds all temporary allocations
 }
 
 const PointerType* TypeRegistry::getPointerType(const Type* pointeeType) {
@@ -295,8 +296,9 @@ const ClassType* TypeRegistry::getClassType(const InternedString& name,
                                              const ClassType* baseClass,
                                              Flags flags, 
                                              const ast::ASTNode* sourceAST) {
-    // Use temporary arena for lookup to avoid polluting permanent arena
-    ArenaAllocator tempArena(1024);
+    // Use thread scratch memory for lookup to avoid polluting permanent arena
+    ScratchArena scratch;
+    ArenaAllocator &tempArena = scratch;
     
     // Convert pairs to FieldType vector using TEMPORARY arena
     ArenaVector<ClassType::FieldType> lookupFields{ArenaSTLAllocator<ClassType::FieldType>(tempArena)};
@@ -317,7 +319,7 @@ const ClassType* TypeRegistry::getClassType(const InternedString& name,
     
     auto it = classTypes_.find(&lookup);
     if (it != classTypes_.end()) {
-        return *it;  // tempArena automatically freed when function exits
+        return *it;  // scratch memory is released when function exits
     }
     
     // Create permanent copy using PERMANENT arena
@@ -337,7 +339,7 @@ const ClassType* TypeRegistry::getClassType(const InternedString& name,
     auto* type = new(arena_) ClassType(name, std::move(permanentFields), std::move(permanentMethods), baseClass, flags, sourceAST, arena_);
     classTypes_.insert(type);
     return type;
-    // tempArena destructor frees all temporary allocations
+    // scratch destructor rewinds all temporary allocations
 }
 
 void TypeRegistry::clear() {
@@ -31,15 +31,16 @@ public:
     interner = std::make_unique<StringInterner>(arena);
   }
 
-  std::vector<Token> tokenize(const std::string &input,
-                              const std::string &filename = "test.cxy") {
+  std::vector<Token>
+  tokenize(const std::string &input, const std::string &filename = "test.cxy",
+           PositionMode positionMode = PositionMode::LineColumn) {
     // Clear any previous diagnostics
     diagnosticsPtr->clear();
 
     // Register the source content with SourceManager
     sourceManager->registerFile(filename, input);
 
-    Lexer lexer(filename, input, *logger, *interner);
+    Lexer lexer(filename, input, *logger, *interner, positionMode);
     std::vector<Token> tokens;
 
     Token token;
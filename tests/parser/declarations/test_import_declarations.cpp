@@ -465,14 +465,15 @@ TEST_CASE("Import Declaration Parsing - Integration Tests", "[parser][declaratio
 
     SECTION("mixed import types in sequence") {
         // This tests that the parser can handle multiple different import types
-        auto fixture = createParserFixture(R"(import "core.cxy")");
-        auto *stmt1 = fixture->parseDeclaration();
+        // Each fixture owns the arena its AST lives in, so keep all three alive
+        auto fixture1 = createParserFixture(R"(import "core.cxy")");
+        auto *stmt1 = fixture1->parseDeclaration();
 
-        fixture = createParserFixture(R"(import "utils.cxy" as Utils)");
-        auto *stmt2 = fixture->parseDeclaration();
+        auto fixture2 = createParserFixture(R"(import "utils.cxy" as Utils)");
+        auto *stmt2 = fixture2->parseDeclaration();
 
-        fixture = createParserFixture(R"(import { assert } from "test.cxy")");
-        auto *stmt3 = fixture->parseDeclaration();
+        auto fixture3 = createParserFixture(R"(import { assert } from "test.cxy")");
+        auto *stmt3 = fixture3->parseDeclaration();
 
         REQUIRE(stmt1 != nullptr);
         REQUIRE(stmt2 != nullptr);
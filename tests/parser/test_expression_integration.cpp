@@ -170,3 +170,63 @@ TEST_CASE("Expression Integration Tests",
                                 "(Bool true) (Bool false)))");
   }
 }
+
+TEST_CASE("Operators next to ranges, ternaries and casts",
+          "[parser][expressions][integration]") {
+
+  SECTION("Relational operators on both sides of a range") {
+    ParserTestFixture fixture("a < b..c < d");
+    auto result = fixture.parseExpression();
+
+    REQUIRE(result != nullptr);
+    REQUIRE_AST_MATCHES(result, "(BinaryExpr < (BinaryExpr < (Identifier a) "
+                                "(RangeExpr .. (Identifier b) (Identifier c))) "
+                                "(Identifier d))");
+  }
+
+  SECTION("Ranges do not chain") {
+    ParserTestFixture fixture("a..b..c");
+    auto result = fixture.parseExpression();
+
+    REQUIRE(result != nullptr);
+    REQUIRE_AST_MATCHES(result, "(RangeExpr .. (Identifier a) (Identifier b))");
+    CHECK(fixture.parser().currentKind() == TokenKind::DotDot);
+  }
+
+  SECTION("Open start range as a relational operand") {
+    ParserTestFixture fixture("..a < ..<b");
+    auto result = fixture.parseExpression();
+
+    REQUIRE(result != nullptr);
+    REQUIRE_AST_MATCHES(result, "(BinaryExpr < (RangeExpr .. (Identifier a)) "
+                                "(RangeExpr ..< (Identifier b)))");
+  }
+
+  SECTION("Open end range over a shift operand") {
+    ParserTestFixture fixture("a + b..");
+    auto result = fixture.parseExpression();
+
+    REQUIRE(result != nullptr);
+    REQUIRE_AST_MATCHES(result, "(RangeExpr .. (BinaryExpr + (Identifier a) "
+                                "(Identifier b)))");
+  }
+
+  SECTION("Assignment to a ternary") {
+    ParserTestFixture fixture("a ? b : c = d");
+    auto result = fixture.parseExpression();
+
+    REQUIRE(result != nullptr);
+    REQUIRE_AST_MATCHES(result, "(AssignmentExpr = (TernaryExpr (Identifier a) "
+                                "(Identifier b) (Identifier c)) "
+                                "(Identifier d))");
+  }
+
+  SECTION("Cast of a prefix expression as a factor") {
+    ParserTestFixture fixture("-a as i32 * b");
+    auto result = fixture.parseExpression();
+
+    REQUIRE(result != nullptr);
+    REQUIRE_AST_MATCHES(result, "(BinaryExpr * (CastExpr as (UnaryExpr - "
+                                "(Identifier a)) (Type i32)) (Identifier b))");
+  }
+}
@@ -0,0 +1,142 @@
+#include "../parser_test_utils.hpp"
+
+#include "catch2.hpp"
+
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace cxy;
+using namespace cxy::test;
+
+namespace {
+
+// Binding strength of an expression form, loosest first, mirroring the
+// grammar of the parse*Expression entry points
+enum Level {
+  Assignment,
+  Conditional,
+  LogicalOr,
+  LogicalAnd,
+  BitwiseOr,
+  BitwiseXor,
+  BitwiseAnd,
+  Equality,
+  Relational,
+  Shift,
+  Additive,
+  Multiplicative,
+  Cast,
+  Unary,
+  Primary
+};
+
+struct Operator {
+  const char *text;
+  Level level;
+};
+
+const std::vector<Operator> BINARY_OPERATORS = {
+    {"=", Assignment},      {"+=", Assignment},    {"<<=", Assignment},
+    {"||", LogicalOr},      {"&&", LogicalAnd},    {"|", BitwiseOr},
+    {"^", BitwiseXor},      {"&", BitwiseAnd},     {"==", Equality},
+    {"!=", Equality},       {"<", Relational},     {"<=", Relational},
+    {">", Relational},      {">=", Relational},    {"<<", Shift},
+    {">>", Shift},          {"+", Additive},       {"-", Additive},
+    {"*", Multiplicative},  {"/", Multiplicative}, {"%", Multiplicative}};
+
+// A random expression written twice: with every subexpression in
+// parentheses, and with only the parentheses the precedence table requires
+struct Generated {
+  std::string full;
+  std::string minimal;
+  Level level;
+};
+
+std::string wrap(const Generated &operand, bool parenthesize) {
+  return parenthesize ? "(" + operand.minimal + ")" : operand.minimal;
+}
+
+Generated generate(std::mt19937 &random, int depth) {
+  const unsigned form = depth > 5 ? 0 : random() % 8;
+  switch (form) {
+  case 0:
+  case 1: {
+    const std::string atom = random() % 3 == 0
+                                 ? std::to_string(random() % 100)
+                                 : std::string(1, char('a' + random() % 8));
+    return {atom, atom, Primary};
+  }
+  case 2: {
+    const char *prefix[] = {"!", "~", "-"};
+    const Generated operand = generate(random, depth + 1);
+    const std::string op = prefix[random() % 3];
+    return {op + "(" + operand.full + ")",
+            op + wrap(operand, operand.level < Unary ||
+                                   operand.minimal.front() == '-'),
+            Unary};
+  }
+  case 3: {
+    const Generated operand = generate(random, depth + 1);
+    return {"(" + operand.full + ") as i32",
+            wrap(operand, operand.level < Cast) + " as i32", Cast};
+  }
+  case 4: {
+    // ?: nests to the right: its condition binds tighter, its else branch
+    // at the same level, and its then branch is a whole expression
+    const Generated condition = generate(random, depth + 1);
+    const Generated then = generate(random, depth + 1);
+    const Generated otherwise = generate(random, depth + 1);
+    return {"(" + condition.full + ") ? (" + then.full + ") : (" +
+                otherwise.full + ")",
+            wrap(condition, condition.level <= Conditional) + " ? " +
+                then.minimal + " : " +
+                wrap(otherwise, otherwise.level < Conditional),
+            Conditional};
+  }
+  default: {
+    const Operator &op = BINARY_OPERATORS[random() % BINARY_OPERATORS.size()];
+    const Generated left = generate(random, depth + 1);
+    const Generated right = generate(random, depth + 1);
+    // Assignment nests to the right, every other level to the left. A type
+    // may be a union, so `x as i32 | y` casts to `i32 | y`.
+    const bool rightAssociative = op.level == Assignment;
+    const bool endsInCast = left.minimal.ends_with(" as i32");
+    return {"(" + left.full + ") " + op.text + " (" + right.full + ")",
+            wrap(left, rightAssociative ? left.level <= op.level
+                                        : left.level < op.level ||
+                                              (op.level == BitwiseOr &&
+                                               endsInCast)) +
+                " " + op.text + " " +
+                wrap(right, rightAssociative ? right.level < op.level
+                                             : right.level <= op.level),
+            op.level};
+  }
+  }
+}
+
+std::string parsedTree(const std::string &source) {
+  ParserTestFixture fixture(source);
+  auto *result = fixture.parseExpression();
+  REQUIRE(result != nullptr);
+  REQUIRE_FALSE(fixture.hasErrors());
+  REQUIRE(fixture.parser().currentKind() == TokenKind::EoF);
+  ast::PrinterConfig config;
+  config.flags = ast::PrinterFlags::None;
+  return ast::printAST(result, config);
+}
+
+} // namespace
+
+TEST_CASE("Operator precedence matches a fully parenthesized reference",
+          "[parser][expressions][precedence]") {
+  // Parentheses leave no node behind, so the tree parsed from the minimal
+  // form must equal the one from the form that spells out every grouping
+  std::mt19937 random(20240613);
+  for (int i = 0; i < 2000; ++i) {
+    const Generated expression = generate(random, 0);
+    INFO(expression.minimal);
+    INFO(expression.full);
+    REQUIRE(parsedTree(expression.minimal) == parsedTree(expression.full));
+  }
+}
@@ -1,4 +1,6 @@
 #include "../parser_test_utils.hpp"
+#include "cxy/ast/printer.hpp"
+#include "cxy/frontend/token_buffer.hpp"
 
 #include "catch2.hpp"
 
@@ -126,17 +128,17 @@ TEST_CASE("Parser: check() method", "[parser][buffer]") {
 TEST_CASE("Parser: checkAny() method", "[parser][buffer]") {
   auto fixture = createParserFixture("42");
 
-  std::vector<TokenKind> literals = {
+  constexpr TokenSet literals = {
       TokenKind::IntLiteral, TokenKind::FloatLiteral, TokenKind::StringLiteral};
 
-  std::vector<TokenKind> keywords = {TokenKind::True, TokenKind::False,
-                                     TokenKind::Null};
+  constexpr TokenSet keywords = {TokenKind::True, TokenKind::False,
+                                 TokenKind::Null};
 
   REQUIRE(fixture->parser().checkAny(literals));
   REQUIRE_FALSE(fixture->parser().checkAny(keywords));
 
-  // Empty vector should return false
-  std::vector<TokenKind> empty;
+  // Empty set should return false
+  TokenSet empty;
   REQUIRE_FALSE(fixture->parser().checkAny(empty));
 }
 
@@ -218,3 +220,164 @@ TEST_CASE("Parser: Buffer state after parsing error", "[parser][buffer]") {
   fixture->advance();
   REQUIRE(fixture->current().kind == TokenKind::Ident);
 }
+
+namespace {
+
+// Parses a compilation unit either streaming from the lexer or from a
+// pre-lexed TokenBuffer, and prints the AST with locations
+std::string parseAndPrint(const std::string &source, bool preLex) {
+  ArenaAllocator arena(1024 * 1024);
+  StringInterner interner(arena);
+  DiagnosticLogger logger;
+  logger.removeAllSinks();
+  SourceManager sourceManager;
+  sourceManager.registerFile("buffer.cxy", source);
+  TypeRegistry typeRegistry;
+  Lexer lexer("buffer.cxy", source, logger, interner);
+  Parser parser(lexer, arena, sourceManager, interner, logger, typeRegistry);
+
+  std::unique_ptr<TokenBuffer> tokens;
+  if (preLex) {
+    tokens = std::make_unique<TokenBuffer>(lexer);
+    parser.initialize(*tokens);
+  } else {
+    parser.initialize();
+  }
+
+  auto *unit = parser.parseCompilationUnit();
+  REQUIRE(unit != nullptr);
+  REQUIRE_FALSE(logger.hasErrors());
+  ast::PrinterConfig config;
+  config.flags = ast::PrinterFlags::IncludeLocation;
+  return ast::ASTPrinter(config).print(unit);
+}
+
+} // namespace
+
+TEST_CASE("Parser: Pre-lexed token stream", "[parser][buffer]") {
+  const std::string source = "a.b(c, 1 >> 2) 0x10 3.5 'q' \"s\"";
+  ArenaAllocator arena(1024 * 1024);
+  StringInterner interner(arena);
+  DiagnosticLogger logger;
+  logger.removeAllSinks();
+
+  Lexer streaming("buffer.cxy", source, logger, interner);
+  Lexer lexer("buffer.cxy", source, logger, interner);
+  const TokenBuffer tokens(lexer);
+
+  SECTION("Arrays hold the streamed tokens") {
+    size_t index = 0;
+    CompactToken expected;
+    do {
+      expected = streaming.nextCompactToken();
+      const CompactToken token = tokens[index];
+      REQUIRE(token.kind == expected.kind);
+      REQUIRE(tokens.kinds()[index] == expected.kind);
+      REQUIRE(tokens.offsets()[index] == expected.offset);
+      REQUIRE(tokens.values()[index] == expected.valueIndex);
+      REQUIRE(token.length == expected.length);
+      REQUIRE(token.flags == expected.flags);
+      REQUIRE(token.file == expected.file);
+      ++index;
+    } while (!expected.isEof());
+    REQUIRE(tokens.size() == index);
+  }
+
+  SECTION("Reads past the end give EoF") {
+    REQUIRE(tokens.kind(tokens.size() - 1) == TokenKind::EoF);
+    REQUIRE(tokens.kind(tokens.size() + 10) == TokenKind::EoF);
+    REQUIRE(tokens[tokens.size() + 10].isEof());
+  }
+
+  SECTION("Memory is accounted per token") {
+    REQUIRE(tokens.memoryUsage() ==
+            tokens.size() * TokenBuffer::BYTES_PER_TOKEN);
+    REQUIRE(lexer.expand(tokens[6]).getIntValue() == 1);
+    REQUIRE(lexer.expand(tokens[10]).getIntValue() == 0x10);
+  }
+}
+
+TEST_CASE("Parser: Unlimited lookahead from a token buffer",
+          "[parser][buffer]") {
+  const std::string source = "a b c d e f";
+  ArenaAllocator arena(1024 * 1024);
+  StringInterner interner(arena);
+  DiagnosticLogger logger;
+  logger.removeAllSinks();
+  SourceManager sourceManager;
+  TypeRegistry typeRegistry;
+  Lexer lexer("buffer.cxy", source, logger, interner);
+  Parser parser(lexer, arena, sourceManager, interner, logger, typeRegistry);
+  const TokenBuffer tokens(lexer);
+  parser.initialize(tokens);
+
+  REQUIRE(parser.current().value.stringValue.view() == "a");
+  REQUIRE(parser.lookahead(5).value.stringValue.view() == "f");
+  REQUIRE(parser.lookaheadKind(6) == TokenKind::EoF);
+  REQUIRE(parser.lookaheadKind(60) == TokenKind::EoF);
+  REQUIRE(parser.lookaheadKind(0) == TokenKind::Error);
+
+  parser.advance();
+  parser.advance();
+  REQUIRE(parser.current().value.stringValue.view() == "c");
+  REQUIRE(parser.lookahead(3).value.stringValue.view() == "f");
+  REQUIRE(parser.previous().value.stringValue.view() == "b");
+}
+
+TEST_CASE("Parser: Lookahead splits '>>' inside generic arguments",
+          "[parser][buffer]") {
+  const std::string source = "a >> b >>= c > d";
+  ArenaAllocator arena(1024 * 1024);
+  StringInterner interner(arena);
+  DiagnosticLogger logger;
+  logger.removeAllSinks();
+  SourceManager sourceManager;
+  TypeRegistry typeRegistry;
+  Lexer streaming("buffer.cxy", source, logger, interner);
+  Lexer lexer("buffer.cxy", source, logger, interner);
+  Parser parser(lexer, arena, sourceManager, interner, logger, typeRegistry);
+  const TokenBuffer tokens(lexer);
+  parser.initialize(tokens);
+
+  // Every lookahead must see the tokens the lexer itself would produce
+  // with generic arguments open, not the whole '>>' the stream holds
+  streaming.enterTemplateContext();
+  lexer.enterTemplateContext();
+  std::vector<CompactToken> expected;
+  do {
+    expected.push_back(streaming.nextCompactToken());
+  } while (!expected.back().isEof());
+
+  for (size_t start = 0; start + 1 < expected.size(); ++start) {
+    INFO("current token " << start);
+    REQUIRE(parser.currentKind() == expected[start].kind);
+    for (size_t offset = 1; start + offset < expected.size(); ++offset) {
+      const CompactToken &token = expected[start + offset];
+      const Token peeked = parser.lookahead(static_cast<int>(offset));
+      REQUIRE(peeked.kind == token.kind);
+      REQUIRE(peeked.location.start.byteOffset == token.offset);
+    }
+    parser.advance();
+  }
+  REQUIRE(parser.currentKind() == TokenKind::EoF);
+}
+
+TEST_CASE("Parser: Pre-lexed parse matches streaming parse",
+          "[parser][buffer]") {
+  const std::string source = GENERATE(
+      as<std::string>{},
+      "func main() {\n"
+      "    var v: Vec<Map<string, Vec<i32>>> = ::Vec<Vec<i32>>()\n"
+      "    var x = a >> 2\n"
+      "    x >>= 1\n"
+      "    return ::foo<i32>(x) + \"${x} items\"\n"
+      "}\n",
+      "struct Point { x i32; y i32 }\n"
+      "func dist(p Point) f64 => p.x * p.x + p.y * p.y\n",
+      "var t = (1, 'c', 2.5, [1, 2, 3], 0 .. 10)\n"
+      "func check(value auto) {\n"
+      "    match value { i32 as n => use(n >> 1) ... => skip() }\n"
+      "}\n");
+
+  REQUIRE(parseAndPrint(source, true) == parseAndPrint(source, false));
+}
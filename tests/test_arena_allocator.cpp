@@ -1,6 +1,8 @@
 #include "catch2.hpp"
+#include <algorithm>
 #include <cxy/memory.hpp>
 #include <string>
+#include <thread>
 #include <unordered_set>
 #include <vector>
 
@@ -72,6 +74,62 @@ TEST_CASE("Arena allocator basic functionality", "[arena]") {
     REQUIRE(arena.getTotalAllocated() == 0);
     REQUIRE(arena.getBlockCount() == 0);
   }
+
+  SECTION("Geometric block growth") {
+    ArenaAllocator arena(ArenaOptions{.initialBlockSize = 1024,
+                                      .maxBlockSize = 8 * 1024});
+
+    // 1KB, 2KB, 4KB, 8KB, then capped at 8KB
+    for (int i = 0; i < 40; ++i) {
+      (void)arena.allocate(512);
+    }
+    REQUIRE(arena.getBlockCount() < 10);
+    REQUIRE(arena.getTotalAllocated() >= 20 * 1024);
+
+    // Blocks kept by reset() are reused before new ones are allocated
+    const size_t blocks = arena.getBlockCount();
+    const size_t allocated = arena.getTotalAllocated();
+    arena.reset();
+    for (int i = 0; i < 40; ++i) {
+      (void)arena.allocate(512);
+    }
+    REQUIRE(arena.getBlockCount() == blocks);
+    REQUIRE(arena.getTotalAllocated() == allocated);
+
+    // Growth restarts after clear()
+    arena.clear();
+    (void)arena.allocate(16);
+    REQUIRE(arena.getTotalAllocated() == 1024);
+  }
+
+  SECTION("Fixed block size and oversized requests") {
+    ArenaAllocator arena(ArenaOptions{.initialBlockSize = 1024,
+                                      .growthFactor = 1});
+    (void)arena.allocate(512);
+    (void)arena.allocate(768);
+    REQUIRE(arena.getTotalAllocated() == 2048);
+
+    // An oversized request gets its own block and does not change growth
+    void *big = arena.allocate(10000);
+    REQUIRE(big != nullptr);
+    (void)arena.allocate(900);
+    REQUIRE(arena.getBlockCount() == 4);
+  }
+
+  SECTION("Mapped blocks with huge page and prefault hints") {
+    ArenaAllocator arena(ArenaOptions{.initialBlockSize = 256 * 1024,
+                                      .mmapThreshold = 128 * 1024,
+                                      .hugePages = true,
+                                      .prefault = true});
+
+    auto *bytes = static_cast<char *>(arena.allocate(200 * 1024));
+    REQUIRE(bytes != nullptr);
+    bytes[0] = 'a';
+    bytes[200 * 1024 - 1] = 'z';
+    REQUIRE(bytes[0] == 'a');
+    REQUIRE(bytes[200 * 1024 - 1] == 'z');
+    REQUIRE(arena.getTotalAllocated() >= 256 * 1024);
+  }
 }
 
 TEST_CASE("Stack arena checkpoint functionality", "[arena][stack]") {
@@ -124,6 +182,264 @@ TEST_CASE("Stack arena checkpoint functionality", "[arena][stack]") {
     REQUIRE(*ptr4 == 4);
     REQUIRE(*ptr1 == 1);
   }
+
+  SECTION("Nested checkpoints across blocks") {
+    StackArena arena(256);
+
+    [[maybe_unused]] void *base = arena.allocate(100);
+    auto outer = arena.saveCheckpoint();
+    const size_t usedAtOuter = arena.getTotalUsed();
+
+    [[maybe_unused]] void *spill = arena.allocate(400); // Second block
+    auto inner = arena.saveCheckpoint();
+    [[maybe_unused]] void *more = arena.allocate(600); // Third block
+    REQUIRE(arena.getBlockCount() == 3);
+    REQUIRE(arena.getCheckpointCount() == 2);
+
+    arena.restoreCheckpoint(inner);
+    REQUIRE(arena.getTotalUsed() == 500);
+    REQUIRE(arena.getCheckpointCount() == 2);
+
+    // Restoring the outer checkpoint drops the inner one
+    arena.restoreCheckpoint(outer);
+    REQUIRE(arena.getTotalUsed() == usedAtOuter);
+    REQUIRE(arena.getCheckpointCount() == 1);
+
+    // Kept blocks are reused rather than grown
+    [[maybe_unused]] void *again = arena.allocate(400);
+    [[maybe_unused]] void *andAgain = arena.allocate(600);
+    REQUIRE(arena.getBlockCount() == 3);
+    REQUIRE(arena.getTotalUsed() == usedAtOuter + 1000);
+  }
+}
+
+TEST_CASE("Scratch arenas", "[arena][scratch]") {
+  SECTION("Scopes rewind on exit and nest") {
+    size_t usedBefore = 0;
+    {
+      ScratchArena outer;
+      usedBefore = outer.get().getTotalUsed();
+      [[maybe_unused]] int *a = outer.get().construct<int>(1);
+
+      {
+        ScratchArena inner;
+        REQUIRE(&inner.get() == &outer.get());
+        auto vec = makeArenaVector<int>(inner);
+        vec.assign(100, 7);
+        REQUIRE(inner.get().getTotalUsed() > usedBefore + sizeof(int));
+      }
+
+      REQUIRE(outer.get().getTotalUsed() == usedBefore + sizeof(int));
+      REQUIRE(*a == 1);
+    }
+
+    ScratchArena after;
+    REQUIRE(after.get().getTotalUsed() == usedBefore);
+  }
+
+  SECTION("Conflicting scopes use the other stack") {
+    ScratchArena outer;
+    ScratchArena inner(&outer.get());
+    REQUIRE(&inner.get() != &outer.get());
+
+    // Allocating into the outer scratch while the inner one is open is safe
+    int *result = outer.get().construct<int>(42);
+    [[maybe_unused]] int *temp = inner.get().construct<int>(0);
+    REQUIRE(*result == 42);
+  }
+
+  SECTION("Each thread has its own stacks") {
+    const StackArena *mainStack = nullptr;
+    const StackArena *workerStack = nullptr;
+    {
+      ScratchArena scratch;
+      mainStack = &scratch.get();
+    }
+    std::thread worker([&] {
+      ScratchArena scratch;
+      workerStack = &scratch.get();
+    });
+    worker.join();
+    REQUIRE(mainStack != workerStack);
+  }
+}
+
+namespace {
+
+// Records its id in a shared log when destroyed
+struct Tracked {
+  std::vector<int> *log;
+  int id;
+  std::string payload; // Heap-backed member that would leak without a dtor
+
+  Tracked(std::vector<int> *log, int id)
+      : log(log), id(id), payload(64, 'x') {}
+  ~Tracked() { log->push_back(id); }
+};
+
+struct Promised {
+  using ArenaTriviallyDestructible = Promised;
+  int value;
+};
+
+// Inherits the marker but not the promise
+struct DerivedFromPromised : Promised {
+  std::string name;
+};
+
+} // namespace
+
+TEST_CASE("Arena finalizers", "[arena][finalizer]") {
+  std::vector<int> destroyed;
+
+  SECTION("Trivially destructible types register nothing") {
+    ArenaAllocator arena(1024);
+    [[maybe_unused]] int *value = arena.construct<int>(1);
+    [[maybe_unused]] int *values = arena.constructArray<int>(4, 2);
+    REQUIRE(arena.getFinalizerCount() == 0);
+  }
+
+  SECTION("Trivial destruction is promised per type") {
+    STATIC_REQUIRE(ArenaTrivialDestructionExpected<Promised>);
+    STATIC_REQUIRE_FALSE(ArenaTrivialDestructionExpected<DerivedFromPromised>);
+    STATIC_REQUIRE_FALSE(ArenaTrivialDestructionExpected<int>);
+    STATIC_REQUIRE(ArenaTriviallyDestructibleAsPromised<Promised>::value);
+    STATIC_REQUIRE(
+        ArenaTriviallyDestructibleAsPromised<DerivedFromPromised>::value);
+  }
+
+  SECTION("Reset destroys objects in reverse order") {
+    ArenaAllocator arena(1024);
+    for (int i = 1; i <= 3; ++i) {
+      [[maybe_unused]] auto *obj = arena.construct<Tracked>(&destroyed, i);
+    }
+    REQUIRE(arena.getFinalizerCount() == 3);
+
+    arena.reset();
+    REQUIRE(destroyed == std::vector<int>{3, 2, 1});
+    REQUIRE(arena.getFinalizerCount() == 0);
+
+    // Nothing is destroyed twice
+    arena.clear();
+    REQUIRE(destroyed.size() == 3);
+  }
+
+  SECTION("Arrays, clear and destruction") {
+    {
+      ArenaAllocator arena(1024);
+      [[maybe_unused]] auto *objs =
+          arena.constructArray<Tracked>(3, &destroyed, 7);
+      REQUIRE(arena.getFinalizerCount() == 1);
+      [[maybe_unused]] auto *obj = arena.construct<Tracked>(&destroyed, 8);
+
+      arena.clear();
+      REQUIRE(destroyed == std::vector<int>{8, 7, 7, 7});
+
+      [[maybe_unused]] auto *last = arena.construct<Tracked>(&destroyed, 9);
+    }
+    REQUIRE(destroyed.back() == 9);
+  }
+
+  SECTION("Checkpoint restore destroys only newer objects") {
+    StackArena arena(1024);
+    [[maybe_unused]] auto *kept = arena.construct<Tracked>(&destroyed, 1);
+
+    {
+      StackArena::ScopedCheckpoint cp(arena);
+      [[maybe_unused]] auto *a = arena.construct<Tracked>(&destroyed, 2);
+      [[maybe_unused]] auto *b = arena.construct<Tracked>(&destroyed, 3);
+    }
+    REQUIRE(destroyed == std::vector<int>{3, 2});
+    REQUIRE(arena.getFinalizerCount() == 1);
+
+    arena.reset();
+    REQUIRE(destroyed == std::vector<int>{3, 2, 1});
+  }
+}
+
+TEST_CASE("Concurrent arena functionality", "[arena][concurrent]") {
+  SECTION("Single thread allocation") {
+    ConcurrentArena arena(1024, 4096);
+
+    REQUIRE(arena.getTotalAllocated() == 0);
+    REQUIRE(arena.getBlockCount() == 0);
+
+    int *value = arena.construct<int>(42);
+    REQUIRE(*value == 42);
+    REQUIRE(arena.getThreadCacheCount() == 1);
+    REQUIRE(arena.getBlockCount() == 1);
+    REQUIRE(arena.getTotalUsed() == sizeof(int));
+
+    struct alignas(64) OverAligned {
+      char data[32];
+    };
+    auto *oa = arena.allocate<OverAligned>();
+    REQUIRE(reinterpret_cast<uintptr_t>(oa) % 64 == 0);
+
+    // Large requests bypass the thread chunk
+    void *large = arena.allocate(8192);
+    REQUIRE(large != nullptr);
+    REQUIRE(arena.getBlockCount() == 2);
+  }
+
+  SECTION("Allocations from many threads outlive the threads") {
+    ConcurrentArena arena(4096);
+    constexpr int threadCount = 8;
+    constexpr int perThread = 2000;
+
+    std::vector<std::vector<int *>> results(threadCount);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threadCount; ++t) {
+      workers.emplace_back([&arena, &results, t] {
+        for (int i = 0; i < perThread; ++i) {
+          results[t].push_back(arena.construct<int>(t * perThread + i));
+        }
+      });
+    }
+    for (auto &worker : workers) {
+      worker.join();
+    }
+
+    REQUIRE(arena.getThreadCacheCount() == threadCount);
+    REQUIRE(arena.getTotalUsed() == threadCount * perThread * sizeof(int));
+
+    std::unordered_set<int *> unique;
+    for (int t = 0; t < threadCount; ++t) {
+      for (int i = 0; i < perThread; ++i) {
+        REQUIRE(*results[t][i] == t * perThread + i);
+        unique.insert(results[t][i]);
+      }
+    }
+    REQUIRE(unique.size() == threadCount * perThread);
+  }
+
+  SECTION("Reset keeps pool blocks and clear releases them") {
+    ConcurrentArena arena(1024, 4096);
+    for (int i = 0; i < 100; ++i) {
+      (void)arena.allocate(64);
+    }
+    const size_t blocks = arena.getBlockCount();
+    REQUIRE(blocks >= 2);
+
+    arena.reset();
+    REQUIRE(arena.getTotalUsed() == 0);
+    REQUIRE(arena.getBlockCount() == blocks);
+
+    for (int i = 0; i < 100; ++i) {
+      (void)arena.allocate(64);
+    }
+    REQUIRE(arena.getBlockCount() == blocks);
+
+    arena.clear();
+    REQUIRE(arena.getTotalAllocated() == 0);
+    REQUIRE(arena.getBlockCount() == 0);
+    REQUIRE(arena.getThreadCacheCount() == 0);
+
+    // Threads rebind transparently after clear
+    int *value = arena.construct<int>(7);
+    REQUIRE(*value == 7);
+    REQUIRE(arena.getThreadCacheCount() == 1);
+  }
 }
 
 TEST_CASE("Arena STL containers", "[arena][stl]") {
@@ -166,6 +482,171 @@ TEST_CASE("Arena STL containers", "[arena][stl]") {
     REQUIRE(map2.size() == 3);
     REQUIRE(map2["a"] == 1);
   }
+
+  SECTION("Top allocation grows and shrinks in place") {
+    ArenaAllocator arena(1024);
+    ArenaSTLAllocator<int> alloc(arena);
+
+    int *buffer = alloc.allocate(4);
+    REQUIRE(alloc.tryExtend(buffer, 4, 16));
+    REQUIRE(arena.getTotalUsed() == 16 * sizeof(int));
+
+    // Anything allocated after it pins the buffer
+    [[maybe_unused]] int *other = arena.construct<int>(0);
+    REQUIRE_FALSE(alloc.tryExtend(buffer, 16, 32));
+
+    // Reallocation falls back to a copy and recycles the old buffer
+    for (int i = 0; i < 16; ++i) {
+      buffer[i] = i;
+    }
+    int *moved = alloc.reallocate(buffer, 16, 32);
+    REQUIRE(moved != buffer);
+    REQUIRE(moved[15] == 15);
+    REQUIRE(arena.getRecyclableBytes() == 16 * sizeof(int));
+
+    // Giving back the top allocation rolls the block back
+    const size_t used = arena.getTotalUsed();
+    alloc.deallocate(moved, 32);
+    REQUIRE(arena.getTotalUsed() == used - 32 * sizeof(int));
+    REQUIRE(alloc.allocate(32) == moved);
+  }
+
+  SECTION("Released container buffers are reused") {
+    ArenaAllocator arena(64 * 1024);
+
+    {
+      auto vec = makeArenaVector<int>(arena);
+      for (int i = 0; i < 1000; ++i) {
+        vec.push_back(i);
+      }
+      // Every abandoned growth buffer is either recycled or not counted
+      REQUIRE(arena.getTotalUsed() == vec.capacity() * sizeof(int));
+    }
+    REQUIRE(arena.getTotalUsed() == 0);
+
+    const size_t allocated = arena.getTotalAllocated();
+    for (int round = 0; round < 100; ++round) {
+      auto vec = makeArenaVector<int>(arena);
+      for (int i = 0; i < 1000; ++i) {
+        vec.push_back(i);
+      }
+    }
+    REQUIRE(arena.getTotalAllocated() == allocated);
+
+    arena.reset();
+    REQUIRE(arena.getRecyclableBytes() == 0);
+  }
+
+  SECTION("Buffers from before a reset or restore are no longer live") {
+    ArenaAllocator arena(256);
+    void *first = arena.allocate(64);
+    void *second = arena.allocate(400); // Second block
+    REQUIRE(arena.isLive(first, 64));
+    REQUIRE(arena.isLive(second, 400));
+    REQUIRE_FALSE(arena.isLive(first, 300));
+
+    // Given back but not rewound: still the arena's to recycle
+    arena.deallocate(first, 64);
+    REQUIRE(arena.isLive(first, 64));
+
+    // deallocate() asserts on these, since the memory may be reused
+    arena.reset();
+    REQUIRE_FALSE(arena.isLive(first, 64));
+    REQUIRE_FALSE(arena.isLive(second, 400));
+
+    StackArena stack(256);
+    auto checkpoint = stack.saveCheckpoint();
+    void *scoped = stack.allocate(400);
+    REQUIRE(stack.isLive(scoped, 400));
+    stack.restoreCheckpoint(checkpoint);
+    REQUIRE_FALSE(stack.isLive(scoped, 400));
+  }
+}
+
+TEST_CASE("Arena small vector", "[arena][small_vector]") {
+  SECTION("Inline storage needs no arena memory") {
+    ArenaAllocator arena(1024);
+    ArenaSmallVector<int, 3> vec(arena);
+
+    vec.push_back(1);
+    vec.push_back(2);
+    vec.push_back(3);
+    REQUIRE(vec.isInline());
+    REQUIRE(vec.size() == 3);
+    REQUIRE(arena.getTotalAllocated() == 0);
+    STATIC_REQUIRE(std::is_trivially_destructible_v<ArenaSmallVector<int, 3>>);
+  }
+
+  SECTION("Spilling keeps contents and grows in place") {
+    ArenaAllocator arena(1024);
+    ArenaSmallVector<int, 2> vec(arena);
+
+    for (int i = 0; i < 100; ++i) {
+      vec.push_back(i);
+    }
+    REQUIRE_FALSE(vec.isInline());
+    REQUIRE(vec.size() == 100);
+    REQUIRE(vec.front() == 0);
+    REQUIRE(vec.back() == 99);
+
+    // The only spilled buffer was the top allocation the whole time
+    REQUIRE(arena.getTotalUsed() == vec.capacity() * sizeof(int));
+    REQUIRE(arena.getRecyclableBytes() == 0);
+  }
+
+  SECTION("Insert, erase and find") {
+    ArenaAllocator arena(1024);
+    ArenaSmallVector<int, 0> vec({1, 2, 4}, arena);
+
+    vec.insert(vec.begin() + 2, 3);
+    REQUIRE(vec == ArenaSmallVector<int, 0>({1, 2, 3, 4}, arena));
+
+    auto it = std::find(vec.begin(), vec.end(), 2);
+    REQUIRE(it != vec.end());
+    vec.erase(it);
+    REQUIRE(vec.size() == 3);
+    REQUIRE(vec[1] == 3);
+
+    vec.clear();
+    REQUIRE(vec.empty());
+  }
+
+  SECTION("No inline slots") {
+    STATIC_REQUIRE(sizeof(ArenaSmallVector<int *, 0>) <
+                   sizeof(ArenaVector<int *>));
+
+    // Nothing is allocated yet, so the data pointer is null
+    ArenaAllocator arena(1024);
+    ArenaSmallVector<int, 0> vec(arena);
+    const int none[] = {1};
+    vec.insert(vec.end(), none, none);
+    vec.erase(vec.begin(), vec.end());
+    REQUIRE(vec.empty());
+    REQUIRE(arena.getTotalUsed() == 0);
+
+    vec.insert(vec.begin(), 7);
+    REQUIRE(vec.size() == 1);
+    REQUIRE_FALSE(vec.isInline());
+  }
+
+  SECTION("Copy and move") {
+    ArenaAllocator arena(1024);
+    ArenaSmallVector<int, 2> small({1, 2}, arena);
+    ArenaSmallVector<int, 2> large({1, 2, 3, 4, 5}, arena);
+
+    auto smallCopy = small;
+    auto movedSmall = std::move(small);
+    REQUIRE(movedSmall.isInline());
+    REQUIRE(movedSmall == smallCopy);
+    REQUIRE(small.empty());
+
+    const int *buffer = large.data();
+    auto movedLarge = std::move(large);
+    REQUIRE(movedLarge.data() == buffer);
+    REQUIRE(movedLarge.size() == 5);
+    REQUIRE(large.empty());
+    REQUIRE(large.isInline());
+  }
 }
 
 TEST_CASE("ArenaPtr smart pointer", "[arena][ptr]") {
@@ -372,4 +853,44 @@ TEST_CASE("String interning functionality", "[interned_string]") {
 
     REQUIRE(interner.getStringCount() == 1000); // Should not have increased
   }
+
+  SECTION("Table growth and probe statistics") {
+    ArenaAllocator arena(64 * 1024);
+    StringInterner interner(arena, false);
+    const size_t initialBuckets = interner.getBucketCount();
+
+    std::vector<InternedString> strings;
+    for (int i = 0; i < 5000; ++i) {
+      strings.push_back(interner.intern("ident" + std::to_string(i)));
+    }
+    REQUIRE(interner.getBucketCount() > initialBuckets);
+    REQUIRE(interner.getLoadFactor() <= 0.875);
+
+    // Identity survives rehashing
+    for (int i = 0; i < 5000; ++i) {
+      REQUIRE(interner.intern("ident" + std::to_string(i)) == strings[i]);
+    }
+
+    const auto histogram = interner.getProbeLengthHistogram();
+    size_t total = 0;
+    for (size_t count : histogram) {
+      total += count;
+    }
+    REQUIRE(total == interner.getStringCount());
+    REQUIRE(histogram[1] > total / 2); // Most strings sit in their home group
+  }
+
+  SECTION("Incremental and bulk hashing agree") {
+    const std::string text = "a_rather_long_identifier_name_0123456789";
+    for (size_t length = 0; length <= text.size(); ++length) {
+      const std::string_view prefix(text.data(), length);
+      StringHasher hasher;
+      for (char c : prefix) {
+        hasher.add(c);
+      }
+      REQUIRE(hasher.finish() == hashString(prefix));
+    }
+    REQUIRE(hashString("ab") != hashString("ba"));
+    REQUIRE(hashString("x") != hashString(std::string_view("x\0", 2)));
+  }
 }
@@ -1,6 +1,9 @@
 #include "catch2.hpp"
 #include <cxy/diagnostics.hpp>
 
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
 #include <sstream>
 #include <memory>
 
@@ -182,6 +185,78 @@ TEST_CASE("SourceManager functionality", "[diagnostics][source_manager]") {
     }
 }
 
+TEST_CASE("SourceManager loads files without copying", "[diagnostics][source_manager]") {
+    const auto path = std::filesystem::temp_directory_path() /
+                      ("source_" + std::to_string(rand()) + ".cxy");
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "func main() {\n    return 42\n}\n";
+    }
+    const std::string filename = path.string();
+
+    SECTION("Regular files are mapped and shared") {
+        auto buffer = SourceBuffer::fromFile(filename);
+        REQUIRE(buffer.has_value());
+        REQUIRE(buffer->isMapped());
+        REQUIRE(buffer->view() == "func main() {\n    return 42\n}\n");
+
+        SourceManager srcMgr;
+        auto content = srcMgr.loadFile(filename);
+        REQUIRE(content.has_value());
+        REQUIRE(*content == buffer->view());
+
+        // Every view is of the same bytes
+        REQUIRE(srcMgr.getFileContent(filename)->data() == content->data());
+        REQUIRE(srcMgr.getRangeView(Location(filename, Position(2, 12, 25),
+                                             Position(2, 14, 27)))
+                    .data() == content->data() + 25);
+        REQUIRE(srcMgr.getLine(filename, 2).value() == "    return 42");
+        REQUIRE(srcMgr.createPosition(filename, 25) == Position(2, 12, 25));
+    }
+
+    SECTION("Moving a buffer keeps the mapping") {
+        auto buffer = SourceBuffer::fromFile(filename);
+        REQUIRE(buffer.has_value());
+        const char *data = buffer->view().data();
+        SourceBuffer moved = std::move(*buffer);
+        REQUIRE(moved.view().data() == data);
+        REQUIRE_FALSE(buffer->isMapped());
+        REQUIRE(buffer->view().empty());
+    }
+
+    SECTION("Empty files are read instead") {
+        std::ofstream(path, std::ios::binary | std::ios::trunc).close();
+        SourceManager srcMgr;
+        auto content = srcMgr.loadFile(filename);
+        REQUIRE(content.has_value());
+        REQUIRE(content->empty());
+        REQUIRE(srcMgr.getLine(filename, 1).value() == "");
+    }
+
+    SECTION("Missing files and directories fail") {
+        SourceManager srcMgr;
+        REQUIRE_FALSE(srcMgr.loadFile(filename + ".missing").has_value());
+        REQUIRE_FALSE(srcMgr.hasFile(filename + ".missing"));
+        REQUIRE_FALSE(srcMgr.loadFile(path.parent_path().string()).has_value());
+    }
+
+    SECTION("Streams are read to the end") {
+        std::FILE *stream = std::fopen(filename.c_str(), "rb");
+        REQUIRE(stream != nullptr);
+        // A peeked byte pushed back into the stream is not lost
+        std::ungetc(std::getc(stream), stream);
+
+        SourceManager srcMgr;
+        auto content = srcMgr.loadStream("<stdin>", stream);
+        std::fclose(stream);
+        REQUIRE(content.has_value());
+        REQUIRE(*content == "func main() {\n    return 42\n}\n");
+        REQUIRE(srcMgr.getLine("<stdin>", 3).value() == "}");
+    }
+
+    std::filesystem::remove(path);
+}
+
 TEST_CASE("DiagnosticMessage construction", "[diagnostics][message]") {
     SECTION("Basic message creation") {
         Position pos(5, 10, 42);
@@ -0,0 +1,145 @@
+#include "catch2.hpp"
+#include "cxy/diagnostics.hpp"
+#include "cxy/frontend/incremental_lexer.hpp"
+#include "cxy/frontend/lexer.hpp"
+#include "cxy/memory/arena.hpp"
+#include "cxy/strings.hpp"
+
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace cxy;
+
+namespace {
+
+std::string makeModule(size_t functions) {
+  std::string source;
+  for (size_t i = 0; i < functions; ++i) {
+    const std::string n = std::to_string(i);
+    source += "// function " + n + "\n"
+              "func f" + n + "(a: i32, b: f64) : i64 {\n"
+              "    var s = \"value ${a + " + n + "} and ${\"inner ${b}\"}\"\n"
+              "    /* block\n       comment */ const c = '\\n'\n"
+              "    return (a << 2) >> 1 + 0x1f_ff * 1.5e3 + " + n + "\n"
+              "}\n\n";
+  }
+  return source;
+}
+
+// Checks every token of `tokens` against a lexer run over the whole text
+void checkAgainstFullLex(const IncrementalLexer &tokens,
+                         const std::string &text, StringInterner &interner) {
+  DiagnosticLogger logger;
+  logger.removeAllSinks();
+  Lexer whole("main.cxy", text, logger, interner, PositionMode::OffsetsOnly);
+
+  std::vector<Token> expected;
+  do {
+    expected.push_back(whole.nextToken());
+  } while (expected.back().kind != TokenKind::EoF);
+
+  REQUIRE(tokens.size() == expected.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    const Token token = tokens.expand(i);
+    CHECK(token == expected[i]);
+    CHECK(token.location.end == expected[i].location.end);
+    CHECK(token.getIntValue() == expected[i].getIntValue());
+    CHECK(token.getFloatValue() == expected[i].getFloatValue());
+    if (token.kind == TokenKind::Ident ||
+        token.kind == TokenKind::StringLiteral) {
+      CHECK(token.value.stringValue == expected[i].value.stringValue);
+    }
+    CHECK(tokens[i].offset == expected[i].location.start.byteOffset);
+  }
+}
+
+} // namespace
+
+TEST_CASE("Incremental re-lexing matches lexing from scratch",
+          "[lexer][incremental]") {
+  ArenaAllocator arena(1024 * 1024);
+  StringInterner interner(arena);
+  DiagnosticLogger logger;
+  logger.removeAllSinks();
+
+  std::string text = makeModule(40);
+  IncrementalLexer tokens("main.cxy", logger, interner);
+  tokens.reset(text);
+  REQUIRE(tokens.segmentCount() > 4);
+  checkAgainstFullLex(tokens, text, interner);
+
+  // Snippets that open or close strings, interpolations, comments and
+  // braces, so that an edit changes how everything after it lexes
+  const std::vector<std::string> snippets = {
+      "\"", "${", "}", "{", "/*", "*/", "//", "\n", "x", "123", "0x1f",
+      "1.5e3", "'a'", "r\"", " ", ">>", "\\", "func", "", "\"${x}\""};
+
+  std::mt19937 random(2024);
+  for (int i = 0; i < 300; ++i) {
+    IncrementalLexer::Edit edit;
+    edit.offset = random() % (text.size() + 1);
+    edit.removed = std::min<size_t>(random() % 8, text.size() - edit.offset);
+    const std::string &inserted = snippets[random() % snippets.size()];
+    edit.inserted = inserted.size();
+    text.replace(edit.offset, edit.removed, inserted);
+
+    const auto update = tokens.update(text, edit);
+    CHECK(update.bytesLexed <= text.size());
+    INFO("edit " << i);
+    checkAgainstFullLex(tokens, text, interner);
+  }
+}
+
+TEST_CASE("Incremental re-lexing stays local to the edit",
+          "[lexer][incremental]") {
+  ArenaAllocator arena(1024 * 1024);
+  StringInterner interner(arena);
+  DiagnosticLogger logger;
+  logger.removeAllSinks();
+
+  // Renaming an identifier in the middle of the file lexes the same bytes
+  // however long the file is, and the tree work grows with the logarithm of
+  // the segment count: forty times the segments, about twice the steps
+  std::vector<size_t> costs;
+  std::vector<size_t> steps;
+  for (size_t functions : {150, 6000}) {
+    std::string text = makeModule(functions);
+    IncrementalLexer tokens("main.cxy", logger, interner);
+    tokens.reset(text);
+    const size_t count = tokens.size();
+
+    const size_t offset = text.find("func f" + std::to_string(functions / 2));
+    text.insert(offset + 6, "renamed_");
+    const auto update = tokens.update(text, {offset + 6, 0, 8});
+    CHECK(tokens.size() == count);
+    CHECK(update.insertedTokens == update.removedTokens);
+    CHECK(update.bytesLexed < 8 * 1024);
+    costs.push_back(update.bytesLexed);
+    steps.push_back(update.treeSteps);
+    checkAgainstFullLex(tokens, text, interner);
+  }
+  INFO("tree steps " << steps[0] << " and " << steps[1]);
+  CHECK(costs[1] <= 2 * costs[0]);
+  CHECK(steps[1] <= 4 * steps[0]);
+
+  // An unterminated string swallows the rest of the file, leaving no old
+  // segment to get back in step with until it is closed again
+  std::string text = makeModule(500);
+  IncrementalLexer tokens("main.cxy", logger, interner);
+  tokens.reset(text);
+  const size_t count = tokens.size();
+  const size_t offset = text.find("return", text.size() / 2);
+
+  text.insert(offset, "\"");
+  auto update = tokens.update(text, {offset, 0, 1});
+  CHECK(update.bytesLexed >= text.size() - offset);
+  CHECK(tokens.size() < count);
+  checkAgainstFullLex(tokens, text, interner);
+
+  text.erase(offset, 1);
+  update = tokens.update(text, {offset, 1, 0});
+  CHECK(update.bytesLexed >= text.size() - offset);
+  CHECK(tokens.size() == count);
+  checkAgainstFullLex(tokens, text, interner);
+}
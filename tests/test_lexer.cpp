@@ -1,10 +1,16 @@
 #include "catch2.hpp"
 #include "cxy/diagnostics.hpp"
 #include "cxy/frontend/lexer.hpp"
+#include "cxy/frontend/numbers.hpp"
+#include "cxy/frontend/scan.hpp"
 #include "lexer_test_helper.hpp"
 
+#include <bit>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <memory>
+#include <random>
 
 namespace cxy {
 
@@ -89,6 +95,28 @@ TEST_CASE("Lexer can tokenize keywords", "[lexer][phase1]") {
   CHECK(tokens[9].kind == TokenKind::EoF);
 }
 
+TEST_CASE("Lexer classifies every keyword", "[lexer][phase1]") {
+  LexerTestHelper helper;
+
+#define CHECK_KEYWORD(name, str)                                               \
+  {                                                                            \
+    auto tokens = helper.tokenize(str);                                        \
+    REQUIRE(tokens.size() == 2);                                               \
+    CHECK(tokens[0].kind == TokenKind::name);                                  \
+  }
+  KEYWORD_LIST(CHECK_KEYWORD)
+#undef CHECK_KEYWORD
+
+  // Prefixes, extensions and case variants of keywords are identifiers
+  auto tokens = helper.tokenize("i iff returned Func THIS __c whilex");
+  REQUIRE(tokens.size() == 8);
+  for (size_t i = 0; i < 7; ++i) {
+    CHECK(tokens[i].kind == TokenKind::Ident);
+  }
+  CHECK(helper.getStringValue(tokens[1]) == "iff");
+  CHECK(helper.getStringValue(tokens[6]) == "whilex");
+}
+
 TEST_CASE("Lexer can tokenize basic integers", "[lexer][phase1]") {
   LexerTestHelper helper;
   auto tokens = helper.tokenize("42 0 123 999");
@@ -1726,6 +1754,87 @@ TEST_CASE("Lexer distinguishes between similar operators",
   CHECK_FALSE(helper.hasErrors());
 }
 
+TEST_CASE("Operators are lexed by maximal munch over SYMBOL_LIST",
+          "[lexer][phase1.5]") {
+  struct Spelling {
+    std::string_view text;
+    TokenKind kind;
+  };
+  std::vector<Spelling> operators;
+#define SYMBOL_SPELLING(name, str) operators.push_back({str, TokenKind::name});
+  SYMBOL_LIST(SYMBOL_SPELLING)
+#undef SYMBOL_SPELLING
+  // Overload names are put together by the parser
+  std::erase_if(operators, [](const Spelling &spelling) {
+    return spelling.kind == TokenKind::CallOverride ||
+           spelling.kind == TokenKind::IndexOverride ||
+           spelling.kind == TokenKind::IndexAssignOvd ||
+           spelling.kind == TokenKind::TruthyOverload;
+  });
+
+  // Random runs of operator characters without spaces; '/' is left out
+  // since `//` and `/*` start comments
+  std::string alphabet;
+  for (const auto &spelling : operators) {
+    for (char c : spelling.text) {
+      if (c != '/' && alphabet.find(c) == std::string::npos) {
+        alphabet += c;
+      }
+    }
+  }
+
+  std::mt19937 rng(5);
+  LexerTestHelper helper;
+  for (int round = 0; round < 500; ++round) {
+    std::string source(rng() % 12 + 1, ' ');
+    for (auto &c : source) {
+      c = alphabet[rng() % alphabet.size()];
+    }
+
+    // Reference: the longest spelling at each position
+    std::vector<TokenKind> expected;
+    for (size_t i = 0; i < source.size();) {
+      const Spelling *longest = nullptr;
+      for (const auto &spelling : operators) {
+        if (std::string_view(source).substr(i).starts_with(spelling.text) &&
+            (!longest || spelling.text.size() > longest->text.size())) {
+          longest = &spelling;
+        }
+      }
+      REQUIRE(longest != nullptr);
+      expected.push_back(longest->kind);
+      i += longest->text.size();
+    }
+
+    const auto tokens = helper.tokenize(source);
+    INFO(source);
+    REQUIRE(tokens.size() == expected.size() + 1);
+    for (size_t i = 0; i < expected.size(); ++i) {
+      CHECK(tokens[i].kind == expected[i]);
+    }
+  }
+}
+
+TEST_CASE("Template context splits >> operators", "[lexer][phase1.5]") {
+  DiagnosticLogger logger;
+  logger.removeAllSinks();
+  ArenaAllocator arena(1024 * 1024);
+  StringInterner interner(arena);
+  Lexer lexer("test.cxy", ">> >>= >>", logger, interner);
+
+  lexer.enterTemplateContext();
+  CHECK(lexer.nextToken().kind == TokenKind::Greater);
+  const Token second = lexer.nextToken();
+  CHECK(second.kind == TokenKind::Greater);
+  CHECK(second.location.start.column == 2);
+  CHECK(lexer.nextToken().kind == TokenKind::Greater);
+  CHECK(lexer.nextToken().kind == TokenKind::GreaterEqual);
+  lexer.exitTemplateContext();
+
+  CHECK(lexer.nextToken().kind == TokenKind::Shr);
+  CHECK(lexer.nextToken().kind == TokenKind::EoF);
+}
+
 TEST_CASE("Lexer handles complex operator expressions", "[lexer][phase1.5]") {
   LexerTestHelper helper;
 
@@ -1786,4 +1895,670 @@ TEST_CASE("Lexer handles complex operator expressions", "[lexer][phase1.5]") {
   CHECK(foundLBracket);
 }
 
+TEST_CASE("Scan kernels agree at every SIMD level", "[lexer][simd]") {
+  const auto saved = scan::getSimdLevel();
+  std::mt19937 rng(7);
+  const std::string alphabet = "  \t\r\n\n/**/ab";
+
+  for (int round = 0; round < 200; ++round) {
+    std::string text(rng() % 100, ' ');
+    for (auto &c : text) {
+      c = alphabet[rng() % alphabet.size()];
+    }
+    // Also start the scan at an unaligned offset
+    const size_t offset = text.empty() ? 0 : rng() % text.size();
+    const char *data = text.data() + offset;
+    const size_t size = text.size() - offset;
+
+    scan::setSimdLevel(scan::SimdLevel::Scalar);
+    const auto whitespace = scan::skipWhitespace(data, size);
+    const auto comment = scan::skipUntil(data, size, '*', '/');
+    const auto line = scan::skipUntil(data, size, '\n', '\n');
+
+    for (auto level : {scan::SimdLevel::SSE2, scan::SimdLevel::AVX2}) {
+      scan::setSimdLevel(level);
+      const auto w = scan::skipWhitespace(data, size);
+      const auto c = scan::skipUntil(data, size, '*', '/');
+      const auto l = scan::skipUntil(data, size, '\n', '\n');
+      REQUIRE(w.length == whitespace.length);
+      REQUIRE(w.newlines == whitespace.newlines);
+      REQUIRE(w.lineStart == whitespace.lineStart);
+      REQUIRE(c.length == comment.length);
+      REQUIRE(c.newlines == comment.newlines);
+      REQUIRE(c.lineStart == comment.lineStart);
+      REQUIRE(l.length == line.length);
+      REQUIRE(l.newlines == 0);
+    }
+  }
+  scan::setSimdLevel(saved);
+}
+
+TEST_CASE("Lexer positions do not depend on the SIMD level",
+          "[lexer][simd]") {
+  const auto saved = scan::getSimdLevel();
+  const std::string source =
+      "func main() {\n"
+      "    // a line comment that is longer than one vector stride......\n"
+      "\t\t\r\n"
+      "    /* block\n"
+      "       comment /* nested\n"
+      "       */ still comment\n"
+      "    */   var x = 1\n" +
+      std::string(70, ' ') + "y\n" + std::string(40, '\n') + "   z\n}";
+
+  std::vector<std::vector<Token>> results;
+  for (auto level : {scan::SimdLevel::Scalar, scan::SimdLevel::SSE2,
+                     scan::SimdLevel::AVX2}) {
+    scan::setSimdLevel(level);
+    LexerTestHelper helper;
+    results.push_back(helper.tokenize(source));
+    REQUIRE_FALSE(helper.hasErrors());
+  }
+  scan::setSimdLevel(saved);
+
+  const auto &expected = results.front();
+  REQUIRE(expected.size() == 13);
+  CHECK(expected[5].kind == TokenKind::Var);
+  CHECK(expected[5].location.start.row == 7);
+  CHECK(expected[5].location.start.column == 10);
+  CHECK(expected[9].location.start.row == 8);
+  CHECK(expected[9].location.start.column == 71);
+  CHECK(expected[10].location.start.row == 49);
+  CHECK(expected[10].location.start.column == 4);
+  for (const auto &tokens : results) {
+    REQUIRE(tokens.size() == expected.size());
+    for (size_t i = 0; i < tokens.size(); ++i) {
+      CHECK(tokens[i].kind == expected[i].kind);
+      CHECK(tokens[i].location.start.row == expected[i].location.start.row);
+      CHECK(tokens[i].location.start.column ==
+            expected[i].location.start.column);
+      CHECK(tokens[i].location.start.byteOffset ==
+            expected[i].location.start.byteOffset);
+    }
+  }
+}
+
+TEST_CASE("String scanning does not depend on the SIMD level",
+          "[lexer][simd]") {
+  const auto saved = scan::getSimdLevel();
+  const std::string body(100, 'x');
+  const std::string source = "\"" + body + "\" \"" + body +
+                             "\\n\\\"\\{" + body + "\\\\\" \"line one\n" +
+                             body + " line two\" \"" + body + "{a}" + body +
+                             "{b}\\{" + body + "\" end";
+
+  std::vector<std::vector<std::pair<Token, std::string>>> results;
+  for (auto level : {scan::SimdLevel::Scalar, scan::SimdLevel::SSE2,
+                     scan::SimdLevel::AVX2}) {
+    scan::setSimdLevel(level);
+    LexerTestHelper helper;
+    auto &tokens = results.emplace_back();
+    for (const auto &token : helper.tokenize(source)) {
+      const bool hasString = token.kind == TokenKind::StringLiteral ||
+                             token.kind == TokenKind::LString ||
+                             token.kind == TokenKind::RString;
+      tokens.emplace_back(
+          token, hasString ? token.value.stringValue.toString() : "");
+    }
+    REQUIRE_FALSE(helper.hasErrors());
+  }
+  scan::setSimdLevel(saved);
+
+  const auto &expected = results.front();
+  REQUIRE(expected.size() == 10);
+  CHECK(expected[0].second == body);
+  CHECK(expected[1].second == body + "\n\"{" + body + "\\");
+  CHECK(expected[2].second == "line one\n" + body + " line two");
+  CHECK(expected[3].first.kind == TokenKind::LString);
+  CHECK(expected[3].second == body);
+  CHECK(expected[5].first.kind == TokenKind::StringLiteral);
+  CHECK(expected[5].second == body);
+  CHECK(expected[7].first.kind == TokenKind::RString);
+  CHECK(expected[7].second == "{" + body);
+  CHECK(expected[8].first.kind == TokenKind::Ident);
+  CHECK(expected[8].first.location.start.row == 2);
+  CHECK(expected[8].first.location.start.column ==
+        body.size() + std::string(" line two\" \"").size() + body.size() +
+            std::string("{a}").size() + body.size() +
+            std::string("{b}\\{").size() + body.size() + 3);
+  for (const auto &tokens : results) {
+    REQUIRE(tokens.size() == expected.size());
+    for (size_t i = 0; i < tokens.size(); ++i) {
+      CHECK(tokens[i].first.kind == expected[i].first.kind);
+      CHECK(tokens[i].second == expected[i].second);
+      CHECK(tokens[i].first.location.start ==
+            expected[i].first.location.start);
+    }
+  }
+}
+
+TEST_CASE("Offset-only positions resolve to the eager ones",
+          "[lexer][positions]") {
+  const std::string source =
+      "func main() {\n"
+      "    // comment\r\n"
+      "    /* block\n"
+      "       comment */ var s = \"multi\n"
+      "line ${x + 1} string\"\n" +
+      std::string(70, ' ') + "y\n" + std::string(3, '\n') +
+      "\tr\"raw\n text\" 'c' 0x1f 2.5e3\n}";
+
+  LexerTestHelper helper;
+  const auto eager = helper.tokenize(source);
+  const auto lazy =
+      helper.tokenize(source, "test.cxy", PositionMode::OffsetsOnly);
+  REQUIRE_FALSE(helper.hasErrors());
+
+  SourceManager sourceManager;
+  sourceManager.registerFile("test.cxy", source);
+
+  REQUIRE(lazy.size() == eager.size());
+  for (size_t i = 0; i < lazy.size(); ++i) {
+    CHECK_FALSE(lazy[i].location.start.isResolved());
+    CHECK(lazy[i].location.start.byteOffset ==
+          eager[i].location.start.byteOffset);
+    CHECK(lazy[i].location.end.byteOffset == eager[i].location.end.byteOffset);
+
+    const Location resolved = sourceManager.resolve(lazy[i].location);
+    CHECK(resolved == eager[i].location);
+  }
+
+  // Already resolved positions and unknown files pass through untouched
+  CHECK(sourceManager.resolve(eager[1].location) == eager[1].location);
+  const Location unknown("other.cxy", Position::fromOffset(3));
+  CHECK(sourceManager.resolve(unknown) == unknown);
+}
+
+TEST_CASE("Compact tokens expand to the streamed tokens",
+          "[lexer][compact]") {
+  const std::string mainSource =
+      "func main() {\n"
+      "    var big = 0xffff_ffff_ffff_ffff_ffffu128\n"
+      "    const pi = 3.14159f32 + 2.5e-3\n"
+      "    var c = '\\u{1F600}'\n"
+      "    var s = \"line\\n ${name} done\"\n"
+      "    return r\"raw\n text\" + \"\"\n"
+      "}\n";
+  const std::string included = "import helper\n  var x = 42i8\n";
+
+  DiagnosticLogger logger;
+  logger.removeAllSinks();
+  ArenaAllocator arena(1024 * 1024);
+  StringInterner interner(arena);
+
+  // Same input through both interfaces, switching to an include midway
+  Lexer streamed("main.cxy", mainSource, logger, interner);
+  Lexer compact("main.cxy", mainSource, logger, interner);
+  std::vector<Token> expected;
+  std::vector<CompactToken> tokens;
+  for (int i = 0; i < 4; ++i) {
+    expected.push_back(streamed.nextToken());
+    tokens.push_back(compact.nextCompactToken());
+  }
+  REQUIRE(streamed.pushBuffer("helper.cxy", included));
+  REQUIRE(compact.pushBuffer("helper.cxy", included));
+  do {
+    expected.push_back(streamed.nextToken());
+    tokens.push_back(compact.nextCompactToken());
+  } while (!tokens.back().isEof());
+
+  REQUIRE(tokens.size() == expected.size());
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    const Token token = compact.expand(tokens[i]);
+    CHECK(token == expected[i]);
+    CHECK(token.location.end.row == expected[i].location.end.row);
+    CHECK(token.location.end.column == expected[i].location.end.column);
+    CHECK(token.getIntValue() == expected[i].getIntValue());
+    CHECK(token.getIntType() == expected[i].getIntType());
+    CHECK(token.getFloatType() == expected[i].getFloatType());
+    CHECK(token.getCharValue() == expected[i].getCharValue());
+    if (token.kind == TokenKind::Ident ||
+        token.kind == TokenKind::StringLiteral) {
+      CHECK(token.value.stringValue == expected[i].value.stringValue);
+    }
+    CHECK(tokens[i].length == token.location.getLength());
+  }
+
+  // The include got its own file id and tokens map back to it
+  CHECK(tokens[4].file == 1);
+  CHECK(compact.getLocation(tokens[4]).filename == "helper.cxy");
+  CHECK(compact.getLocation(tokens[4]).start.row == 1);
+  CHECK(tokens[5].file == 1);
+  CHECK(compact.getLocation(tokens[6]).start.row == 2);
+  CHECK(compact.getLocation(tokens.back()).filename == "main.cxy");
+
+  // Only the wide literals went to the side table
+  CHECK(compact.getLiterals().size() == 4);
+}
+
+TEST_CASE("SWAR digit kernels", "[lexer][numbers]") {
+  using namespace numbers;
+
+  CHECK(isEightDigits(loadEight("12345678")));
+  CHECK(parseEightDigits(loadEight("12345678")) == 12345678);
+  CHECK(parseEightDigits(loadEight("00000009")) == 9);
+  CHECK(parseEightDigits(loadEight("99999999")) == 99999999);
+  for (const char *text : {"1234567_", "/1234567", "1234:678", "1234 678",
+                           "123a5678", "\xb1" "234567"}) {
+    CHECK_FALSE(isEightDigits(loadEight(text)));
+  }
+
+  CHECK(isEightHexDigits(loadEight("deadBEEF")));
+  CHECK(parseEightHexDigits(loadEight("deadBEEF")) == 0xdeadbeef);
+  CHECK(parseEightHexDigits(loadEight("0123abcd")) == 0x0123abcd);
+  CHECK(parseEightHexDigits(loadEight("FfFfFfFf")) == 0xffffffff);
+  for (const char *text : {"0123456g", "G0000000", "@0000000", "`0000000",
+                           "0000_000", "\x10\x11\x12\x13\x14\x15\x16\x17",
+                           "\xc1\xc2\xc3\xc4\xc5\xc6\xc7\xc8"}) {
+    CHECK_FALSE(isEightHexDigits(loadEight(text)));
+  }
+}
+
+namespace {
+
+// The byte-at-a-time integer loop the lexer used before the SWAR kernels
+__uint128_t referenceInteger(std::string_view text) {
+  int base = 10;
+  size_t i = 0;
+  if (text.size() > 1 && text[0] == '0') {
+    if (text[1] == 'x') {
+      base = 16, i = 2;
+    } else if (text[1] == 'b') {
+      base = 2, i = 2;
+    } else if (text[1] == 'o') {
+      base = 8, i = 2;
+    } else {
+      base = 8;
+    }
+  }
+  __uint128_t value = 0;
+  for (; i < text.size(); ++i) {
+    const char c = text[i];
+    if (c == '_') {
+      continue;
+    }
+    const int digit = c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+    if (value > __uint128_t(-1) / base) {
+      value = __uint128_t(-1);
+    } else if (value * base > __uint128_t(-1) - digit) {
+      value = __uint128_t(-1);
+    } else {
+      value = value * base + digit;
+    }
+  }
+  return value;
+}
+
+double referenceDouble(std::string_view text) {
+  std::string digits;
+  for (char c : text) {
+    if (c != '_') {
+      digits.push_back(c);
+    }
+  }
+  return std::strtod(digits.c_str(), nullptr);
+}
+
+std::string randomDigits(std::mt19937 &rng, size_t count, int base,
+                         bool separators) {
+  static constexpr char DIGITS[] = "0123456789abcdefABCDEF";
+  std::string text;
+  for (size_t i = 0; i < count; ++i) {
+    if (separators && i > 0 && rng() % 6 == 0) {
+      text.push_back('_');
+    }
+    const size_t pick = rng() % (base == 16 ? 22 : base);
+    text.push_back(DIGITS[i == 0 && base == 10 && pick == 0 ? 1 : pick]);
+  }
+  return text;
+}
+
+} // namespace
+
+TEST_CASE("Integer literals match the byte-at-a-time reference",
+          "[lexer][numbers]") {
+  std::mt19937 rng(18);
+  std::vector<std::string> literals = {
+      "0", "7", "12345678", "123456789", "0x12345678", "0xFFFFFFFFFFFFFFFF",
+      "340282366920938463463374607431768211455",
+      "0xffffffffffffffffffffffffffffffff", "0777", "0b1011", "0o17",
+      "1234_5678_9012"};
+  for (int round = 0; round < 2000; ++round) {
+    const bool separators = rng() % 2;
+    if (rng() % 2) {
+      literals.push_back(randomDigits(rng, 1 + rng() % 38, 10, separators));
+    } else {
+      literals.push_back("0x" +
+                         randomDigits(rng, 1 + rng() % 32, 16, separators));
+    }
+  }
+
+  std::string source;
+  for (const auto &literal : literals) {
+    source += literal + " ";
+  }
+  LexerTestHelper helper;
+  const auto tokens = helper.tokenize(source);
+  REQUIRE_FALSE(helper.hasErrors());
+  REQUIRE(tokens.size() == literals.size() + 1);
+  for (size_t i = 0; i < literals.size(); ++i) {
+    INFO(literals[i]);
+    REQUIRE(tokens[i].kind == TokenKind::IntLiteral);
+    REQUIRE(tokens[i].getIntValue() == referenceInteger(literals[i]));
+  }
+
+  // Overflow saturates and reports, past the point the fast path gives up
+  helper.tokenize("3402823669209384634633746074317682114560");
+  CHECK(helper.hasErrorContaining("Integer literal overflow"));
+}
+
+TEST_CASE("Decimal float literals are correctly rounded", "[lexer][numbers]") {
+  std::mt19937 rng(1018);
+  std::vector<std::string> literals = {
+      "0.1", "0.3", "1.23", "3.14159265358979323846264338327950288",
+      "9007199254740993.0", "9007199254740995.0",
+      "2.2250738585072011e-308", "2.2250738585072014e-308", "4.9e-324",
+      "2.4703282292062327e-324", "2.4703282292062328e-324",
+      "1.7976931348623157e308", "1.7976931348623158e308",
+      "1.7976931348623159e308", "1e-400", "1e400", "0.000000000000000000001",
+      "123456789012345678901234567890.5", "7.2057594037927933e16",
+      "1_000.5_00", "0.0", "5."};
+  for (int round = 0; round < 5000; ++round) {
+    const bool separators = rng() % 4 == 0;
+    std::string literal =
+        rng() % 4 == 0 ? "0" : randomDigits(rng, 1 + rng() % 25, 10, separators);
+    literal += "." + randomDigits(rng, rng() % 25, 10, separators);
+    if (literal.back() == '.' || rng() % 2) {
+      literal += (rng() % 2 ? "e" : "E");
+      literal += (rng() % 3 == 0 ? "-" : rng() % 2 ? "+" : "");
+      literal += std::to_string(rng() % 330);
+    }
+    literals.push_back(literal);
+  }
+
+  std::string source;
+  for (const auto &literal : literals) {
+    source += literal + " ";
+  }
+  LexerTestHelper helper;
+  const auto tokens = helper.tokenize(source);
+  REQUIRE_FALSE(helper.hasErrors());
+  REQUIRE(tokens.size() == literals.size() + 1);
+  for (size_t i = 0; i < literals.size(); ++i) {
+    INFO(literals[i]);
+    REQUIRE(tokens[i].kind == TokenKind::FloatLiteral);
+    REQUIRE(std::bit_cast<uint64_t>(tokens[i].getFloatValue()) ==
+            std::bit_cast<uint64_t>(referenceDouble(literals[i])));
+  }
+}
+
+namespace {
+
+// Hands out `source` in pieces of 1 to 13 bytes, as a pipe might
+struct TrickleReader {
+  std::string_view source;
+  size_t *consumed;
+  std::mt19937 random{7};
+
+  size_t operator()(char *buffer, size_t capacity) {
+    const size_t count = std::min(
+        {capacity, source.size() - *consumed, size_t(random() % 13 + 1)});
+    std::memcpy(buffer, source.data() + *consumed, count);
+    *consumed += count;
+    return count;
+  }
+};
+
+} // namespace
+
+TEST_CASE("Streamed input lexes like a whole buffer", "[lexer][stream]") {
+  // Long strings and comments span many chunks at the sizes used below
+  const std::string source =
+      "func main() {\n"
+      "    /* " + std::string(300, '*') + " still\n comment */\n"
+      "    var s = \"" + std::string(200, 's') + "\\n ${name + 1} " +
+      std::string(100, 't') + " ${\"inner ${x}\"} done\"\n"
+      "    var r = r\"raw\n" + std::string(150, 'r') + "\"\n" +
+      std::string(120, ' ') + "const n = 123456789012345678 + 0x7fff_ffff\n"
+      "    const f = 3.141592653589793238462643e-2\n"
+      "    var c = '\\u{1F600}' + '\\q'\n"
+      "    ident" + std::string(90, 'x') + " >>= 2 // trailing\n"
+      "}\n" + std::string(80, '\n') + "var tail = \"unterminated";
+
+  DiagnosticLogger wholeLogger;
+  wholeLogger.removeAllSinks();
+  ArenaAllocator arena(1024 * 1024);
+  StringInterner interner(arena);
+  Lexer whole("main.cxy", source, wholeLogger, interner);
+  std::vector<Token> expected;
+  do {
+    expected.push_back(whole.nextToken());
+  } while (expected.back().kind != TokenKind::EoF);
+  REQUIRE(wholeLogger.getErrorCount() == 2);
+
+  for (size_t chunkSize : {1, 16, 37, 256, 64 * 1024}) {
+    DYNAMIC_SECTION("chunks of " << chunkSize) {
+      DiagnosticLogger logger;
+      logger.removeAllSinks();
+      size_t consumed = 0;
+      Lexer streamed("main.cxy", TrickleReader{source, &consumed}, logger,
+                     interner, chunkSize);
+      REQUIRE(streamed.isStreaming());
+
+      std::vector<Token> tokens;
+      do {
+        tokens.push_back(streamed.nextToken());
+      } while (tokens.back().kind != TokenKind::EoF);
+      CHECK(consumed == source.size());
+
+      REQUIRE(tokens.size() == expected.size());
+      for (size_t i = 0; i < tokens.size(); ++i) {
+        CHECK(tokens[i] == expected[i]);
+        CHECK(tokens[i].location.end == expected[i].location.end);
+        CHECK(tokens[i].getIntValue() == expected[i].getIntValue());
+        CHECK(tokens[i].getFloatValue() == expected[i].getFloatValue());
+        CHECK(tokens[i].getCharValue() == expected[i].getCharValue());
+        if (tokens[i].kind == TokenKind::Ident ||
+            tokens[i].kind == TokenKind::StringLiteral) {
+          CHECK(tokens[i].value.stringValue == expected[i].value.stringValue);
+        }
+      }
+
+      // Rolled-back attempts do not report their errors again
+      CHECK(logger.getErrorCount() == 2);
+    }
+  }
+}
+
+TEST_CASE("Streamed input is read as tokens are requested",
+          "[lexer][stream]") {
+  std::string source;
+  for (int i = 0; i < 20000; ++i) {
+    source += "var value" + std::to_string(i) + " = \"payload\" + 42\n";
+  }
+
+  DiagnosticLogger logger;
+  logger.removeAllSinks();
+  ArenaAllocator arena(1024 * 1024);
+  StringInterner interner(arena);
+  size_t consumed = 0;
+  constexpr size_t chunkSize = 4096;
+  Lexer lexer("main.cxy", TrickleReader{source, &consumed}, logger, interner,
+              chunkSize);
+
+  // Reads stop once two chunks of lookahead are held, the last read
+  // overshooting by at most one more
+  CHECK(lexer.nextCompactToken().kind == TokenKind::Var);
+  CHECK(consumed <= 3 * chunkSize);
+
+  // Reading never runs far ahead of lexing
+  size_t furthestAhead = 0;
+  size_t count = 1;
+  CompactToken token;
+  do {
+    token = lexer.nextCompactToken();
+    furthestAhead = std::max(furthestAhead, consumed - token.offset);
+    ++count;
+  } while (!token.isEof());
+  CHECK(count == 20000 * 6 + 1);
+  CHECK(consumed == source.size());
+  CHECK(furthestAhead <= 3 * chunkSize);
+  CHECK(lexer.getLocation(token).start.row == 20001);
+  CHECK_FALSE(logger.hasErrors());
+}
+
+namespace {
+
+// Decode-and-range-check reference for scan::validUtf8Prefix
+size_t referenceValidUtf8(std::string_view text) {
+  const auto *bytes = reinterpret_cast<const unsigned char *>(text.data());
+  size_t i = 0;
+  while (i < text.size()) {
+    const unsigned char lead = bytes[i];
+    const size_t length = lead < 0x80            ? 1
+                          : (lead & 0xE0) == 0xC0 ? 2
+                          : (lead & 0xF0) == 0xE0 ? 3
+                          : (lead & 0xF8) == 0xF0 ? 4
+                                                  : 0;
+    if (length == 0 || text.size() - i < length) {
+      return i;
+    }
+    uint32_t codepoint = length == 1 ? lead : lead & (0x7F >> length);
+    for (size_t k = 1; k < length; ++k) {
+      if ((bytes[i + k] & 0xC0) != 0x80) {
+        return i;
+      }
+      codepoint = (codepoint << 6) | (bytes[i + k] & 0x3F);
+    }
+    constexpr uint32_t smallest[] = {0, 0, 0x80, 0x800, 0x10000};
+    if (codepoint < smallest[length] || codepoint > 0x10FFFF ||
+        (codepoint >= 0xD800 && codepoint <= 0xDFFF)) {
+      return i;
+    }
+    i += length;
+  }
+  return text.size();
+}
+
+} // namespace
+
+TEST_CASE("UTF-8 validation agrees at every SIMD level", "[lexer][simd]") {
+  const auto saved = scan::getSimdLevel();
+  std::mt19937 rng(11);
+  const std::vector<std::string> valid = {
+      "a", "z", " ", "\n", "\xc2\x80", "\xdf\xbf", "\xc3\xa9",
+      "\xe0\xa0\x80", "\xe2\x82\xac", "\xed\x9f\xbf", "\xee\x80\x80",
+      "\xef\xbf\xbf", "\xf0\x90\x80\x80", "\xf0\x9f\x98\x80",
+      "\xf4\x8f\xbf\xbf"};
+  const std::vector<std::string> invalid = {
+      "\x80",             // Stray continuation
+      "\xbf\xbf",         // Two continuations
+      "\xc0\x80",         // Overlong NUL
+      "\xc1\xbf",         // Overlong 2 byte
+      "\xe0\x80\x80",     // Overlong 3 byte
+      "\xe0\x9f\xbf",     // Overlong 3 byte
+      "\xed\xa0\x80",     // High surrogate
+      "\xed\xbf\xbf",     // Low surrogate
+      "\xf0\x80\x80\x80", // Overlong 4 byte
+      "\xf0\x8f\xbf\xbf", // Overlong 4 byte
+      "\xf4\x90\x80\x80", // Above U+10FFFF
+      "\xf5\x80\x80\x80", // Lead beyond F4
+      "\xf8\x88\x80\x80", // Five byte form
+      "\xff",             // Never valid
+      "\xc3" "a",         // Truncated before ASCII
+      "\xe2\x82" "a",     // Truncated 3 byte
+      "\xf0\x9f\x98" "a", // Truncated 4 byte
+      "\xe2\x82\xac\x80", // One continuation too many
+  };
+
+  for (int round = 0; round < 3000; ++round) {
+    // Mostly ASCII with some multi-byte text, so both the ASCII fast paths
+    // and the block checks run, and sequences straddle block boundaries
+    std::string text;
+    const size_t pieces = rng() % 80;
+    for (size_t i = 0; i < pieces; ++i) {
+      text += rng() % 4 ? std::string(1, char('a' + rng() % 26))
+                        : valid[rng() % valid.size()];
+    }
+    switch (rng() % 4) {
+    case 0:
+      break; // Valid throughout
+    case 1:
+      text.insert(rng() % (text.size() + 1), invalid[rng() % invalid.size()]);
+      break;
+    case 2:
+      // Cut off a multi-byte sequence at the end
+      text += valid[4 + rng() % (valid.size() - 4)];
+      text.pop_back();
+      break;
+    case 3:
+      // Flip one of the top bits of some byte
+      if (!text.empty()) {
+        text[rng() % text.size()] ^= char(0x80 >> (rng() % 3));
+      }
+      break;
+    }
+
+    // Also start at an unaligned offset, possibly inside a sequence
+    const size_t offset =
+        text.empty() ? 0 : rng() % std::min<size_t>(4, text.size());
+    const std::string_view view(text.data() + offset, text.size() - offset);
+    const size_t expected = referenceValidUtf8(view);
+    for (auto level : {scan::SimdLevel::Scalar, scan::SimdLevel::SSE2,
+                       scan::SimdLevel::AVX2}) {
+      scan::setSimdLevel(level);
+      INFO("level " << scan::toString(scan::getSimdLevel()) << ", round "
+                    << round);
+      REQUIRE(scan::validUtf8Prefix(view.data(), view.size()) == expected);
+    }
+  }
+  scan::setSimdLevel(saved);
+}
+
+TEST_CASE("Invalid UTF-8 is reported where it starts", "[lexer][utf8]") {
+  LexerTestHelper helper;
+
+  SECTION("well-formed text in literals is accepted") {
+    auto tokens =
+        helper.tokenize("r\"caf\xc3\xa9 \xe2\x82\xac\n\xf0\x9f\x98\x80\" "
+                        "'\xc3\xa9' '\xe2\x82\xac' '\xf0\x9f\x98\x80' x");
+    REQUIRE_FALSE(helper.hasErrors());
+    REQUIRE(tokens.size() == 6);
+    CHECK(helper.getStringValue(tokens[0]) ==
+          "caf\xc3\xa9 \xe2\x82\xac\n\xf0\x9f\x98\x80");
+    CHECK(tokens[1].getCharValue() == 0xE9);
+    CHECK(tokens[2].getCharValue() == 0x20AC);
+    CHECK(tokens[3].getCharValue() == 0x1F600);
+    // Columns count bytes
+    CHECK(tokens[4].location.start.row == 2);
+    CHECK(tokens[4].location.start.column == 25);
+  }
+
+  SECTION("raw strings report each ill-formed sequence") {
+    auto tokens = helper.tokenize("x r\"ok \xff \xc3\xa9 \xe2\x82\" y");
+    REQUIRE(tokens.size() == 4);
+    CHECK(tokens[1].kind == TokenKind::StringLiteral);
+    const auto errors = helper.getErrors();
+    REQUIRE(errors.size() == 3);
+    // The stray byte, then the truncated sequence one byte at a time
+    CHECK(errors[0].primaryLocation.start.column == 8);
+    CHECK(errors[1].primaryLocation.start.column == 13);
+    CHECK(errors[2].primaryLocation.start.column == 14);
+    for (const auto &error : errors) {
+      CHECK(error.message.find("Invalid UTF-8") != std::string::npos);
+    }
+    CHECK(tokens[2].location.start.column == 17);
+  }
+
+  SECTION("character literals") {
+    for (const char *source : {"'\xe2\x82'", "'\xed\xa0\x80'", "'\xff'"}) {
+      auto tokens = helper.tokenize(source);
+      CHECK(tokens[0].kind == TokenKind::Error);
+      CHECK(tokens[0].location.start.column == 1);
+      CHECK(helper.hasErrorContaining(
+          "Invalid UTF-8 sequence in character literal"));
+    }
+  }
+}
+
 } // namespace cxy
@@ -2,6 +2,7 @@
 #include <cxy/strings.hpp>
 
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -129,6 +130,23 @@ TEST_CASE("StringInterner functionality", "[strings][string_interner]") {
     REQUIRE(interner.getStringCount() == 1);
   }
 
+  SECTION("Precomputed hash") {
+    ArenaAllocator arena(1024);
+    StringInterner interner(arena, false);
+
+    StringHasher hasher;
+    for (char c : std::string_view("scannedIdentifier")) {
+      hasher.add(c);
+    }
+    InternedString scanned =
+        interner.intern("scannedIdentifier", hasher.finish());
+
+    REQUIRE(scanned == interner.intern("scannedIdentifier"));
+    REQUIRE(scanned.getHash() == hashString("scannedIdentifier"));
+    REQUIRE(interner.intern("", hashString("")).empty());
+    REQUIRE(interner.getStringCount() == 1);
+  }
+
   SECTION("Statistics") {
     ArenaAllocator arena(1024);
     StringInterner interner(arena, false);
@@ -314,3 +332,216 @@ TEST_CASE("String interner edge cases", "[strings][edge_cases]") {
     }
   }
 }
+
+TEST_CASE("Concurrent string interner", "[strings][concurrent]") {
+  SECTION("Behaves like the single-threaded interner") {
+    ArenaAllocator arena(1024);
+    StringInterner interner(arena, false, InternerMode::Concurrent);
+    REQUIRE(interner.isConcurrent());
+
+    auto hello = interner.intern("hello");
+    REQUIRE(hello == interner.intern(std::string("hello")));
+    REQUIRE(hello != interner.intern("world"));
+    REQUIRE(hello.view() == "hello");
+    REQUIRE(interner.intern("").empty());
+    REQUIRE(interner.getStringCount() == 2);
+
+    // Strings are owned by the interner, not the caller's arena
+    REQUIRE(arena.getTotalUsed() == 0);
+  }
+
+  SECTION("Threads agree on identity") {
+    ArenaAllocator arena(1024);
+    StringInterner interner(arena, true, InternerMode::Concurrent);
+    const size_t preInterned = interner.getStringCount();
+
+    constexpr size_t threadCount = 8;
+    constexpr size_t uniqueCount = 5000;
+    std::vector<std::vector<InternedString>> results(threadCount);
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < threadCount; ++t) {
+      threads.emplace_back([&, t] {
+        // Each thread walks the names in a different order
+        for (size_t i = 0; i < uniqueCount; ++i) {
+          const size_t index = (i * 7 + t * 613) % uniqueCount;
+          results[t].push_back(
+              interner.intern("name" + std::to_string(index)));
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+
+    REQUIRE(interner.getStringCount() == preInterned + uniqueCount);
+
+    // Every thread got the same pointer for the same name
+    std::unordered_map<std::string_view, InternedString> first;
+    for (const auto &str : results[0]) {
+      first.emplace(str.view(), str);
+    }
+    for (size_t t = 1; t < threadCount; ++t) {
+      for (const auto &str : results[t]) {
+        REQUIRE(first.at(str.view()) == str);
+      }
+    }
+
+    size_t probed = 0;
+    for (size_t count : interner.getProbeLengthHistogram()) {
+      probed += count;
+    }
+    REQUIRE(probed == interner.getStringCount());
+  }
+}
+
+TEST_CASE("Symbol ids", "[strings][symbol_id]") {
+  SECTION("Ids are dense and round-trip") {
+    ArenaAllocator arena(1024);
+    StringInterner interner(arena, false);
+    REQUIRE(interner.getSymbolLimit() == 1);
+
+    const SymbolId foo = interner.internSymbol("foo");
+    const SymbolId bar = interner.internSymbol("bar");
+    REQUIRE(foo.index() == 1);
+    REQUIRE(bar.index() == 2);
+    REQUIRE(interner.internSymbol("foo") == foo);
+    REQUIRE(interner.internSymbol("").empty());
+    REQUIRE(interner.getSymbolLimit() == 3);
+
+    REQUIRE(interner.view(foo) == "foo");
+    REQUIRE(interner.getString(bar) == interner.intern("bar"));
+    REQUIRE(interner.getString(SymbolId()).empty());
+    REQUIRE(interner.getSymbolId(interner.intern("bar")) == bar);
+    REQUIRE(interner.getSymbolId(InternedString()).empty());
+  }
+
+  SECTION("Ids survive rehashing") {
+    ArenaAllocator arena(1024);
+    StringInterner interner(arena, false);
+
+    std::vector<SymbolId> ids;
+    for (size_t i = 0; i < 5000; ++i) {
+      ids.push_back(interner.internSymbol("sym" + std::to_string(i)));
+    }
+    for (size_t i = 0; i < ids.size(); ++i) {
+      REQUIRE(ids[i].index() == i + 1);
+      REQUIRE(interner.view(ids[i]) == "sym" + std::to_string(i));
+    }
+  }
+
+  SECTION("SymbolMap is indexed by id") {
+    ArenaAllocator arena(1024);
+    StringInterner interner(arena);
+
+    SymbolMap<int> uses(interner.getSymbolLimit());
+    const SymbolId x = interner.internSymbol("x");
+    ++uses[x];
+    ++uses[x];
+    ++uses[interner.getSymbolId(interner.intern("y"))];
+
+    const auto &readOnly = uses;
+    REQUIRE(readOnly[x] == 2);
+    REQUIRE(readOnly[interner.internSymbol("y")] == 1);
+    REQUIRE(readOnly[interner.internSymbol("z")] == 0);
+  }
+
+  SECTION("Concurrent interners hand out unique ids") {
+    ArenaAllocator arena(1024);
+    StringInterner interner(arena, false, InternerMode::Concurrent);
+
+    constexpr size_t threadCount = 4;
+    constexpr size_t uniqueCount = 3000;
+    std::vector<std::vector<SymbolId>> results(threadCount);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < threadCount; ++t) {
+      threads.emplace_back([&, t] {
+        for (size_t i = 0; i < uniqueCount; ++i) {
+          const size_t index = (i * 11 + t * 101) % uniqueCount;
+          results[t].push_back(
+              interner.internSymbol("id" + std::to_string(index)));
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+
+    REQUIRE(interner.getSymbolLimit() == uniqueCount + 1);
+    std::unordered_set<uint32_t> seen;
+    for (const SymbolId id : results[0]) {
+      REQUIRE(!id.empty());
+      REQUIRE(interner.getSymbolId(interner.getString(id)) == id);
+      seen.insert(id.index());
+    }
+    REQUIRE(seen.size() == uniqueCount);
+    for (size_t t = 1; t < threadCount; ++t) {
+      for (size_t i = 0; i < uniqueCount; ++i) {
+        const size_t index = (i * 11 + t * 101) % uniqueCount;
+        REQUIRE(interner.view(results[t][i]) ==
+                "id" + std::to_string(index));
+      }
+    }
+  }
+}
+
+TEST_CASE("Builtin string table", "[strings][builtins]") {
+  SECTION("Interners are seeded without copying") {
+    ArenaAllocator arena(1024);
+    StringInterner interner(arena);
+
+    const auto builtins = BuiltinStrings::strings();
+    REQUIRE(interner.getStringCount() == builtins.size());
+    REQUIRE(arena.getTotalUsed() == 0);
+    for (size_t i = 0; i < builtins.size(); ++i) {
+      const SymbolId id(static_cast<uint32_t>(i + 1));
+      REQUIRE(interner.intern(builtins[i].view()) == builtins[i]);
+      REQUIRE(interner.internSymbol(builtins[i].view()) == id);
+      REQUIRE(BuiltinStrings::find(builtins[i].view()) == id);
+    }
+    REQUIRE(BuiltinStrings::find("notABuiltin").empty());
+  }
+
+  SECTION("Ids are fixed across interners and modes") {
+    ArenaAllocator arena(1024);
+    StringInterner first(arena);
+    StringInterner second(arena);
+    StringInterner concurrent(arena, true, InternerMode::Concurrent);
+
+    // Keywords come first, in KEYWORD_LIST order
+    REQUIRE(first.internSymbol("auto").index() == 1);
+    for (const char *name : {"main", "func", "assert", "__tid"}) {
+      const SymbolId id = BuiltinStrings::find(name);
+      REQUIRE(!id.empty());
+      REQUIRE(first.internSymbol(name) == id);
+      REQUIRE(second.internSymbol(name) == id);
+      REQUIRE(concurrent.internSymbol(name) == id);
+    }
+    REQUIRE(first.internSymbol("userName") == second.internSymbol("userName"));
+  }
+
+  SECTION("S_ names match every interner") {
+    ArenaAllocator arena(1024);
+    StringInterner first(arena);
+    StringInterner second(arena, true, InternerMode::Concurrent);
+
+    REQUIRE(S::S_main.view() == "main");
+    REQUIRE(S::S__assert.view() == "assert");
+    REQUIRE(first.intern("main") == S::S_main);
+    REQUIRE(second.intern("main") == S::S_main);
+    // Builtin names that are also keywords share the keyword's entry
+    REQUIRE(first.intern("super") == S::S_super);
+    REQUIRE(first.internSymbol("super") == BuiltinStrings::find("super"));
+  }
+
+  SECTION("Seeded strings survive rehashing") {
+    ArenaAllocator arena(1024);
+    StringInterner interner(arena);
+    for (size_t i = 0; i < 2000; ++i) {
+      (void)interner.intern("grow" + std::to_string(i));
+    }
+    for (const auto &builtin : BuiltinStrings::strings()) {
+      REQUIRE(interner.intern(builtin.view()) == builtin);
+    }
+  }
+}
@@ -462,4 +462,52 @@ TEST_CASE("Token edge cases", "[token][edge_cases]") {
         REQUIRE(text1.data() == text2.data());
         REQUIRE(text2.data() == text3.data());
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Compact token layout", "[token][compact]") {
+    STATIC_REQUIRE(sizeof(CompactToken) == 16);
+    STATIC_REQUIRE(std::is_trivially_copyable_v<CompactToken>);
+
+    CompactToken token;
+    REQUIRE(token.kind == TokenKind::Error);
+    REQUIRE_FALSE(token.hasLiteralValue());
+
+    LiteralTable literals;
+    const auto first = literals.add(Token::Value(static_cast<__uint128_t>(7),
+                                                 IntegerKind::U8));
+    const auto second = literals.add(Token::Value(1.5, FloatKind::F64));
+    REQUIRE(first == 0);
+    REQUIRE(second == 1);
+    REQUIRE(literals[first].intValue.value == 7);
+    REQUIRE(literals[first].intValue.type == IntegerKind::U8);
+    REQUIRE(literals[second].floatValue.value == 1.5);
+    REQUIRE(literals.size() == 2);
+}
+
+TEST_CASE("Token sets", "[token][set]") {
+    constexpr TokenSet brackets = {TokenKind::LParen, TokenKind::RParen,
+                                   TokenKind::LBracket, TokenKind::RBracket};
+    constexpr TokenSet closers = {TokenKind::RParen, TokenKind::RBracket,
+                                  TokenKind::RBrace};
+    STATIC_REQUIRE(brackets.contains(TokenKind::LBracket));
+    STATIC_REQUIRE_FALSE(brackets.contains(TokenKind::RBrace));
+    STATIC_REQUIRE(brackets.size() == 4);
+    STATIC_REQUIRE((brackets & closers) ==
+                   TokenSet{TokenKind::RParen, TokenKind::RBracket});
+    STATIC_REQUIRE((brackets | closers).size() == 5);
+    STATIC_REQUIRE((brackets - closers) ==
+                   TokenSet{TokenKind::LParen, TokenKind::LBracket});
+    STATIC_REQUIRE(TokenSet{}.empty());
+
+    // Kinds in every word of the bitset, visited in TokenKind order
+    TokenSet set = {TokenKind::Error, TokenKind::LParen, TokenKind::Ident,
+                    TokenKind::Func};
+    std::vector<TokenKind> kinds(set.begin(), set.end());
+    REQUIRE(kinds == std::vector<TokenKind>{TokenKind::LParen, TokenKind::Func,
+                                            TokenKind::Ident, TokenKind::Error});
+
+    set.erase(TokenKind::Error).insert(TokenKind::EoF);
+    REQUIRE_FALSE(set.contains(TokenKind::Error));
+    REQUIRE(set.contains(TokenKind::EoF));
+    REQUIRE(set.size() == 4);
+}